@@ -0,0 +1,81 @@
+// Gradient cost relative to a single evaluation.
+// Compares reverse mode, forward mode (one sweep per variable) and central
+// finite differences on a generated expression over N variables.
+#include "autodiff.h"
+#include "parser.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::string makeExpression(size_t vars) {
+    std::string s;
+    for (size_t i = 0; i < vars; i++) {
+        std::string x = "x" + std::to_string(i);
+        std::string y = "x" + std::to_string((i + 1) % vars);
+        if (i > 0) s += " + ";
+        s += "sin(" + x + ")*" + y + " + exp(" + x + "/10) - sqrt(" + x + "^2 + 1)";
+    }
+    return s;
+}
+
+template <typename F>
+double timePerCall(F&& f, int iterations) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) f();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::micro>(end - start).count() / iterations;
+}
+
+} // namespace
+
+int main() {
+    Parser parser;
+    std::printf("%6s %8s %12s %12s %12s %12s %10s %12s\n",
+                "vars", "nodes", "eval(us)", "reverse(us)", "forward(us)", "findiff(us)",
+                "rev/eval", "max|err|");
+
+    for (size_t vars : {10, 100, 300, 1000}) {
+        Expression expr = parser.compile(makeExpression(vars));
+        size_t n = expr.getVariableCount();
+        std::vector<double> values(n);
+        for (size_t i = 0; i < n; i++) values[i] = 0.1 + 0.01 * static_cast<double>(i);
+
+        std::vector<double> registers, adjoints, grad(n), fd(n);
+        int iterations = static_cast<int>(200000 / vars) + 1;
+        volatile double sink = 0;
+
+        double evalUs = timePerCall([&] { sink = expr.evaluate(values.data(), registers); }, iterations);
+        double reverseUs = timePerCall([&] {
+            sink = gradient(expr, values.data(), grad.data(), registers, adjoints);
+        }, iterations);
+
+        int slowIterations = iterations / static_cast<int>(vars) + 1;
+        double forwardUs = timePerCall([&] {
+            for (size_t s = 0; s < n; s++) sink = differentiate(expr, values.data(), s).derivative;
+        }, slowIterations);
+        double finiteUs = timePerCall([&] {
+            std::vector<double> v = values;
+            for (size_t s = 0; s < n; s++) {
+                double h = 1e-6 * std::max(1.0, std::abs(v[s]));
+                v[s] = values[s] + h;
+                double fp = expr.evaluate(v.data(), registers);
+                v[s] = values[s] - h;
+                double fm = expr.evaluate(v.data(), registers);
+                v[s] = values[s];
+                fd[s] = (fp - fm) / (2 * h);
+            }
+        }, slowIterations);
+
+        double maxErr = 0;
+        for (size_t s = 0; s < n; s++) maxErr = std::max(maxErr, std::abs(fd[s] - grad[s]));
+
+        std::printf("%6zu %8zu %12.2f %12.2f %12.2f %12.2f %10.2f %12.2e\n",
+                    n, expr.getNodes().size(), evalUs, reverseUs, forwardUs, finiteUs,
+                    reverseUs / evalUs, maxErr);
+    }
+    return 0;
+}
@@ -0,0 +1,268 @@
+// Checks calcpp_constexpr.h against the runtime Parser and times the ways
+// of evaluating a fixed formula. The static_asserts run in the compiler;
+// at run time random expressions are compiled both ways and must give the
+// same value (or the same error), and the constexpr elementary functions
+// are compared with libm in ulps. Exits with 1 on any disagreement, or
+// on a function further from libm than libm's own error (glibc: 1 ulp, 2
+// for log10) allows.
+#include "calcpp_constexpr.h"
+#include "parser.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Grammar corners, evaluated by the compiler
+static_assert(calcpp::evaluate("2 + 3 * 4") == 14, "precedence");
+static_assert(calcpp::evaluate("-2^2") == 4, "prefix minus binds to the factor");
+static_assert(calcpp::evaluate("2^3^2") == 64, "'^' associates to the left");
+static_assert(calcpp::evaluate("2pi") == 2 * 3.141592653589793, "implicit multiplication");
+static_assert(calcpp::evaluate("2pi^2") == (2 * 3.141592653589793) * (2 * 3.141592653589793),
+              "implicit multiplication before a constant binds like '^'");
+static_assert(calcpp::evaluate("2(3 + 4)") == 14, "implicit multiplication before '('");
+static_assert(calcpp::evaluate("-7 % 3") == -1, "fmod keeps the sign of the dividend");
+static_assert(calcpp::evaluate("\xE2\x88\x9A(16) + pow(2, 10)") == 1028, "square root sign and pow");
+static_assert(calcpp::evaluate("1.5e3 + 2E-4 + .5") == 1500.5002, "number formats");
+static_assert(calcpp::evaluate("round(-2.5) + floor(-0.5) + ceil(0.2) + abs(-3)") == 0, "rounding");
+static_assert(calcpp::evaluate("sqrt(2)") == 1.4142135623730951, "sqrt is correctly rounded");
+static_assert(calcpp::evaluate("exp(1)") == 2.718281828459045, "exp");
+static_assert(calcpp::evaluate("ln(e) + log(1000)") == 4, "logarithms");
+static_assert(calcpp::evaluate("sin(pi/6)") == 0.49999999999999994, "sin");
+static_assert(calcpp::evaluate("4atan(1)") == 3.141592653589793, "atan");
+
+static constexpr auto ENERGY = calcpp::compile("m * v^2 / 2");
+constexpr auto KINETIC = calcpp::bind<ENERGY>("m", "v");
+static_assert(KINETIC(2.0, 3.0) == 9.0, "bound function");
+static_assert(ENERGY.evaluate({{"v", 3.0}, {"m", 2.0}}) == 9.0, "named evaluation");
+static_assert(ENERGY.getVariableCount() == 2 && ENERGY.findVariable("v") == 1, "variable slots");
+static_assert(calcpp::compile("sin(x)*sin(x) + x").size() == 4, "common subexpressions are shared");
+
+const char* const VARIABLES[] = {"a", "b", "c", "d"};
+const double VALUES[] = {0.7, -1.3, 2.5, 0.0};
+
+std::string operand(std::mt19937_64& rng, int depth);
+
+// Random text in the calculator's grammar, including its implicit
+// multiplication forms and operators that fail at run time (x / d, d = 0)
+std::string expression(std::mt19937_64& rng, int depth) {
+    // " " is juxtaposition: a product before a number, function or '(',
+    // the end of the expression before a variable
+    static const char* const operators[] = {" + ", " - ", " * ", " / ", " % ", "^", " "};
+    std::string text = operand(rng, depth);
+    int terms = static_cast<int>(rng() % 3);
+    for (int t = 0; t < terms; t++) {
+        text += operators[rng() % 7] + operand(rng, depth);
+    }
+    return text;
+}
+
+std::string operand(std::mt19937_64& rng, int depth) {
+    static const char* const functions[] = {"sin", "cos", "tan", "asin", "acos", "atan", "log", "log10",
+                                            "ln", "sqrt", "abs", "floor", "ceil", "round", "exp"};
+    static const char* const numbers[] = {"2", "0.5", "3.25", "1e-3", "2.5E2", "pi", "e", "phi", "10", ".75"};
+    switch (depth > 0 ? rng() % 6 : rng() % 2) {
+        case 0: return numbers[rng() % 10];
+        case 1: return VARIABLES[rng() % 4];
+        case 2: return std::string(functions[rng() % 15]) + "(" + expression(rng, depth - 1) + ")";
+        case 3: return "(" + expression(rng, depth - 1) + ")";
+        case 4: return "-" + operand(rng, depth - 1);
+        default: return "pow(" + expression(rng, depth - 1) + ", " + operand(rng, depth - 1) + ")";
+    }
+}
+
+struct Outcome {
+    double value = 0.0;
+    ErrorCode code = ErrorCode::NONE;
+    size_t offset = 0;
+    std::string message;
+};
+
+bool same(const Outcome& x, const Outcome& y) {
+    if (x.code != y.code) return false;
+    if (x.code != ErrorCode::NONE) return x.offset == y.offset && x.message == y.message;
+    return std::memcmp(&x.value, &y.value, sizeof(double)) == 0 || (x.value != x.value && y.value != y.value);
+}
+
+Outcome runtime(const std::string& text) {
+    Outcome outcome;
+    try {
+        Parser parser;
+        Expression expr = parser.compile(text);
+        std::vector<double> values = expr.bindVariables(
+            {{"a", VALUES[0]}, {"b", VALUES[1]}, {"c", VALUES[2]}, {"d", VALUES[3]}});
+        outcome.value = expr.evaluate(values.data());
+    } catch (const CalcException& e) {
+        outcome.code = e.code;
+        outcome.offset = e.offset;
+        outcome.message = e.what();
+    }
+    return outcome;
+}
+
+Outcome constexprParser(const std::string& text) {
+    Outcome outcome;
+    try {
+        auto program = calcpp::compile<1024>(text);
+        outcome.value = program.evaluate({{"a", VALUES[0]}, {"b", VALUES[1]}, {"c", VALUES[2]}, {"d", VALUES[3]}});
+    } catch (const CalcException& e) {
+        outcome.code = e.code;
+        outcome.offset = e.offset;
+        outcome.message = e.what();
+    }
+    return outcome;
+}
+
+int64_t ulpDistance(double x, double y) {
+    if (x == y) return 0;
+    if (x != x || y != y) return (x != x && y != y) ? 0 : INT64_MAX;
+    int64_t a, b;
+    std::memcpy(&a, &x, sizeof(a));
+    std::memcpy(&b, &y, sizeof(b));
+    if (a < 0) a = INT64_MIN - a;
+    if (b < 0) b = INT64_MIN - b;
+    return a > b ? a - b : b - a;
+}
+
+template <class F>
+double nanosecondsPer(F&& run) {
+    size_t iterations = 0;
+    auto start = std::chrono::steady_clock::now();
+    double seconds = 0.0;
+    do {
+        for (int i = 0; i < 1000; i++) run();
+        iterations += 1000;
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    } while (seconds < 0.2);
+    return seconds / iterations * 1e9;
+}
+
+static constexpr auto FORMULA = calcpp::compile("(a*b + sin(a)^2) / (1 + c^2) - sqrt(a^2 + b^2)");
+
+} // namespace
+
+int main() {
+    int failures = 0;
+
+    // Grammar: random expressions, values and errors must match exactly
+    std::mt19937_64 rng(35);
+    size_t compared = 0, errors = 0;
+    for (int i = 0; i < 20000; i++) {
+        std::string text = expression(rng, 3);
+        Outcome expected = runtime(text);
+        Outcome actual = constexprParser(text);
+        compared++;
+        if (expected.code != ErrorCode::NONE) errors++;
+        if (!same(expected, actual)) {
+            if (failures++ < 10) {
+                std::printf("mismatch: %s\n  Parser    %.17g [%d at %zu] %s\n  constexpr %.17g [%d at %zu] %s\n",
+                            text.c_str(), expected.value, static_cast<int>(expected.code), expected.offset,
+                            expected.message.c_str(), actual.value, static_cast<int>(actual.code), actual.offset,
+                            actual.message.c_str());
+            }
+        }
+    }
+    const char* const malformed[] = {"2 +", "(1 + 2", "sin 2", "pow(2 3)", "pow(2, 3", "sqrt(2, 3)", "1 + #",
+                                     "1e999", "1e-320", ".", "2 * )", "1 + 2 $", "√", "x√(2)", "3 ^ ^ 2"};
+    for (const char* text : malformed) {
+        Outcome expected = runtime(text);
+        Outcome actual = constexprParser(text);
+        compared++;
+        if (!same(expected, actual)) {
+            failures++;
+            std::printf("error mismatch: %s\n  Parser    [%d at %zu] %s\n  constexpr [%d at %zu] %s\n", text,
+                        static_cast<int>(expected.code), expected.offset, expected.message.c_str(),
+                        static_cast<int>(actual.code), actual.offset, actual.message.c_str());
+        }
+    }
+    std::printf("parser: %zu expressions compared (%zu raising errors), %d mismatches\n", compared, errors, failures);
+
+    // Elementary functions used during constant evaluation against libm
+    struct MathCase {
+        const char* name;
+        double (*constant)(double);
+        double (*library)(double);
+        double low;
+        double high;
+        int64_t tolerance;
+    };
+    const MathCase cases[] = {
+        {"sin", calcpp::math::sin, std::sin, -100, 100, 1},
+        {"cos", calcpp::math::cos, std::cos, -100, 100, 1},
+        {"tan", calcpp::math::tan, std::tan, -10, 10, 1},
+        {"asin", calcpp::math::asin, std::asin, -1, 1, 1},
+        {"acos", calcpp::math::acos, std::acos, -1, 1, 1},
+        {"atan", calcpp::math::atan, std::atan, -50, 50, 1},
+        {"exp", calcpp::math::exp, std::exp, -700, 700, 1},
+        {"ln", calcpp::math::log, std::log, 1e-300, 1e300, 1},
+        {"log10", calcpp::math::log10, std::log10, 1e-10, 1e10, 2},
+        {"sqrt", calcpp::math::sqrt, std::sqrt, 0, 1e300, 0},
+    };
+    std::printf("\n%-8s %10s %10s %8s\n", "function", "samples", "exact %", "max ulp");
+    for (const auto& c : cases) {
+        std::uniform_real_distribution<double> uniform(c.low, c.high);
+        std::uniform_real_distribution<double> exponent(std::log(c.low > 0 ? c.low : 1e-3), std::log(c.high));
+        size_t exact = 0, samples = 200000;
+        int64_t worst = 0;
+        for (size_t i = 0; i < samples; i++) {
+            // Half uniform, half log-uniform so small arguments are covered too
+            double x = i % 2 ? uniform(rng) : std::exp(exponent(rng)) * (c.low < 0 && rng() % 2 ? -1 : 1);
+            int64_t distance = ulpDistance(c.constant(x), c.library(x));
+            exact += distance == 0;
+            worst = std::max(worst, distance);
+        }
+        std::printf("%-8s %10zu %9.3f%% %8lld\n", c.name, samples, 100.0 * exact / samples,
+                    static_cast<long long>(worst));
+        if (worst > c.tolerance) failures++;
+    }
+    {
+        std::uniform_real_distribution<double> base(0, 20), power(-30, 30);
+        size_t exact = 0, samples = 200000;
+        int64_t worst = 0;
+        for (size_t i = 0; i < samples; i++) {
+            double a = base(rng), b = power(rng);
+            int64_t distance = ulpDistance(calcpp::math::pow(a, b), std::pow(a, b));
+            exact += distance == 0;
+            worst = std::max(worst, distance);
+        }
+        std::printf("%-8s %10zu %9.3f%% %8lld\n", "pow", samples, 100.0 * exact / samples,
+                    static_cast<long long>(worst));
+        if (worst > 1) failures++;
+    }
+
+    // Cost per evaluation of a fixed formula
+    const std::string text(FORMULA.getSource());
+    constexpr auto formula = calcpp::bind<FORMULA>("a", "b", "c");
+    volatile double a = 0.7, b = -1.3, c = 2.5;
+    volatile double sink = 0;
+    Parser parser;
+    std::unordered_map<std::string, double> variables{{"a", a}, {"b", b}, {"c", c}};
+    parser.setVariables(&variables);
+    Expression expr = parser.compile(text);
+    std::vector<double> values = expr.bindVariables(variables);
+    std::vector<double> registers;
+    double slots[] = {a, b, c};
+
+    std::printf("\n%-36s %10s\n", text.c_str(), "ns/call");
+    std::printf("%-36s %10.1f\n", "Parser::parse (compile + evaluate)", nanosecondsPer([&] { sink = parser.parse(text); }));
+    std::printf("%-36s %10.1f\n", "Expression::evaluate", nanosecondsPer([&] {
+        values[0] = a;
+        sink = expr.evaluate(values.data(), registers);
+    }));
+    std::printf("%-36s %10.1f\n", "calcpp::Program::evaluate", nanosecondsPer([&] {
+        slots[0] = a;
+        sink = FORMULA.evaluate(slots);
+    }));
+    std::printf("%-36s %10.1f\n", "calcpp::bind (specialized)", nanosecondsPer([&] { sink = formula(a, b, c); }));
+    std::printf("%-36s %10.1f\n", "hand-written C++", nanosecondsPer([&] {
+        double x = a, y = b, z = c;
+        sink = (x * y + std::pow(std::sin(x), 2)) / (1 + std::pow(z, 2)) - std::sqrt(std::pow(x, 2) + std::pow(y, 2));
+    }));
+    if (formula(a, b, c) != expr.evaluate(values.data())) failures++;
+
+    return failures ? 1 : 0;
+}
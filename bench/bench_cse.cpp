@@ -0,0 +1,153 @@
+// Common subexpression sharing on generated expressions: node counts with
+// and without hash-consing, and the resulting evaluation speed for scalar
+// evaluation, batch evaluation, and a batch of several expressions compiled
+// into one DAG.
+#include "parser.h"
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+const char* const VARIABLES[] = {"a", "b", "c", "d"};
+
+// A small random subterm such as "sin(a*b)" or "(c-d)/(a+2)"
+std::string subterm(std::mt19937_64& rng, int depth) {
+    if (depth == 0) {
+        if (rng() % 4 == 0) return std::to_string(rng() % 9 + 1);
+        return VARIABLES[rng() % 4];
+    }
+    static const char* const functions[] = {"sin", "cos", "exp", "sqrt", "ln"};
+    static const char* const operators[] = {"+", "-", "*", "/"};
+    if (rng() % 3 == 0) {
+        std::string inner = subterm(rng, depth - 1);
+        const char* f = functions[rng() % 5];
+        // Keep sqrt and ln on positive arguments
+        if (f[0] == 's' && f[1] == 'q') return "sqrt(" + inner + "^2+1)";
+        if (f[0] == 'l') return "ln(" + inner + "^2+1)";
+        return std::string(f) + "(" + inner + ")";
+    }
+    return "(" + subterm(rng, depth - 1) + operators[rng() % 4] + subterm(rng, depth - 1) + ")";
+}
+
+// `terms` products of pool entries; with a small pool each subterm repeats
+// many times, as in machine-generated formulas
+std::string formula(std::mt19937_64& rng, const std::vector<std::string>& pool, size_t terms) {
+    std::string text;
+    for (size_t t = 0; t < terms; t++) {
+        if (t > 0) text += (rng() % 2) ? "+" : "-";
+        text += pool[rng() % pool.size()] + "*" + pool[rng() % pool.size()];
+    }
+    return text;
+}
+
+template <class F>
+double secondsPer(F&& run, size_t& iterations) {
+    iterations = 0;
+    auto start = std::chrono::steady_clock::now();
+    double seconds = 0.0;
+    do {
+        run();
+        iterations++;
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    } while (seconds < 0.2);
+    return seconds / iterations;
+}
+
+} // namespace
+
+int main() {
+    std::mt19937_64 rng(2024);
+    std::vector<std::string> pool;
+    for (int i = 0; i < 12; i++) pool.push_back(subterm(rng, 3));
+
+    const size_t batchRows = 512;
+    std::vector<std::vector<double>> columns(4, std::vector<double>(batchRows));
+    for (auto& column : columns) {
+        for (auto& v : column) v = std::uniform_real_distribution<double>(0.5, 2.0)(rng);
+    }
+    const double values[] = {0.7, 1.3, 0.4, 1.9};
+    std::vector<double> out(batchRows);
+    std::vector<double> registers;
+
+    std::printf("single expression\n");
+    std::printf("%8s %10s %10s %12s %12s %10s %10s\n", "terms", "nodes", "shared", "eval ns", "shared ns",
+                "scalar x", "batch x");
+    for (size_t terms : {10, 40, 200, 1000}) {
+        std::string text = formula(rng, pool, terms);
+        double evalSeconds[2], batchSeconds[2];
+        size_t nodeCounts[2];
+        for (int shared = 0; shared < 2; shared++) {
+            Parser parser;
+            parser.setHashConsing(shared != 0);
+            Expression expr = parser.compile(text);
+            nodeCounts[shared] = expr.getNodes().size();
+
+            // Variable slots follow first use; map them to the fixed columns
+            std::vector<double> slotValues;
+            std::vector<const double*> slotColumns;
+            for (const auto& name : expr.getVariableNames()) {
+                slotValues.push_back(values[name[0] - 'a']);
+                slotColumns.push_back(columns[name[0] - 'a'].data());
+            }
+            size_t iterations;
+            volatile double sink = 0;
+            evalSeconds[shared] = secondsPer([&] { sink = expr.evaluate(slotValues.data(), registers); },
+                                             iterations);
+            batchSeconds[shared] = secondsPer([&] {
+                expr.evaluateBatch(slotColumns.data(), batchRows, out.data(), registers);
+            }, iterations);
+        }
+        std::printf("%8zu %10zu %10zu %12.0f %12.0f %9.1fx %9.1fx\n", terms, nodeCounts[0], nodeCounts[1],
+                    evalSeconds[0] * 1e9, evalSeconds[1] * 1e9, evalSeconds[0] / evalSeconds[1],
+                    batchSeconds[0] / batchSeconds[1]);
+    }
+
+    // Several outputs over the same subterms, as in a --csv run with many --expr
+    std::printf("\nbatch of expressions (%zu rows per call)\n", batchRows);
+    std::printf("%8s %10s %10s %12s %12s %10s\n", "exprs", "nodes", "shared", "separate us", "one dag us",
+                "speedup");
+    for (size_t count : {4, 16, 64}) {
+        std::vector<std::string> texts;
+        for (size_t i = 0; i < count; i++) texts.push_back(formula(rng, pool, 20));
+
+        Parser separateParser;
+        separateParser.setHashConsing(false);
+        std::vector<Expression> separate;
+        size_t separateNodes = 0;
+        for (const auto& text : texts) {
+            separate.push_back(separateParser.compile(text));
+            separateNodes += separate.back().getNodes().size();
+        }
+        Parser parser;
+        Expression combined;
+        for (const auto& text : texts) parser.compileInto(text, combined);
+
+        std::vector<std::vector<double>> outs(count, std::vector<double>(batchRows));
+        std::vector<double*> outPointers;
+        for (auto& o : outs) outPointers.push_back(o.data());
+        auto slotsOf = [&](const Expression& expr) {
+            std::vector<const double*> slots;
+            for (const auto& name : expr.getVariableNames()) slots.push_back(columns[name[0] - 'a'].data());
+            return slots;
+        };
+        std::vector<std::vector<const double*>> separateSlots;
+        for (const auto& expr : separate) separateSlots.push_back(slotsOf(expr));
+        std::vector<const double*> combinedSlots = slotsOf(combined);
+
+        size_t iterations;
+        double separateSeconds = secondsPer([&] {
+            for (size_t i = 0; i < count; i++) {
+                separate[i].evaluateBatch(separateSlots[i].data(), batchRows, outPointers[i], registers);
+            }
+        }, iterations);
+        double combinedSeconds = secondsPer([&] {
+            combined.evaluateBatch(combinedSlots.data(), batchRows, outPointers.data(), registers);
+        }, iterations);
+        std::printf("%8zu %10zu %10zu %12.1f %12.1f %9.1fx\n", count, separateNodes, combined.getNodes().size(),
+                    separateSeconds * 1e6, combinedSeconds * 1e6, separateSeconds / combinedSeconds);
+    }
+    return 0;
+}
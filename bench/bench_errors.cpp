@@ -0,0 +1,54 @@
+// Error-heavy batch: throwing Calculator::calculate() versus the
+// exception-free C API on the same inputs (mostly malformed).
+#include "calcpp.h"
+#include "calculator.h"
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+int main() {
+    const std::vector<std::string> inputs = {
+        "1 + * 2", "sin(", "3 $ 4", "(1+2", "1/0", "foo + 1", "pow(2 3)", "2 +",
+        "sqrt(16) + 2^10", "5 % 0", "[1, 2", "1e400", "(((1)))", "cos 2", "x*2", "3.5*(2-1)"
+    };
+    const int rounds = 20000;
+
+    size_t failures = 0;
+    auto start = std::chrono::steady_clock::now();
+    Calculator calculator;
+    for (int r = 0; r < rounds; r++) {
+        for (const auto& input : inputs) {
+            try {
+                calculator.calculate(input);
+            } catch (const std::exception&) {
+                failures++;
+            }
+        }
+    }
+    double throwing = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    size_t codes = 0;
+    start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++) {
+        for (const auto& input : inputs) {
+            calcpp_error error;
+            calcpp_expr* expr = calcpp_compile_n(input.data(), input.size(), &error);
+            if (expr == nullptr) {
+                codes++;
+                continue;
+            }
+            double result;
+            if (calcpp_eval(expr, &result, &error) != CALCPP_OK) codes++;
+            calcpp_free(expr);
+        }
+    }
+    double coded = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    double total = static_cast<double>(rounds) * inputs.size();
+    std::printf("inputs: %zu (%.0f%% malformed or failing)\n", inputs.size(), 100.0 * failures / total);
+    std::printf("exceptions (Calculator::calculate): %8.1f ns/input\n", throwing / total * 1e9);
+    std::printf("status codes (calcpp_compile/eval): %8.1f ns/input\n", coded / total * 1e9);
+    std::printf("speedup: %.2fx   (failures %zu vs %zu)\n", throwing / coded, failures, codes);
+    return 0;
+}
@@ -0,0 +1,187 @@
+// Single precision: throughput of the float kernels against the double ones
+// for the default instruction set, with their maximum error in float ulps
+// against libm's double result rounded to float; then rows per second of
+// evaluateBatch in float and double for a few expressions, with the largest
+// relative error of the float results over every row. Finally checks that
+// float results are printed with 9 significant digits at any magnitude.
+#include "accuracy_report.h"
+#include "calculator.h"
+#include "expression.h"
+#include "parser.h"
+#include "vector_math.h"
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+using Isa = VectorMath::Isa;
+
+struct Function {
+    const char* name;
+    VectorMath::UnaryKernel VectorMath::Kernels::* unary;
+    VectorMath::UnaryKernelF VectorMath::FloatKernels::* unaryFloat;
+    double (*reference)(double);
+    double low;
+    double high;
+};
+
+const Function FUNCTIONS[] = {
+    {"sin", &VectorMath::Kernels::sin, &VectorMath::FloatKernels::sin, [](double x) { return std::sin(x); }, -100.0, 100.0},
+    {"cos", &VectorMath::Kernels::cos, &VectorMath::FloatKernels::cos, [](double x) { return std::cos(x); }, -100.0, 100.0},
+    {"tan", &VectorMath::Kernels::tan, &VectorMath::FloatKernels::tan, [](double x) { return std::tan(x); }, -100.0, 100.0},
+    {"asin", &VectorMath::Kernels::asin, &VectorMath::FloatKernels::asin, [](double x) { return std::asin(x); }, -1.0, 1.0},
+    {"acos", &VectorMath::Kernels::acos, &VectorMath::FloatKernels::acos, [](double x) { return std::acos(x); }, -1.0, 1.0},
+    {"atan", &VectorMath::Kernels::atan, &VectorMath::FloatKernels::atan, [](double x) { return std::atan(x); }, -100.0, 100.0},
+    {"exp", &VectorMath::Kernels::exp, &VectorMath::FloatKernels::exp, [](double x) { return std::exp(x); }, -87.0, 88.0},
+    {"ln", &VectorMath::Kernels::ln, &VectorMath::FloatKernels::ln, [](double x) { return std::log(x); }, 1e-6, 1e6},
+    {"log10", &VectorMath::Kernels::log10, &VectorMath::FloatKernels::log10, [](double x) { return std::log10(x); }, 1e-6, 1e6},
+    {"sqrt", &VectorMath::Kernels::sqrt, &VectorMath::FloatKernels::sqrt, [](double x) { return std::sqrt(x); }, 0.0, 1e6},
+};
+
+const char* const EXPRESSIONS[] = {
+    "x * 2.5 + 1",
+    "sin(x) * cos(x / 3)",
+    "exp(-x^2 / 2) / sqrt(2 * pi)",
+    "ln(1 + x^2) + atan(x)",
+    "sqrt(x^2 + 1) * tan(x / 10)",
+};
+
+// Float results as the float32 CSV and table paths print them (precision 15)
+struct Formatted {
+    float value;
+    const char* text;
+};
+
+const Formatted FORMATTED[] = {
+    {1e-12f, "0.000000000001"},
+    {2.5e-10f, "0.00000000025"},
+    {1.0f / 3.0f, "0.333333343"},
+    {1000000.125f, "1000000.12"},
+    {3000000.0f, "3000000"},
+    {-123456.789f, "-123456.789"},
+    {16777216.0f, "16777216"},
+    {1e20f, "100000002004087734272"},
+};
+
+int32_t orderedFloat(float x) {
+    int32_t i;
+    std::memcpy(&i, &x, sizeof(i));
+    return i < 0 ? INT32_MIN - i : i;
+}
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Elements per second of kernel(x, out) over repeated passes
+template <typename T, typename Kernel>
+double elementsPerSecond(Kernel kernel, const std::vector<T>& x, std::vector<T>& out) {
+    size_t elements = 0;
+    auto start = std::chrono::steady_clock::now();
+    double seconds = 0.0;
+    do {
+        for (int r = 0; r < 64; r++) {
+            kernel(x.data(), out.data(), x.size());
+            elements += x.size();
+        }
+        seconds = secondsSince(start);
+    } while (seconds < 0.2);
+    return elements / seconds;
+}
+
+// Rows per second of evaluateBatch over `rows` values of x in 512-row chunks
+template <typename T>
+double rowsPerSecond(const Expression& expr, const std::vector<T>& x, std::vector<T>& y) {
+    const size_t chunk = 512;
+    std::vector<T> registers;
+    size_t rows = 0;
+    auto start = std::chrono::steady_clock::now();
+    double seconds = 0.0;
+    do {
+        for (size_t first = 0; first < x.size(); first += chunk) {
+            size_t n = std::min(chunk, x.size() - first);
+            const T* columns[] = {x.data() + first};
+            expr.evaluateBatch(columns, n, y.data() + first, registers);
+        }
+        rows += x.size();
+        seconds = secondsSince(start);
+    } while (seconds < 0.3);
+    return rows / seconds;
+}
+
+} // namespace
+
+int main() {
+    Isa isa = VectorMath::getIsa();
+    const VectorMath::Kernels* kernels = VectorMath::getKernels(isa);
+    const VectorMath::FloatKernels* floatKernels = VectorMath::getFloatKernels(isa);
+    std::printf("instruction set: %s\n\n", VectorMath::isaName(isa));
+
+    std::printf("%-7s %12s %12s %8s %10s\n", "kernel", "double M/s", "float M/s", "speedup", "max ulp");
+    std::mt19937_64 rng(5);
+    std::vector<double> x(4096), out(4096);
+    std::vector<float> xf(4096), outf(4096);
+    for (const auto& function : FUNCTIONS) {
+        std::uniform_real_distribution<double> domain(function.low, function.high);
+        for (size_t i = 0; i < x.size(); i++) {
+            xf[i] = static_cast<float>(domain(rng));
+            x[i] = xf[i];
+        }
+        double doubleRate = elementsPerSecond(kernels->*function.unary, x, out);
+        double floatRate = elementsPerSecond(floatKernels->*function.unaryFloat, xf, outf);
+
+        // Accuracy over a larger random sample
+        uint32_t maxUlp = 0;
+        std::vector<float> inputs(1 << 20), results(1 << 20);
+        for (auto& v : inputs) v = static_cast<float>(domain(rng));
+        (floatKernels->*function.unaryFloat)(inputs.data(), results.data(), inputs.size());
+        for (size_t i = 0; i < inputs.size(); i++) {
+            float expected = static_cast<float>(function.reference(inputs[i]));
+            if (std::isnan(expected) || std::isnan(results[i])) continue;
+            int64_t difference = int64_t(orderedFloat(expected)) - orderedFloat(results[i]);
+            maxUlp = std::max(maxUlp, static_cast<uint32_t>(difference < 0 ? -difference : difference));
+        }
+        std::printf("%-7s %12.1f %12.1f %7.2fx %10u\n", function.name, doubleRate / 1e6, floatRate / 1e6,
+                    floatRate / doubleRate, maxUlp);
+    }
+
+    const size_t rows = 1 << 20;
+    std::vector<double> column(rows), exact(rows);
+    std::vector<float> columnFloat(rows), approximate(rows);
+    std::uniform_real_distribution<double> domain(-10.0, 10.0);
+    for (size_t i = 0; i < rows; i++) {
+        column[i] = domain(rng);
+        columnFloat[i] = static_cast<float>(column[i]);
+    }
+
+    std::printf("\n%-32s %12s %12s %8s %14s\n", "evaluateBatch (x in [-10, 10])", "double Mr/s", "float Mr/s",
+                "speedup", "max rel error");
+    Parser parser;
+    for (const char* text : EXPRESSIONS) {
+        Expression expr = parser.compile(text);
+        double doubleRate = rowsPerSecond(expr, column, exact);
+        double floatRate = rowsPerSecond(expr, columnFloat, approximate);
+        AccuracyReport accuracy;
+        for (size_t i = 0; i < rows; i++) accuracy.add(exact[i], approximate[i]);
+        std::printf("%-32s %12.1f %12.1f %7.2fx %14.3g\n", text, doubleRate / 1e6, floatRate / 1e6,
+                    floatRate / doubleRate, accuracy.maxRelativeError);
+    }
+
+    size_t wrong = 0;
+    for (const auto& f : FORMATTED) {
+        char number[Calculator::FORMAT_BUFFER_SIZE];
+        std::string text(number, Calculator::formatSignificant(f.value, 9, 15, number));
+        if (text != f.text) {
+            std::printf("  %.9g printed as %s, expected %s\n", f.value, text.c_str(), f.text);
+            wrong++;
+        }
+    }
+    std::printf("\nfloat formatting: %zu of %zu values wrong\n", wrong, sizeof(FORMATTED) / sizeof(FORMATTED[0]));
+    return wrong == 0 ? 0 : 1;
+}
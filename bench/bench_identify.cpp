@@ -0,0 +1,97 @@
+// Closed-form index: build time and size, a check that every stored
+// expression evaluates to exactly its stored value, a sample parsed back
+// with either sign, and query latency for values that have a closed form
+// and for random values that do not.
+#include "closed_form_index.h"
+#include "parser.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::string path = argc > 1 ? argv[1] : "bench_identify.idx";
+
+    auto start = std::chrono::steady_clock::now();
+    ClosedFormIndex::BuildStats stats = ClosedFormIndex::build(path);
+    double buildSeconds = secondsSince(start);
+    std::printf("build    %zu candidates, %zu entries, %.1f MB in %.2f s\n", stats.candidates, stats.entries,
+                stats.bytes / 1e6, buildSeconds);
+
+    start = std::chrono::steady_clock::now();
+    ClosedFormIndex index(path);
+    std::printf("open     %.1f us (memory-mapped)\n", secondsSince(start) * 1e6);
+
+    // Every stored expression must evaluate to exactly its stored value
+    Parser parser;
+    size_t mismatched = 0;
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < index.size(); i++) {
+        ClosedFormIndex::Match match = index.entry(i);
+        double parsed = parser.compile(match.expression).evaluate(nullptr);
+        if (parsed != match.value) {
+            if (mismatched++ < 5) std::printf("  %s = %.17g, index has %.17g\n", match.expression.c_str(), parsed, match.value);
+        }
+    }
+    std::printf("entries  %zu expressions evaluated, %zu differ from the stored value (%.2f s)\n", index.size(),
+                mismatched, secondsSince(start));
+
+    // Signed queries parse back to their value; sample the index
+    std::mt19937_64 rng(7);
+    size_t checked = 0, wrong = 0;
+    std::vector<double> known;
+    for (size_t i = 0; i < 20000; i++) {
+        double value = std::exp(std::uniform_real_distribution<double>(-7.0, 7.0)(rng));
+        ClosedFormIndex::Match match = index.nearest(i % 2 ? -value : value);
+        double parsed = parser.compile(match.expression).evaluate(nullptr);
+        checked++;
+        if (std::abs(parsed - match.value) > 1e-13 * std::abs(match.value)) {
+            if (wrong++ < 5) std::printf("  %s = %.17g, index has %.17g\n", match.expression.c_str(), parsed, match.value);
+        }
+        known.push_back(match.value * (1 + 1e-15));
+    }
+    std::printf("verify   %zu expressions parsed back, %zu wrong\n", checked, wrong);
+
+    const char* const examples[] = {"sqrt(3)", "pi^2/6", "(1+sqrt(5))/2", "ln(2)/ln(3)", "(sqrt(3)-1)/2",
+                                    "4*atan(1)/3", "sqrt(2)/2", "1/(2*pi*e)", "-3*2^(1/3)"};
+    std::printf("\n%-16s %-28s %s\n", "input", "identified as", "relative error");
+    for (const char* text : examples) {
+        double value = parser.compile(text).evaluate(nullptr);
+        std::vector<ClosedFormIndex::Match> matches = index.identify(value);
+        if (matches.empty()) {
+            std::printf("%-16s %-28s nearest %s\n", text, "-", index.nearest(value).expression.c_str());
+        } else {
+            std::printf("%-16s %-28s %.3g\n", text, matches[0].expression.c_str(), matches[0].relativeError);
+        }
+    }
+
+    // Latency: hits (values with a closed form) and misses (random values)
+    std::vector<double> random;
+    for (size_t i = 0; i < known.size(); i++) {
+        random.push_back(std::exp(std::uniform_real_distribution<double>(-7.0, 7.0)(rng)));
+    }
+    std::printf("\n%-34s %12s %12s\n", "queries (tolerance 1e-10)", "us/query", "found");
+    for (int pass = 0; pass < 2; pass++) {
+        const std::vector<double>& queries = pass == 0 ? known : random;
+        size_t found = 0;
+        start = std::chrono::steady_clock::now();
+        for (double value : queries) {
+            found += index.identify(value).empty() ? 0 : 1;
+        }
+        double seconds = secondsSince(start);
+        std::printf("%-34s %12.2f %11.1f%%\n", pass == 0 ? "closed forms" : "random values",
+                    seconds / queries.size() * 1e6, 100.0 * found / queries.size());
+    }
+    std::remove(path.c_str());
+    return wrong == 0 && mismatched == 0 ? 0 : 1;
+}
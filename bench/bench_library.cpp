@@ -0,0 +1,103 @@
+// Definition libraries: time to load a generated library of 50k definitions
+// by parsing it (no cache), the first time (parsing plus writing the cache)
+// and from the cache, and a check that cached values match the parsed ones.
+#include "calculator.h"
+#include "definition_library.h"
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <string>
+
+namespace {
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Constants, formulas over earlier definitions, vectors and, every thousand
+// lines, a noise definition that draws a random number
+void writeLibrary(const std::string& path, size_t count) {
+    std::ofstream out(path);
+    std::mt19937_64 rng(3);
+    std::uniform_real_distribution<double> number(0.5, 100.0);
+    out << "# generated by bench_library\n";
+    char line[256];
+    for (size_t i = 0; i < count; i++) {
+        size_t a = i > 0 ? rng() % i : 0;
+        size_t b = i > 0 ? rng() % i : 0;
+        switch (i < 2 ? 0 : i % 8) {
+            case 0:
+            case 1:
+            case 2:
+                std::snprintf(line, sizeof(line), "c%zu = %.17g", i, number(rng));
+                break;
+            case 3:
+                std::snprintf(line, sizeof(line), "c%zu = c%zu * %.6g + c%zu / 3", i, a, number(rng), b);
+                break;
+            case 4:
+                std::snprintf(line, sizeof(line), "c%zu = sqrt(c%zu^2 + c%zu^2)  # hypotenuse", i, a, b);
+                break;
+            case 5:
+                std::snprintf(line, sizeof(line), "c%zu = ln(1 + abs(c%zu)) * sin(c%zu / 7) + pi", i, a, b);
+                break;
+            case 6:
+                std::snprintf(line, sizeof(line), "c%zu = exp(-abs(c%zu) / 50) * phi", i, a);
+                if (i % 1000 == 6) out << "noise" << i << " = c" << a << " + 0.001 * randn()\n";
+                break;
+            default:
+                std::snprintf(line, sizeof(line), "c%zu = [%.6g, %.6g, %.6g]", i, number(rng), number(rng),
+                              number(rng));
+                break;
+        }
+        out << line << "\n";
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::string path = argc > 1 ? argv[1] : "bench_library.calc";
+    const size_t count = 50000;
+    const int repeats = 5;
+    writeLibrary(path, count);
+    std::string cache = DefinitionLibrary::cachePath(path);
+    std::remove(cache.c_str());
+
+    std::printf("%zu definitions + noise\n\n%-28s %12s\n", count, "load", "ms");
+    Calculator parsed;
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < repeats; r++) DefinitionLibrary::load(path, parsed, false);
+    std::printf("%-28s %12.2f\n", "parse, no cache", secondsSince(start) / repeats * 1e3);
+
+    Calculator cold;
+    start = std::chrono::steady_clock::now();
+    DefinitionLibrary::Stats stats = DefinitionLibrary::load(path, cold);
+    std::printf("%-28s %12.2f\n", "cold (parse, write cache)", secondsSince(start) * 1e3);
+    if (!stats.cacheWritten) {
+        std::printf("could not write %s\n", cache.c_str());
+        return 1;
+    }
+
+    Calculator warm;
+    start = std::chrono::steady_clock::now();
+    for (int r = 0; r < repeats; r++) stats = DefinitionLibrary::load(path, warm);
+    std::printf("%-28s %12.2f\n", "warm (cache)", secondsSince(start) / repeats * 1e3);
+    std::printf("\n%zu definitions re-evaluated on every load, from cache: %s\n", stats.reevaluated,
+                stats.fromCache ? "yes" : "no");
+
+    // Cached values must be exactly the parsed ones
+    size_t wrong = 0;
+    for (size_t i = 0; i < count; i++) {
+        std::string name = "c" + std::to_string(i);
+        if (cold.hasMatrix(name)) {
+            if (cold.formatValue(cold.evaluate(name)) != warm.formatValue(warm.evaluate(name))) wrong++;
+        } else if (cold.getVariable(name) != warm.getVariable(name)) {
+            wrong++;
+        }
+    }
+    std::printf("verify   %zu definitions compared, %zu differ\n", count, wrong);
+    std::remove(cache.c_str());
+    std::remove(path.c_str());
+    return wrong == 0 && stats.fromCache ? 0 : 1;
+}
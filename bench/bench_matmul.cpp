@@ -0,0 +1,81 @@
+// Matrix multiply throughput in GFLOP/s at several sizes for each
+// instruction set the CPU supports, compared with a naive triple loop for
+// the smaller sizes.
+#include "matrix.h"
+#include "vector_math.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace {
+
+void naiveMatmul(size_t n, const double* a, const double* b, double* c) {
+    for (size_t i = 0; i < n; i++) {
+        for (size_t j = 0; j < n; j++) {
+            double sum = 0.0;
+            for (size_t p = 0; p < n; p++) sum += a[i * n + p] * b[p * n + j];
+            c[i * n + j] = sum;
+        }
+    }
+}
+
+template <typename F>
+double bestSeconds(F&& f, int repeats) {
+    double best = 1e300;
+    for (int r = 0; r < repeats; r++) {
+        auto start = std::chrono::steady_clock::now();
+        f();
+        auto end = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double>(end - start).count());
+    }
+    return best;
+}
+
+} // namespace
+
+int main() {
+    std::mt19937_64 rng(42);
+    std::uniform_real_distribution<double> dist(-1.0, 1.0);
+
+    // The blocked kernel follows VectorMath's instruction set
+    std::vector<VectorMath::Isa> isas;
+    for (VectorMath::Isa isa : {VectorMath::Isa::SSE2, VectorMath::Isa::AVX2, VectorMath::Isa::AVX512}) {
+        if (VectorMath::isSupported(isa)) isas.push_back(isa);
+    }
+    if (isas.empty()) isas.push_back(VectorMath::getIsa());
+
+    std::printf("%6s", "n");
+    for (VectorMath::Isa isa : isas) std::printf(" %9s GF/s", VectorMath::isaName(isa));
+    std::printf(" %14s %12s\n", "naive GF/s", "max|diff|");
+    for (size_t n : {64, 128, 256, 512, 1024, 2048}) {
+        std::vector<double> a(n * n), b(n * n), c(n * n), ref(n * n);
+        for (auto& v : a) v = dist(rng);
+        for (auto& v : b) v = dist(rng);
+
+        double flops = 2.0 * n * n * n;
+        int repeats = n <= 256 ? 10 : 3;
+        double naive = 0.0;
+        if (n <= 512) {
+            naive = bestSeconds([&] { naiveMatmul(n, a.data(), b.data(), ref.data()); }, n <= 256 ? 3 : 1);
+        }
+        std::printf("%6zu", n);
+        double diff = 0.0;
+        for (VectorMath::Isa isa : isas) {
+            VectorMath::setIsa(isa);
+            double blocked = bestSeconds([&] { matmulKernel(n, n, n, a.data(), b.data(), c.data()); }, repeats);
+            std::printf(" %14.2f", flops / blocked * 1e-9);
+            if (n <= 512) {
+                for (size_t i = 0; i < n * n; i++) diff = std::max(diff, std::abs(c[i] - ref[i]));
+            }
+        }
+
+        if (n <= 512) {
+            std::printf(" %14.2f %12.2e\n", flops / naive * 1e-9, diff);
+        } else {
+            std::printf(" %14s %12s\n", "-", "-");
+        }
+    }
+    return 0;
+}
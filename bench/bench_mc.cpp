@@ -0,0 +1,109 @@
+// Monte Carlo throughput in samples per second: the generators on their
+// own (against std::mt19937_64 with <random> distributions), a scalar loop
+// around Expression::evaluate as an external driver would write it, and
+// MonteCarlo on one thread and on all cores. Also checks that a fixed seed
+// gives bit-identical results for every thread count.
+#include "monte_carlo.h"
+#include "parser.h"
+#include "random.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+template <class F>
+double secondsFor(F&& run) {
+    auto start = std::chrono::steady_clock::now();
+    run();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool sameBits(double a, double b) {
+    return std::memcmp(&a, &b, sizeof(double)) == 0;
+}
+
+} // namespace
+
+int main() {
+    const size_t samples = 10000000;
+    const std::unordered_map<std::string, double> variables;
+    volatile double sink = 0;
+
+    std::printf("generators (%zu samples)\n", samples);
+    std::printf("%-32s %14s\n", "", "samples/s");
+    std::vector<double> buffer(4096);
+    auto generatorRate = [&](const char* name, auto&& fill) {
+        double seconds = secondsFor([&] {
+            for (size_t done = 0; done < samples; done += buffer.size()) fill(buffer.data(), buffer.size());
+        });
+        sink = buffer[0];
+        std::printf("%-32s %14.3g\n", name, samples / seconds);
+    };
+    std::mt19937_64 mt(42);
+    std::uniform_real_distribution<double> uniform;
+    std::normal_distribution<double> normal;
+    Random random(42);
+    generatorRate("mt19937_64 uniform", [&](double* out, size_t n) {
+        for (size_t i = 0; i < n; i++) out[i] = uniform(mt);
+    });
+    generatorRate("xoshiro256** uniform", [&](double* out, size_t n) { random.fillUniform(out, n); });
+    generatorRate("mt19937_64 normal_distribution", [&](double* out, size_t n) {
+        for (size_t i = 0; i < n; i++) out[i] = normal(mt);
+    });
+    generatorRate("xoshiro256** normal, scalar", [&](double* out, size_t n) {
+        for (size_t i = 0; i < n; i++) out[i] = random.normal();
+    });
+    generatorRate("xoshiro256** normal, vectorized", [&](double* out, size_t n) { random.fillNormal(out, n); });
+
+    const char* const expressions[] = {
+        "rand()",
+        "4*(1-floor(rand()^2+rand()^2))",
+        "100*exp(-0.02+0.2*randn())",
+        "sqrt(randn()^2+randn()^2+randn()^2)",
+    };
+    unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    std::printf("\nexpressions (%zu samples, %u cores)\n", samples, cores);
+    std::printf("%-38s %12s %12s %12s %14s\n", "", "scalar loop", "mc 1 thread", "mc all", "mean");
+    bool identical = true;
+    for (const char* text : expressions) {
+        Parser parser;
+        Expression expr = parser.compile(text);
+        std::vector<double> registers;
+        double scalarSeconds = secondsFor([&] {
+            double sum = 0;
+            for (size_t i = 0; i < samples; i++) sum += expr.evaluate(nullptr, registers);
+            sink = sum;
+        });
+
+        MonteCarlo::Options options;
+        options.expression = text;
+        options.samples = samples;
+        options.seed = 2024;
+        options.threads = 1;
+        MonteCarlo::Result single;
+        double singleSeconds = secondsFor([&] { single = MonteCarlo(options, variables).run(); });
+        options.threads = cores;
+        MonteCarlo::Result all;
+        double allSeconds = secondsFor([&] { all = MonteCarlo(options, variables).run(); });
+
+        // Odd thread counts and oversubscription must not change the result
+        for (unsigned threads : {3u, 7u, 64u}) {
+            options.threads = threads;
+            MonteCarlo::Result other = MonteCarlo(options, variables).run();
+            identical = identical && sameBits(other.mean, single.mean) &&
+                        sameBits(other.variance, single.variance) && other.samples == single.samples;
+        }
+        identical = identical && sameBits(all.mean, single.mean) && sameBits(all.variance, single.variance);
+
+        std::printf("%-38s %12.3g %12.3g %12.3g %14.8g\n", text, samples / scalarSeconds,
+                    samples / singleSeconds, samples / allSeconds, single.mean);
+    }
+    std::printf("\nidentical results for 1, 3, 7, 64 and %u threads: %s\n", cores, identical ? "yes" : "NO");
+    return identical ? 0 : 1;
+}
@@ -0,0 +1,74 @@
+// Parser throughput on ~10 MB expressions: deep nesting, long flat sums,
+// chains of unary minus and nested function calls. The parser keeps its
+// own stack, so none of these depend on the native stack size.
+#include "parser.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::string deepParens(size_t bytes) {
+    size_t depth = (bytes - 1) / 2;
+    return std::string(depth, '(') + "1" + std::string(depth, ')');
+}
+
+std::string flatSum(size_t bytes) {
+    std::string text = "1";
+    text.reserve(bytes + 8);
+    while (text.size() < bytes) text += "+2*x";
+    return text;
+}
+
+std::string unaryChain(size_t bytes) {
+    return std::string(bytes - 1, '-') + "1";
+}
+
+std::string nestedCalls(size_t bytes) {
+    // sin(cos(sin(...x...)))
+    size_t depth = (bytes - 1) / 5;
+    std::string text;
+    text.reserve(bytes);
+    for (size_t i = 0; i < depth; i++) text += (i % 2) ? "cos(" : "sin(";
+    text += "x";
+    text.append(depth, ')');
+    return text;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t megabytes = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10;
+    size_t bytes = megabytes << 20;
+
+    struct Case {
+        const char* name;
+        std::string text;
+    };
+    std::vector<Case> cases = {
+        {"deep parens", deepParens(bytes)},
+        {"flat sum", flatSum(bytes)},
+        {"unary minus", unaryChain(bytes)},
+        {"nested calls", nestedCalls(bytes)},
+    };
+
+    Parser parser;
+    std::printf("%-14s %10s %12s %10s %12s\n", "input", "MB", "nodes", "ms", "MB/s");
+    for (const auto& c : cases) {
+        Expression expr;
+        CalcError error;
+        auto start = std::chrono::steady_clock::now();
+        bool ok = parser.tryCompile(c.text.data(), c.text.size(), expr, error);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (!ok) {
+            std::printf("%-14s failed: %s at %zu\n", c.name, error.message.c_str(), error.offset);
+            return 1;
+        }
+        double mb = c.text.size() / 1048576.0;
+        std::printf("%-14s %10.1f %12zu %10.1f %12.1f\n",
+                    c.name, mb, expr.getNodes().size(), seconds * 1e3, mb / seconds);
+    }
+    return 0;
+}
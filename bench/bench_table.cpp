@@ -0,0 +1,93 @@
+// Table generation throughput in rows/s, as CSV and as raw doubles, next to
+// the plain write bandwidth of the output so the two can be compared. The
+// output defaults to the null device; pass a path to measure a real disk.
+#include "calculator.h"
+#include "table_generator.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#if defined(_WIN32)
+static const char* NULL_DEVICE = "NUL";
+#else
+static const char* NULL_DEVICE = "/dev/null";
+#endif
+
+int main(int argc, char* argv[]) {
+    size_t millions = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10;
+    std::string path = argc > 2 ? argv[2] : NULL_DEVICE;
+    double rows = static_cast<double>(millions) * 1e6;
+
+    struct Case {
+        const char* name;
+        const char* expression;
+        TableGenerator::Format format;
+        int precision;
+    };
+    const Case cases[] = {
+        {"csv, 6 digits", "sin(x) * exp(-x / 4)", TableGenerator::Format::CSV, 6},
+        {"csv, 15 digits", "sin(x) * exp(-x / 4)", TableGenerator::Format::CSV, 15},
+        {"binary", "sin(x) * exp(-x / 4)", TableGenerator::Format::BINARY, 15},
+        {"binary, poly", "((3 * x + 2) * x - 5) * x + 1", TableGenerator::Format::BINARY, 15},
+    };
+
+    std::printf("%zu M rows -> %s\n", millions, path.c_str());
+    std::printf("%-16s %-10s %10s %10s %10s\n", "table", "threads", "s", "Mrows/s", "MB/s");
+    size_t largestOutput = 0;
+    for (const auto& c : cases) {
+        for (unsigned threads : {1u, 0u}) {
+            TableGenerator::Options options;
+            options.expression = c.expression;
+            options.variable = "x";
+            options.start = 0.0;
+            options.stop = 10.0;
+            options.step = 10.0 / (rows - 1);
+            options.format = c.format;
+            options.precision = c.precision;
+            options.threads = threads;
+
+            std::FILE* out = std::fopen(path.c_str(), "wb");
+            if (!out) {
+                std::perror("fopen");
+                return 1;
+            }
+            TableGenerator generator(options, {});
+            auto start = std::chrono::steady_clock::now();
+            TableGenerator::Stats stats = generator.run(out);
+            std::fclose(out);
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            largestOutput = std::max(largestOutput, stats.bytes);
+            std::printf("%-16s %-10s %10.3f %10.1f %10.1f\n", c.name, threads == 1 ? "1" : "all",
+                        seconds, stats.rows / seconds * 1e-6, stats.bytes / seconds / 1048576.0);
+        }
+    }
+
+    // Ceiling: writing the same amount of already formatted bytes
+    std::vector<char> block(size_t(4) << 20, '7');
+    std::FILE* out = std::fopen(path.c_str(), "wb");
+    auto start = std::chrono::steady_clock::now();
+    for (size_t written = 0; written < largestOutput; written += block.size()) {
+        std::fwrite(block.data(), 1, block.size(), out);
+    }
+    std::fclose(out);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::printf("%-16s %-10s %10.3f %10s %10.1f\n", "write only", "", seconds, "",
+                largestOutput / seconds / 1048576.0);
+
+    // Baseline: one calculate() per point, as a script calling calcpp would do
+    Calculator calculator;
+    size_t baselineRows = 200000;
+    start = std::chrono::steady_clock::now();
+    for (size_t r = 0; r < baselineRows; r++) {
+        std::string x = std::to_string(r * 10.0 / baselineRows);
+        calculator.calculate("sin(" + x + ") * exp(-" + x + " / 4)");
+    }
+    seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::printf("per-point calculate(): %.2f Mrows/s\n", baselineRows / seconds * 1e-6);
+
+    if (path != NULL_DEVICE) std::remove(path.c_str());
+    return 0;
+}
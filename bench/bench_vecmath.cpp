@@ -0,0 +1,222 @@
+// Accuracy and throughput of the vector math kernels.
+//
+// Accuracy: every instruction set the CPU supports is compared with libm on
+// a sweep over float32 inputs (every 256th bit pattern, or all of them with
+// --exhaustive) and on random doubles from each function's main domain.
+// Reports the maximum error in ulps and any disagreement on NaN/infinity.
+// Throughput: elements per second for libm and each kernel build.
+#include "vector_math.h"
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+using Isa = VectorMath::Isa;
+
+struct Function {
+    const char* name;
+    VectorMath::UnaryKernel VectorMath::Kernels::* unary;
+    double low;                 // random domain
+    double high;
+    bool logarithmic;           // sample the exponent uniformly
+    bool symmetric;             // logarithmic samples of either sign
+};
+
+const Function FUNCTIONS[] = {
+    {"sin", &VectorMath::Kernels::sin, -100.0, 100.0, false, false},
+    {"cos", &VectorMath::Kernels::cos, -100.0, 100.0, false, false},
+    {"tan", &VectorMath::Kernels::tan, -100.0, 100.0, false, false},
+    {"asin", &VectorMath::Kernels::asin, -1.0, 1.0, false, false},
+    {"acos", &VectorMath::Kernels::acos, -1.0, 1.0, false, false},
+    {"atan", &VectorMath::Kernels::atan, 1e-10, 1e10, true, true},
+    {"exp", &VectorMath::Kernels::exp, -708.0, 708.0, false, false},
+    {"ln", &VectorMath::Kernels::ln, 1e-300, 1e300, true, false},
+    {"log10", &VectorMath::Kernels::log10, 1e-300, 1e300, true, false},
+    {"sqrt", &VectorMath::Kernels::sqrt, 1e-300, 1e300, true, false},
+};
+
+int64_t ordered(double x) {
+    int64_t i;
+    std::memcpy(&i, &x, sizeof(i));
+    return i < 0 ? INT64_MIN - i : i;
+}
+
+struct Accuracy {
+    uint64_t maxUlp = 0;
+    double worstInput = 0.0;
+    double worstInput2 = 0.0;
+    size_t mismatches = 0;      // NaN-ness differs
+    size_t count = 0;
+
+    void add(double expected, double actual, double input, double input2 = 0.0) {
+        count++;
+        bool expectedNan = std::isnan(expected);
+        if (expectedNan || std::isnan(actual)) {
+            if (expectedNan != std::isnan(actual)) mismatches++;
+            return;
+        }
+        int64_t a = ordered(expected);
+        int64_t b = ordered(actual);
+        uint64_t ulp = a > b ? static_cast<uint64_t>(a) - static_cast<uint64_t>(b)
+                             : static_cast<uint64_t>(b) - static_cast<uint64_t>(a);
+        if (ulp > maxUlp) {
+            maxUlp = ulp;
+            worstInput = input;
+            worstInput2 = input2;
+        }
+    }
+};
+
+double sample(std::mt19937_64& rng, double low, double high, bool logarithmic, bool symmetric = false) {
+    if (!logarithmic) return std::uniform_real_distribution<double>(low, high)(rng);
+    double e = std::uniform_real_distribution<double>(std::log(low), std::log(high))(rng);
+    double sign = (symmetric && (rng() & 1)) ? -1.0 : 1.0;
+    return sign * std::exp(e);
+}
+
+// Float32 bit patterns with the given stride, widened to double
+std::vector<double> floatSweep(uint64_t stride) {
+    std::vector<double> values;
+    values.reserve(static_cast<size_t>((uint64_t(1) << 32) / stride) + 1);
+    for (uint64_t bits = 0; bits < (uint64_t(1) << 32); bits += stride) {
+        uint32_t b = static_cast<uint32_t>(bits);
+        float f;
+        std::memcpy(&f, &b, sizeof(f));
+        values.push_back(f);
+    }
+    return values;
+}
+
+void checkUnary(const Function& function, const std::vector<const VectorMath::Kernels*>& builds,
+                const std::vector<double>& sweep, size_t randomCount) {
+    const VectorMath::Kernels* libm = VectorMath::getKernels(Isa::LIBM);
+    std::mt19937_64 rng(42);
+    std::vector<double> inputs(sweep);
+    for (size_t i = 0; i < randomCount; i++) {
+        inputs.push_back(sample(rng, function.low, function.high, function.logarithmic, function.symmetric));
+    }
+
+    std::vector<double> expected(inputs.size());
+    std::vector<double> actual(inputs.size());
+    (libm->*function.unary)(inputs.data(), expected.data(), inputs.size());
+    for (const auto* build : builds) {
+        (build->*function.unary)(inputs.data(), actual.data(), inputs.size());
+        Accuracy accuracy;
+        for (size_t i = 0; i < inputs.size(); i++) {
+            accuracy.add(expected[i], actual[i], inputs[i]);
+        }
+        std::printf("  %-6s %-7s max %3llu ulp  (at %.17g)  nan mismatches %zu  of %zu\n",
+                    function.name, VectorMath::isaName(build->isa),
+                    static_cast<unsigned long long>(accuracy.maxUlp), accuracy.worstInput,
+                    accuracy.mismatches, accuracy.count);
+    }
+}
+
+void checkPow(const std::vector<const VectorMath::Kernels*>& builds, const std::vector<double>& sweep,
+              size_t randomCount) {
+    const VectorMath::Kernels* libm = VectorMath::getKernels(Isa::LIBM);
+    const double exponents[] = {-3.5, -2.0, -1.0, -0.5, 0.0, 1.0 / 3, 0.5, 1.0, 2.0, 3.0, 10.0, 100.5};
+    std::vector<double> xs, ys;
+    for (size_t i = 0; i < sweep.size(); i += 8) {
+        for (double y : exponents) {
+            xs.push_back(sweep[i]);
+            ys.push_back(y);
+        }
+    }
+    std::mt19937_64 rng(7);
+    for (size_t i = 0; i < randomCount; i++) {
+        xs.push_back(sample(rng, 1e-10, 1e10, true));
+        ys.push_back(sample(rng, -30.0, 30.0, false));
+        // Large |y*ln(x)| exercises the double-double path
+        xs.push_back(sample(rng, 0.5, 2.0, false));
+        ys.push_back(sample(rng, -1000.0, 1000.0, false));
+    }
+
+    std::vector<double> expected(xs.size());
+    std::vector<double> actual(xs.size());
+    libm->pow(xs.data(), ys.data(), expected.data(), xs.size());
+    for (const auto* build : builds) {
+        build->pow(xs.data(), ys.data(), actual.data(), xs.size());
+        Accuracy accuracy;
+        for (size_t i = 0; i < xs.size(); i++) {
+            accuracy.add(expected[i], actual[i], xs[i], ys[i]);
+        }
+        std::printf("  %-6s %-7s max %3llu ulp  (at %.17g ^ %.17g)  nan mismatches %zu  of %zu\n",
+                    "pow", VectorMath::isaName(build->isa),
+                    static_cast<unsigned long long>(accuracy.maxUlp), accuracy.worstInput,
+                    accuracy.worstInput2, accuracy.mismatches, accuracy.count);
+    }
+}
+
+double elementsPerSecond(const VectorMath::Kernels* build, const Function* function,
+                         const std::vector<double>& x, const std::vector<double>& y, std::vector<double>& out) {
+    size_t elements = 0;
+    auto start = std::chrono::steady_clock::now();
+    double seconds = 0.0;
+    do {
+        for (int r = 0; r < 64; r++) {
+            if (function) {
+                (build->*function->unary)(x.data(), out.data(), x.size());
+            } else {
+                build->pow(x.data(), y.data(), out.data(), x.size());
+            }
+            elements += x.size();
+        }
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    } while (seconds < 0.2);
+    return elements / seconds;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    bool exhaustive = argc > 1 && std::string(argv[1]) == "--exhaustive";
+
+    std::vector<const VectorMath::Kernels*> builds;
+    const Isa isas[] = {Isa::SCALAR, Isa::SSE2, Isa::AVX2, Isa::AVX512};
+    for (Isa isa : isas) {
+        if (VectorMath::isSupported(isa)) builds.push_back(VectorMath::getKernels(isa));
+    }
+    std::printf("default: %s\n\n", VectorMath::isaName(VectorMath::getIsa()));
+
+    std::vector<double> sweep = floatSweep(exhaustive ? 1 : 256);
+    size_t randomCount = 1000000;
+    std::printf("accuracy vs libm (%zu float32 inputs%s + %zu random)\n", sweep.size(),
+                exhaustive ? ", exhaustive" : "", randomCount);
+    for (const auto& function : FUNCTIONS) {
+        checkUnary(function, builds, sweep, randomCount);
+    }
+    checkPow(builds, sweep, randomCount / 2);
+
+    std::printf("\nthroughput (Melem/s, 4096-element arrays)\n%-7s", "");
+    builds.insert(builds.begin(), VectorMath::getKernels(Isa::LIBM));
+    for (const auto* build : builds) std::printf(" %9s", VectorMath::isaName(build->isa));
+    std::printf("\n");
+
+    std::mt19937_64 rng(1);
+    std::vector<double> x(4096), y(4096), out(4096);
+    for (const auto& function : FUNCTIONS) {
+        for (auto& v : x) v = sample(rng, function.low, function.high, function.logarithmic, function.symmetric);
+        std::printf("%-7s", function.name);
+        for (const auto* build : builds) {
+            std::printf(" %9.1f", elementsPerSecond(build, &function, x, y, out) / 1e6);
+        }
+        std::printf("\n");
+    }
+    for (size_t i = 0; i < x.size(); i++) {
+        x[i] = sample(rng, 1e-5, 1e5, true);
+        y[i] = sample(rng, -10.0, 10.0, false);
+    }
+    std::printf("%-7s", "pow");
+    for (const auto* build : builds) {
+        std::printf(" %9.1f", elementsPerSecond(build, nullptr, x, y, out) / 1e6);
+    }
+    std::printf("\n");
+    return 0;
+}
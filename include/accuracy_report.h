@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "expression.h"
+
+// Error of a reduced-precision result against the double one, accumulated
+// over sampled rows. The relative error is |approximate - exact| / |exact|,
+// or the absolute error when exact is zero. Rows where both are the same
+// (including both NaN) count as exact; a finite value on one side only
+// counts as infinite error.
+struct AccuracyReport {
+    size_t sampledRows = 0;
+    double maxRelativeError = 0.0;
+    double worstExact = 0.0;        // the row that produced maxRelativeError
+    double worstApproximate = 0.0;
+
+    // One sampled row, with one value or with `values` values
+    void add(double exact, double approximate);
+    void add(const double* exact, const double* approximate, size_t values);
+    void merge(const AccuracyReport& other);
+};
+
+// Keeps every SAMPLE_STRIDE-th row of a float evaluation (its double inputs
+// and float results) and evaluates those rows again in double. Rows are
+// numbered by the caller, so the sample does not depend on chunk sizes.
+// Expressions that use rand() or randn() are not sampled.
+class AccuracySampler {
+public:
+    static constexpr size_t SAMPLE_STRIDE = 509;
+
+    AccuracySampler(const Expression& expr, size_t outputs);
+
+    // `count` rows numbered from `first`: inputs[slot] holds the values of
+    // variable slot, results[i] the float results of output i
+    void addChunk(size_t first, size_t count, const double* const* inputs, const float* const* results);
+    // Evaluates the sampled rows in double, adds them to report and clears
+    // the sample
+    void finish(AccuracyReport& report);
+
+private:
+    const Expression& expr;
+    size_t outputs;
+    bool enabled;
+    size_t samples = 0;
+    std::vector<std::vector<double>> inputs;       // per variable slot
+    std::vector<double> results;                   // outputs values per sampled row
+};
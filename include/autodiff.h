@@ -0,0 +1,28 @@
+#pragma once
+
+#include <vector>
+#include "expression.h"
+
+// Automatic differentiation over compiled expressions.
+//
+// Forward mode propagates a dual number (value, derivative) through the node
+// list and yields d(expr)/d(variable) for one variable per sweep.
+// Reverse mode runs one forward sweep to record node values and one backward
+// sweep over the same node list, yielding the full gradient for roughly the
+// cost of two evaluations regardless of the number of variables.
+
+struct Dual {
+    double value;
+    double derivative;
+};
+
+// Forward mode: derivative of expr with respect to variable slot `slot`.
+Dual differentiate(const Expression& expr, const double* values, size_t slot);
+
+// Reverse mode: fills gradient[0 .. expr.getVariableCount()) and returns
+// the value of the expression.
+double gradient(const Expression& expr, const double* values, double* gradient);
+
+// Reverse mode with caller-owned scratch buffers, for repeated calls.
+double gradient(const Expression& expr, const double* values, double* gradient,
+                std::vector<double>& registers, std::vector<double>& adjoints);
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdio>
+#include <functional>
+#include <string>
+
+// Runs produce(index, buffer) for blocks 0..blockCount-1 on `threads`
+// worker threads and writes each buffer to `out` in block order from the
+// calling thread. Workers stay at most `blocksInFlight` blocks ahead of the
+// writer, which bounds memory for arbitrarily long outputs. The first
+// exception thrown by produce stops the run and is rethrown as
+// std::runtime_error once the workers have finished.
+void writeBlocksInOrder(size_t blockCount, unsigned threads, size_t blocksInFlight,
+                        const std::function<void(size_t index, std::string& buffer)>& produce,
+                        std::FILE* out);
@@ -0,0 +1,106 @@
+/*
+ * libcalcpp - C API
+ *
+ * Compile an expression once, bind its variables, evaluate it as often as
+ * needed. No function in this API throws or aborts: failures are reported
+ * as a calcpp_status together with the byte offset of the offending token
+ * in the source expression.
+ *
+ *     calcpp_error err;
+ *     calcpp_expr* e = calcpp_compile("x^2 + 1", &err);
+ *     if (!e) { fprintf(stderr, "%s at %zu\n", err.message, err.offset); }
+ *     calcpp_bind(e, "x", 3.0);
+ *     double y;
+ *     if (calcpp_eval(e, &y, &err) == CALCPP_OK) { ... }
+ *     calcpp_free(e);
+ */
+#ifndef CALCPP_H
+#define CALCPP_H
+
+#include <stddef.h>
+
+#if defined(_WIN32) && defined(CALCPP_SHARED)
+#  if defined(CALCPP_BUILDING_LIBRARY)
+#    define CALCPP_API __declspec(dllexport)
+#  else
+#    define CALCPP_API __declspec(dllimport)
+#  endif
+#elif defined(__GNUC__) && defined(CALCPP_SHARED)
+#  define CALCPP_API __attribute__((visibility("default")))
+#else
+#  define CALCPP_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CALCPP_API_VERSION 1
+
+typedef enum calcpp_status {
+    CALCPP_OK = 0,
+    CALCPP_ERR_UNKNOWN_CHARACTER,
+    CALCPP_ERR_INVALID_NUMBER,
+    CALCPP_ERR_UNEXPECTED_TOKEN,
+    CALCPP_ERR_EXPECTED_LPAREN,
+    CALCPP_ERR_EXPECTED_RPAREN,
+    CALCPP_ERR_EXPECTED_RBRACKET,
+    CALCPP_ERR_EXPECTED_COMMA,
+    CALCPP_ERR_UNKNOWN_FUNCTION,
+    CALCPP_ERR_UNDEFINED_VARIABLE,
+    CALCPP_ERR_DIVISION_BY_ZERO,
+    CALCPP_ERR_MODULO_BY_ZERO,
+    CALCPP_ERR_UNSUPPORTED_OPERATION,
+    CALCPP_ERR_INVALID_ARGUMENT = 100,
+    CALCPP_ERR_OUT_OF_MEMORY,
+    CALCPP_ERR_BUFFER_TOO_SMALL
+} calcpp_status;
+
+typedef struct calcpp_error {
+    calcpp_status status;
+    size_t offset;          /* byte offset into the source expression */
+    char message[128];      /* NUL-terminated, possibly truncated */
+} calcpp_error;
+
+typedef struct calcpp_expr calcpp_expr;
+
+/* Compilation. Returns NULL on failure and fills *error (if non-NULL). */
+CALCPP_API calcpp_expr* calcpp_compile(const char* source, calcpp_error* error);
+CALCPP_API calcpp_expr* calcpp_compile_n(const char* source, size_t length, calcpp_error* error);
+CALCPP_API void calcpp_free(calcpp_expr* expr);
+
+/* Variables, numbered in order of first appearance. */
+CALCPP_API size_t calcpp_variable_count(const calcpp_expr* expr);
+CALCPP_API const char* calcpp_variable_name(const calcpp_expr* expr, size_t index);
+CALCPP_API int calcpp_variable_index(const calcpp_expr* expr, const char* name);
+CALCPP_API calcpp_status calcpp_bind(calcpp_expr* expr, const char* name, double value);
+CALCPP_API calcpp_status calcpp_bind_index(calcpp_expr* expr, size_t index, double value);
+
+/* Evaluation with the currently bound values. All variables must be bound. */
+CALCPP_API calcpp_status calcpp_eval(calcpp_expr* expr, double* result, calcpp_error* error);
+
+/* Evaluate count rows; columns[i] holds the values of variable i. Rows that
+ * would fail (division or modulo by zero) produce NaN. */
+CALCPP_API calcpp_status calcpp_eval_batch(calcpp_expr* expr, const double* const* columns,
+                                           size_t count, double* out);
+/* Same in single precision: constants and intermediate values are float and
+ * the elementary functions use float SIMD kernels (within 3 float ulp of
+ * libm), which process twice as many rows per vector instruction. */
+CALCPP_API calcpp_status calcpp_eval_batch_f32(calcpp_expr* expr, const float* const* columns,
+                                               size_t count, float* out);
+
+/* Format like the calcpp CLI (fixed point, trailing zeros removed).
+ * Writes at most size bytes including the terminating NUL and returns the
+ * length of the formatted number; CALCPP_ERR_BUFFER_TOO_SMALL is reported
+ * through *status when it did not fit. */
+CALCPP_API size_t calcpp_format(double value, int precision, char* buffer, size_t size,
+                                calcpp_status* status);
+
+CALCPP_API const char* calcpp_status_string(calcpp_status status);
+CALCPP_API const char* calcpp_version(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CALCPP_H */
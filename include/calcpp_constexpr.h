@@ -0,0 +1,1213 @@
+#pragma once
+
+// Header-only, constexpr version of the calcpp tokenizer and parser for
+// formulas that are fixed in C++ source. It accepts the same grammar as
+// Parser (implicit multiplication, left-associative '^', prefix minus
+// binding to the factor, the constants pi, e and phi, √) and builds the
+// same node list, so a formula gives the same value either way.
+//
+//     // Fully constant: evaluated by the compiler
+//     constexpr double area = calcpp::evaluate("pi * 2^2");
+//
+//     // With variables: parsed at compile time, evaluated as straight-line
+//     // code specialized for this formula
+//     static constexpr auto energy = calcpp::compile("m * v^2 / 2");
+//     constexpr auto kinetic = calcpp::bind<energy>("m", "v");
+//     double joules = kinetic(mass, speed);
+//
+// Only scalar expressions are supported; vector literals, the linear
+// algebra functions, rand() and randn() report UNSUPPORTED_OPERATION.
+// Errors are CalcException with the same code, message and byte offset as
+// Parser's; at compile time they surface as a compiler diagnostic.
+//
+// At run time the elementary functions are the <cmath> ones that
+// Expression::evaluate uses. During constant evaluation <cmath> is not
+// available, so calcpp::math provides constexpr versions computed in
+// double-double arithmetic. Those are correctly rounded in practice (the
+// trigonometric functions for |x| < 2^50), so they can differ from glibc
+// by its own error: 1 ulp, 2 for log10. A result that is infinite or NaN
+// is not a constant expression and is rejected by the compiler.
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <utility>
+#include "error.h"
+#include "expression.h"
+
+#if defined(__has_builtin)
+#  if __has_builtin(__builtin_is_constant_evaluated)
+#    define CALCPP_HAS_CONSTANT_EVALUATED 1
+#  endif
+#endif
+#if !defined(CALCPP_HAS_CONSTANT_EVALUATED) && \
+    ((defined(__GNUC__) && __GNUC__ >= 9) || (defined(_MSC_VER) && _MSC_VER >= 1925))
+#  define CALCPP_HAS_CONSTANT_EVALUATED 1
+#endif
+
+#if defined(__has_builtin)
+#  if __has_builtin(__builtin_copysign)
+#    define CALCPP_HAS_COPYSIGN 1
+#  endif
+#endif
+#if !defined(CALCPP_HAS_COPYSIGN) && defined(__GNUC__)
+#  define CALCPP_HAS_COPYSIGN 1
+#endif
+
+// Without the builtin the constexpr math is used at run time as well
+#if defined(CALCPP_HAS_CONSTANT_EVALUATED)
+#  define CALCPP_CONSTANT_EVALUATED() __builtin_is_constant_evaluated()
+#else
+#  define CALCPP_CONSTANT_EVALUATED() true
+#endif
+
+namespace calcpp {
+
+using Op = Expression::Op;
+
+namespace detail {
+
+constexpr double INF = std::numeric_limits<double>::infinity();
+constexpr double NOT_A_NUMBER = std::numeric_limits<double>::quiet_NaN();
+
+// 2^k for -1022 <= k <= 1023, exactly
+constexpr double pow2(int k) {
+    double result = 1.0;
+    double base = k < 0 ? 0.5 : 2.0;
+    for (unsigned n = k < 0 ? -k : k; n; n >>= 1) {
+        if (n & 1) result *= base;
+        if (n > 1) base *= base;
+    }
+    return result;
+}
+
+// x * 2^k; exact unless the result is subnormal, which is rounded once
+constexpr double scale(double x, int k) {
+    if (k > 1023) return x * pow2(1023) * pow2(k - 1023);
+    if (k < -1022) return x * pow2(k + 64) * pow2(-64);
+    return x * pow2(k);
+}
+
+// Splits positive finite x into m * 2^exponent with m in [1, 2)
+constexpr double normalize(double x, int& exponent) {
+    exponent = 0;
+    while (x >= 0x1p64) { x *= 0x1p-64; exponent += 64; }
+    while (x >= 2.0) { x *= 0.5; exponent++; }
+    while (x < 0x1p-64) { x *= 0x1p64; exponent -= 64; }
+    while (x < 1.0) { x *= 2.0; exponent--; }
+    return x;
+}
+
+// Unevaluated sum hi + lo with |lo| <= ulp(hi) / 2: about 106 significant
+// bits, enough for the elementary functions to round correctly almost
+// always. The products use Dekker's splitting and need |x| < 2^996.
+struct DoubleDouble {
+    double hi;
+    double lo;
+};
+
+constexpr DoubleDouble quickTwoSum(double a, double b) {
+    double s = a + b;
+    return {s, b - (s - a)};
+}
+
+constexpr DoubleDouble twoSum(double a, double b) {
+    double s = a + b;
+    double v = s - a;
+    return {s, (a - (s - v)) + (b - v)};
+}
+
+constexpr DoubleDouble split(double a) {
+    double t = 134217729.0 * a;   // 2^27 + 1
+    double hi = t - (t - a);
+    return {hi, a - hi};
+}
+
+constexpr DoubleDouble twoProduct(double a, double b) {
+    double p = a * b;
+    DoubleDouble x = split(a);
+    DoubleDouble y = split(b);
+    return {p, ((x.hi * y.hi - p) + x.hi * y.lo + x.lo * y.hi) + x.lo * y.lo};
+}
+
+constexpr DoubleDouble operator+(DoubleDouble a, DoubleDouble b) {
+    DoubleDouble s = twoSum(a.hi, b.hi);
+    DoubleDouble t = twoSum(a.lo, b.lo);
+    s = quickTwoSum(s.hi, s.lo + t.hi);
+    return quickTwoSum(s.hi, s.lo + t.lo);
+}
+
+constexpr DoubleDouble operator-(DoubleDouble a) {
+    return {-a.hi, -a.lo};
+}
+
+constexpr DoubleDouble operator-(DoubleDouble a, DoubleDouble b) {
+    return a + -b;
+}
+
+constexpr DoubleDouble operator*(DoubleDouble a, DoubleDouble b) {
+    DoubleDouble p = twoProduct(a.hi, b.hi);
+    return quickTwoSum(p.hi, p.lo + (a.hi * b.lo + a.lo * b.hi));
+}
+
+constexpr DoubleDouble operator/(DoubleDouble a, DoubleDouble b) {
+    double q1 = a.hi / b.hi;
+    DoubleDouble r = a - b * DoubleDouble{q1, 0.0};
+    double q2 = r.hi / b.hi;
+    r = r - b * DoubleDouble{q2, 0.0};
+    double q3 = r.hi / b.hi;
+    return quickTwoSum(q1, q2) + DoubleDouble{q3, 0.0};
+}
+
+constexpr DoubleDouble scale(DoubleDouble x, int k) {
+    return {x.hi * pow2(k), x.lo * pow2(k)};
+}
+
+constexpr DoubleDouble LN2{0.6931471805599453, 2.3190468138462996e-17};
+constexpr double LN2_TAIL = 5.707708438416212e-34;
+constexpr DoubleDouble LN10{2.302585092994046, -2.1707562233822494e-16};
+constexpr DoubleDouble PI{3.141592653589793, 1.2246467991473532e-16};
+constexpr DoubleDouble HALF_PI{1.5707963267948966, 6.123233995736766e-17};
+constexpr double HALF_PI_TAIL = -1.4973849048591698e-33;
+constexpr double SQRT2 = 1.4142135623730951;
+
+// Sign of x including that of zero, which no comparison can tell. GCC does
+// not treat a division by zero as a constant expression, so the builtin is
+// preferred where there is one.
+constexpr bool signBit(double x) {
+#if defined(CALCPP_HAS_COPYSIGN)
+    return __builtin_copysign(1.0, x) < 0;
+#else
+    return x < 0 || (x == 0 && 1.0 / x < 0);
+#endif
+}
+
+// Series are summed until the next term no longer affects 106 bits
+constexpr bool negligible(DoubleDouble term, DoubleDouble sum) {
+    double t = term.hi < 0 ? -term.hi : term.hi;
+    double s = sum.hi < 0 ? -sum.hi : sum.hi;
+    return t <= s * 1e-34;
+}
+
+// Sign of m - c*c, exactly, for c near sqrt(m) and m in [1, 4)
+constexpr int compareSquare(double m, double c) {
+    DoubleDouble square = twoProduct(c, c);
+    double excess = m - square.hi;    // exact: the two are within a factor 2
+    return excess > square.lo ? 1 : (excess < square.lo ? -1 : 0);
+}
+
+} // namespace detail
+
+// constexpr counterparts of the <cmath> functions the evaluator uses
+namespace math {
+
+constexpr bool isNaN(double x) {
+    return x != x;
+}
+
+constexpr double abs(double x) {
+    return x < 0 ? -x : x + 0.0;   // + 0.0 turns -0 into +0
+}
+
+constexpr double floor(double x) {
+    if (isNaN(x) || x == 0 || abs(x) >= 0x1p52) return x;
+    double t = static_cast<double>(static_cast<long long>(x));
+    return t > x ? t - 1.0 : t;
+}
+
+constexpr double ceil(double x) {
+    return -floor(-x);
+}
+
+// Halfway cases away from zero, like std::round
+constexpr double round(double x) {
+    if (isNaN(x) || abs(x) >= 0x1p52) return x;
+    if (x < 0) return -round(-x);
+    double t = floor(x);
+    return x - t >= 0.5 ? t + 1.0 : t;
+}
+
+// Exact, like std::fmod: binary long division of |a| by |b|
+constexpr double fmod(double a, double b) {
+    if (isNaN(a) || isNaN(b) || a == detail::INF || a == -detail::INF || b == 0) return detail::NOT_A_NUMBER;
+    double remainder = abs(a);
+    double divisor = abs(b);
+    if (divisor == detail::INF || remainder < divisor) return a;
+    double step = divisor;
+    while (step <= remainder - step) step *= 2.0;
+    while (step >= divisor) {
+        if (remainder >= step) remainder -= step;
+        step *= 0.5;
+    }
+    return a < 0 ? -remainder : remainder;
+}
+
+// Correctly rounded, like std::sqrt
+constexpr double sqrt(double x) {
+    if (isNaN(x) || x == 0 || x == detail::INF) return x;
+    if (x < 0) return detail::NOT_A_NUMBER;
+    int exponent = 0;
+    double m = detail::normalize(x, exponent);
+    if (exponent % 2 != 0) {
+        m *= 2.0;
+        exponent--;
+    }
+    // Newton's iteration on m in [1, 4) leaves r within an ulp of sqrt(m)
+    double r = 1.5;
+    for (int i = 0; i < 6; i++) r = 0.5 * (r + m / r);
+    const double ulp = 0x1p-52;
+    if (r >= 2.0) r = 2.0 - ulp;
+    if (r < 1.0) r = 1.0;
+    while (detail::compareSquare(m, r) < 0) r -= ulp;
+    while (r + ulp < 2.0 && detail::compareSquare(m, r + ulp) >= 0) r += ulp;
+    // Round up when m > (r + ulp/2)^2 = r^2 + r*ulp + ulp^2/4. Every term is
+    // a multiple of 2^-106 below 2^-48, so the test is exact in 64 bits.
+    detail::DoubleDouble square = detail::twoProduct(r, r);
+    long long excess = static_cast<long long>((m - square.hi) * 0x1p106) -
+                       static_cast<long long>(square.lo * 0x1p106) -
+                       static_cast<long long>(r * ulp * 0x1p106) - 1;
+    if (excess > 0) r += ulp;
+    return r * detail::pow2(exponent / 2);
+}
+
+} // namespace math
+
+namespace detail {
+
+constexpr DoubleDouble sqrt(DoubleDouble a) {
+    double s = math::sqrt(a.hi);
+    DoubleDouble residual = a - twoProduct(s, s);
+    return quickTwoSum(s, residual.hi / (2.0 * s));
+}
+
+// e^x for |x| < 746; the result is scaled by 2^k only at the end
+constexpr DoubleDouble exp(DoubleDouble x, int& k) {
+    double n = math::round(x.hi / LN2.hi);
+    k = static_cast<int>(n);
+    DoubleDouble r = x - twoProduct(n, LN2.hi) - twoProduct(n, LN2.lo) - DoubleDouble{n * LN2_TAIL, 0.0};
+    // expm1 of r / 2^10 by its series, then (1 + s)^2 - 1 = s * (s + 2)
+    // ten times; tracking expm1 keeps the small terms exact
+    r = scale(r, -10);
+    DoubleDouble term = r;
+    DoubleDouble sum = r;
+    for (int i = 2; i <= 12; i++) {
+        term = term * r / DoubleDouble{static_cast<double>(i), 0.0};
+        sum = sum + term;
+    }
+    for (int i = 0; i < 10; i++) {
+        sum = sum * (sum + DoubleDouble{2.0, 0.0});
+    }
+    return sum + DoubleDouble{1.0, 0.0};
+}
+
+// ln x for positive finite x
+constexpr DoubleDouble log(double x) {
+    int exponent = 0;
+    double m = normalize(x, exponent);
+    if (m > SQRT2) {
+        m *= 0.5;
+        exponent++;
+    }
+    // ln m = 2 atanh(t) with t = (m - 1) / (m + 1), |t| < 0.172
+    DoubleDouble t = DoubleDouble{m - 1.0, 0.0} / twoSum(m, 1.0);
+    DoubleDouble t2 = t * t;
+    DoubleDouble power = t;
+    DoubleDouble sum = t;
+    for (int n = 3; n < 100; n += 2) {
+        power = power * t2;
+        DoubleDouble term = power / DoubleDouble{static_cast<double>(n), 0.0};
+        sum = sum + term;
+        if (negligible(term, sum)) break;
+    }
+    return scale(sum, 1) + LN2 * DoubleDouble{static_cast<double>(exponent), 0.0};
+}
+
+// Reduces x to r in [-pi/4, pi/4] with x = r + quadrant * pi/2. pi/2 is
+// carried to 160 bits, which is exact enough while |x| < 2^50.
+constexpr DoubleDouble reduceQuadrant(double x, int& quadrant) {
+    // Past 2^100 the multiple of pi/2 is beyond double-double; fall back to
+    // the remainder modulo the double nearest 2 pi
+    if (math::abs(x) >= 0x1p100) x = math::fmod(x, 2.0 * PI.hi);
+    double n = math::round(x * 0.6366197723675814);
+    quadrant = static_cast<int>(math::fmod(n, 4.0));
+    if (quadrant < 0) quadrant += 4;
+    return DoubleDouble{x, 0.0} - twoProduct(n, HALF_PI.hi) - twoProduct(n, HALF_PI.lo) -
+           DoubleDouble{n * HALF_PI_TAIL, 0.0};
+}
+
+constexpr DoubleDouble sinSeries(DoubleDouble r) {
+    DoubleDouble r2 = r * r;
+    DoubleDouble term = r;
+    DoubleDouble sum = r;
+    for (int n = 2; n < 60; n += 2) {
+        term = -(term * r2) / DoubleDouble{static_cast<double>(n * (n + 1)), 0.0};
+        sum = sum + term;
+        if (negligible(term, sum)) break;
+    }
+    return sum;
+}
+
+constexpr DoubleDouble cosSeries(DoubleDouble r) {
+    DoubleDouble r2 = r * r;
+    DoubleDouble term{1.0, 0.0};
+    DoubleDouble sum{1.0, 0.0};
+    for (int n = 2; n < 60; n += 2) {
+        term = -(term * r2) / DoubleDouble{static_cast<double>((n - 1) * n), 0.0};
+        sum = sum + term;
+        if (negligible(term, sum)) break;
+    }
+    return sum;
+}
+
+// atan t for t >= 0
+constexpr DoubleDouble atan(DoubleDouble t) {
+    if (t.hi > 1.0) {
+        return HALF_PI - atan(DoubleDouble{1.0, 0.0} / t);
+    }
+    // atan t = 2 atan(t / (1 + sqrt(1 + t^2))), three times: t < 0.1
+    for (int i = 0; i < 3; i++) {
+        t = t / (DoubleDouble{1.0, 0.0} + sqrt(DoubleDouble{1.0, 0.0} + t * t));
+    }
+    DoubleDouble t2 = t * t;
+    DoubleDouble power = t;
+    DoubleDouble sum = t;
+    for (int n = 3; n < 100; n += 2) {
+        power = -(power * t2);
+        DoubleDouble term = power / DoubleDouble{static_cast<double>(n), 0.0};
+        sum = sum + term;
+        if (term.hi == 0 || negligible(term, sum)) break;
+    }
+    return scale(sum, 3);
+}
+
+} // namespace detail
+
+namespace math {
+
+constexpr double exp(double x) {
+    if (isNaN(x)) return x;
+    if (x > 709.782712893384) return detail::INF;
+    if (x < -745.1332191019412) return 0.0;
+    int k = 0;
+    detail::DoubleDouble result = detail::exp(detail::DoubleDouble{x, 0.0}, k);
+    return detail::scale(result.hi, k);
+}
+
+constexpr double log(double x) {
+    if (isNaN(x) || x == detail::INF) return x;
+    if (x < 0) return detail::NOT_A_NUMBER;
+    if (x == 0) return -detail::INF;
+    return detail::log(x).hi;
+}
+
+constexpr double log10(double x) {
+    if (isNaN(x) || x == detail::INF) return x;
+    if (x < 0) return detail::NOT_A_NUMBER;
+    if (x == 0) return -detail::INF;
+    return (detail::log(x) / detail::LN10).hi;
+}
+
+constexpr bool isInteger(double x) {
+    return floor(x) == x;
+}
+
+constexpr bool isOddInteger(double x) {
+    return abs(x) < 0x1p53 && isInteger(x) && fmod(x, 2.0) != 0;
+}
+
+// The special cases follow C99 Annex F, as std::pow does
+constexpr double pow(double a, double b) {
+    const double inf = detail::INF;
+    if (b == 0 || a == 1) return 1.0;
+    if (isNaN(a) || isNaN(b)) return detail::NOT_A_NUMBER;
+    if (b == inf || b == -inf) {
+        double magnitude = abs(a);
+        if (magnitude == 1) return 1.0;
+        return (magnitude > 1) == (b > 0) ? inf : 0.0;
+    }
+    bool odd = isOddInteger(b);
+    if (a == 0 || a == inf || a == -inf) {
+        // b > 0 keeps the magnitude of a, b < 0 inverts it
+        bool large = (a != 0) == (b > 0);
+        double magnitude = large ? inf : 0.0;
+        return odd && detail::signBit(a) ? -magnitude : magnitude;
+    }
+    if (a < 0 && !isInteger(b)) return detail::NOT_A_NUMBER;
+    double base = abs(a);
+    double sign = a < 0 && odd ? -1.0 : 1.0;
+    detail::DoubleDouble logarithm = detail::log(base);
+    // |b| >= 2^64 with a != 1 overflows or underflows whatever a is
+    if (abs(b) >= 0x1p64) {
+        return (logarithm.hi > 0) == (b > 0) ? (sign < 0 ? -inf : inf) : sign * 0.0;
+    }
+    detail::DoubleDouble y = logarithm * detail::DoubleDouble{b, 0.0};
+    if (y.hi > 709.782712893384) return sign < 0 ? -inf : inf;
+    if (y.hi < -745.1332191019412) return sign * 0.0;
+    int k = 0;
+    detail::DoubleDouble result = detail::exp(y, k);
+    return sign * detail::scale(result.hi, k);
+}
+
+constexpr double sin(double x) {
+    if (isNaN(x) || x == 0) return x;
+    if (x == detail::INF || x == -detail::INF) return detail::NOT_A_NUMBER;
+    int quadrant = 0;
+    detail::DoubleDouble r = detail::reduceQuadrant(x, quadrant);
+    switch (quadrant) {
+        case 0:  return detail::sinSeries(r).hi;
+        case 1:  return detail::cosSeries(r).hi;
+        case 2:  return -detail::sinSeries(r).hi;
+        default: return -detail::cosSeries(r).hi;
+    }
+}
+
+constexpr double cos(double x) {
+    if (isNaN(x)) return x;
+    if (x == detail::INF || x == -detail::INF) return detail::NOT_A_NUMBER;
+    int quadrant = 0;
+    detail::DoubleDouble r = detail::reduceQuadrant(x, quadrant);
+    switch (quadrant) {
+        case 0:  return detail::cosSeries(r).hi;
+        case 1:  return -detail::sinSeries(r).hi;
+        case 2:  return -detail::cosSeries(r).hi;
+        default: return detail::sinSeries(r).hi;
+    }
+}
+
+constexpr double tan(double x) {
+    if (isNaN(x) || x == 0) return x;
+    if (x == detail::INF || x == -detail::INF) return detail::NOT_A_NUMBER;
+    int quadrant = 0;
+    detail::DoubleDouble r = detail::reduceQuadrant(x, quadrant);
+    detail::DoubleDouble s = detail::sinSeries(r);
+    detail::DoubleDouble c = detail::cosSeries(r);
+    return (quadrant % 2 == 0 ? s / c : -(c / s)).hi;
+}
+
+constexpr double atan(double x) {
+    if (isNaN(x) || x == 0) return x;
+    double result = detail::HALF_PI.hi;   // also for |x| >= 2^900, where 1/x is negligible
+    if (abs(x) < 0x1p900) result = detail::atan(detail::DoubleDouble{abs(x), 0.0}).hi;
+    return x < 0 ? -result : result;
+}
+
+constexpr double asin(double x) {
+    if (isNaN(x) || x == 0) return x;
+    double a = abs(x);
+    if (a > 1) return detail::NOT_A_NUMBER;
+    double result = detail::HALF_PI.hi;
+    if (a < 1) {
+        // asin a = atan(a / sqrt((1 - a)(1 + a)))
+        detail::DoubleDouble d = detail::sqrt(detail::twoSum(1.0, -a) * detail::twoSum(1.0, a));
+        result = detail::atan(detail::DoubleDouble{a, 0.0} / d).hi;
+    }
+    return x < 0 ? -result : result;
+}
+
+constexpr double acos(double x) {
+    if (isNaN(x)) return x;
+    if (abs(x) > 1) return detail::NOT_A_NUMBER;
+    if (x == 1) return 0.0;
+    if (x == -1) return detail::PI.hi;
+    // acos x = 2 atan(sqrt((1 - x) / (1 + x)))
+    detail::DoubleDouble ratio = detail::twoSum(1.0, -x) / detail::twoSum(1.0, x);
+    return detail::scale(detail::atan(detail::sqrt(ratio)), 1).hi;
+}
+
+} // namespace math
+
+namespace detail {
+
+struct Node {
+    Op op = Op::CONST;
+    uint32_t lhs = 0;       // child node, or variable slot for VAR
+    uint32_t rhs = 0;       // second child for binary operators
+    uint32_t offset = 0;    // byte offset of the originating token
+    double value = 0.0;     // constant value for CONST
+};
+
+// Builds the CalcException at run time; reaching it during constant
+// evaluation makes the expression ill-formed, which the compiler reports
+[[noreturn]] inline void fail(ErrorCode code, size_t offset, std::string message) {
+    CalcError error;
+    error.set(code, offset, std::move(message));
+    throw CalcException(error);
+}
+
+// One scalar operation as Expression::evaluate performs it
+constexpr double apply(const Node& node, double a, double b) {
+    // Not const: a const bool would be initialized as a constant expression
+    // and always be true
+    bool constant = CALCPP_CONSTANT_EVALUATED();
+    switch (node.op) {
+        case Op::NEG:   return -a;
+        case Op::ADD:   return a + b;
+        case Op::SUB:   return a - b;
+        case Op::MUL:   return a * b;
+        case Op::DIV:
+            if (b == 0) fail(ErrorCode::DIVISION_BY_ZERO, node.offset, "Division by zero");
+            return a / b;
+        case Op::MOD:
+            if (b == 0) fail(ErrorCode::MODULO_BY_ZERO, node.offset, "Modulo by zero");
+            return constant ? math::fmod(a, b) : std::fmod(a, b);
+        case Op::POW:   return constant ? math::pow(a, b) : std::pow(a, b);
+        case Op::SIN:   return constant ? math::sin(a) : std::sin(a);
+        case Op::COS:   return constant ? math::cos(a) : std::cos(a);
+        case Op::TAN:   return constant ? math::tan(a) : std::tan(a);
+        case Op::ASIN:  return constant ? math::asin(a) : std::asin(a);
+        case Op::ACOS:  return constant ? math::acos(a) : std::acos(a);
+        case Op::ATAN:  return constant ? math::atan(a) : std::atan(a);
+        case Op::LOG10: return constant ? math::log10(a) : std::log10(a);
+        case Op::LN:    return constant ? math::log(a) : std::log(a);
+        case Op::SQRT:  return constant ? math::sqrt(a) : std::sqrt(a);
+        case Op::ABS:   return constant ? math::abs(a) : std::abs(a);
+        case Op::FLOOR: return constant ? math::floor(a) : std::floor(a);
+        case Op::CEIL:  return constant ? math::ceil(a) : std::ceil(a);
+        case Op::ROUND: return constant ? math::round(a) : std::round(a);
+        case Op::EXP:   return constant ? math::exp(a) : std::exp(a);
+        default:        return a;   // CONST and VAR carry their value in a
+    }
+}
+
+constexpr bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+}
+
+constexpr bool isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+constexpr bool isAlpha(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+// UTF-8 √ (E2 88 9A), which Parser reads as "sqrt"
+constexpr bool isSqrtSign(std::string_view text, size_t i) {
+    return i + 2 < text.size() && text[i] == '\xE2' && text[i + 1] == '\x88' && text[i + 2] == '\x9A';
+}
+
+// Characters of an identifier as Parser sees them, with each √ spelled out
+class Spelling {
+public:
+    constexpr Spelling(std::string_view text, size_t begin, size_t end) : text(text), i(begin), end(end) {}
+
+    constexpr bool atEnd() const { return i >= end; }
+    constexpr char current() const { return isSqrtSign(text, i) ? "sqrt"[inSign] : text[i]; }
+    constexpr void advance() {
+        if (!isSqrtSign(text, i)) {
+            i++;
+        } else if (++inSign == 4) {
+            inSign = 0;
+            i += 3;
+        }
+    }
+    std::string str() const {
+        std::string out;
+        for (Spelling s = *this; !s.atEnd(); s.advance()) out += s.current();
+        return out;
+    }
+
+private:
+    std::string_view text;
+    size_t i;
+    size_t end;
+    size_t inSign = 0;
+};
+
+constexpr bool operator==(Spelling a, Spelling b) {
+    for (; !a.atEnd() && !b.atEnd(); a.advance(), b.advance()) {
+        if (a.current() != b.current()) return false;
+    }
+    return a.atEnd() && b.atEnd();
+}
+
+constexpr Spelling spell(std::string_view name) {
+    return Spelling(name, 0, name.size());
+}
+
+struct FunctionInfo {
+    std::string_view name;
+    Op op;
+    bool binary;
+    bool vector;
+};
+
+// Parser::initializeFunctions
+constexpr FunctionInfo FUNCTIONS[] = {
+    {"sin", Op::SIN, false, false},     {"cos", Op::COS, false, false},
+    {"tan", Op::TAN, false, false},     {"asin", Op::ASIN, false, false},
+    {"acos", Op::ACOS, false, false},   {"atan", Op::ATAN, false, false},
+    {"log", Op::LOG10, false, false},   {"log10", Op::LOG10, false, false},
+    {"ln", Op::LN, false, false},       {"sqrt", Op::SQRT, false, false},
+    {"abs", Op::ABS, false, false},     {"floor", Op::FLOOR, false, false},
+    {"ceil", Op::CEIL, false, false},   {"round", Op::ROUND, false, false},
+    {"exp", Op::EXP, false, false},     {"pow", Op::POW, true, false},
+    {"dot", Op::DOT, true, true},       {"norm", Op::NORM, false, true},
+    {"matmul", Op::MATMUL, true, true}, {"transpose", Op::TRANSPOSE, false, true},
+    {"det", Op::DET, false, true},      {"solve", Op::SOLVE, true, true},
+    {"rand", Op::RAND, false, false},   {"randn", Op::RANDN, false, false},
+};
+
+// A value scaled by 2^shift so that powers of ten up to 10^350 stay within
+// the range where double-double products are exact
+struct ScaledValue {
+    DoubleDouble value;
+    int shift;
+};
+
+constexpr ScaledValue normalize(ScaledValue x) {
+    while (x.value.hi >= 0x1p64) { x.value = scale(x.value, -64); x.shift += 64; }
+    while (x.value.hi < 1.0) { x.value = scale(x.value, 64); x.shift -= 64; }
+    return x;
+}
+
+constexpr ScaledValue multiply(ScaledValue a, ScaledValue b) {
+    return normalize({a.value * b.value, a.shift + b.shift});
+}
+
+constexpr ScaledValue powerOfTen(int n) {
+    ScaledValue result{{1.0, 0.0}, 0};
+    ScaledValue base{{10.0, 0.0}, 0};
+    for (; n; n >>= 1) {
+        if (n & 1) result = multiply(result, base);
+        if (n > 1) base = multiply(base, base);
+    }
+    return result;
+}
+
+// std::strtod on the longest valid prefix of token: false when there are
+// no digits or the value is out of the normal range (strtod's ERANGE)
+constexpr bool parseNumber(std::string_view token, double& value) {
+    uint64_t mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
+    bool anyDigit = false;
+    bool point = false;
+    size_t i = 0;
+    for (; i < token.size(); i++) {
+        char c = token[i];
+        if (c == '.') {
+            if (point) break;
+            point = true;
+            continue;
+        }
+        if (!isDigit(c)) break;
+        anyDigit = true;
+        if (mantissa == 0 && c == '0') {
+            if (point) exponent--;
+        } else if (digits < 19) {
+            mantissa = mantissa * 10 + static_cast<uint64_t>(c - '0');
+            digits++;
+            if (point) exponent--;
+        } else if (!point) {
+            exponent++;
+        }
+    }
+    if (!anyDigit) return false;
+    if (i < token.size() && (token[i] == 'e' || token[i] == 'E')) {
+        size_t j = i + 1;
+        bool negative = j < token.size() && token[j] == '-';
+        if (j < token.size() && (token[j] == '+' || token[j] == '-')) j++;
+        if (j < token.size() && isDigit(token[j])) {
+            int written = 0;
+            for (; j < token.size() && isDigit(token[j]); j++) {
+                if (written < 100000) written = written * 10 + (token[j] - '0');
+            }
+            exponent += negative ? -written : written;
+        }
+    }
+    if (mantissa == 0) {
+        value = 0.0;
+        return true;
+    }
+    int magnitude = digits - 1 + exponent;
+    if (magnitude > 308 || magnitude < -308) return false;
+
+    double hi = static_cast<double>(mantissa);
+    uint64_t rounded = static_cast<uint64_t>(hi);
+    double lo = rounded >= mantissa ? -static_cast<double>(rounded - mantissa)
+                                    : static_cast<double>(mantissa - rounded);
+    ScaledValue m = normalize({quickTwoSum(hi, lo), 0});
+    ScaledValue power = powerOfTen(exponent < 0 ? -exponent : exponent);
+    ScaledValue result = exponent < 0 ? normalize({m.value / power.value, m.shift - power.shift})
+                                      : multiply(m, power);
+    int binaryExponent = 0;
+    double fraction = detail::normalize(result.value.hi, binaryExponent);
+    binaryExponent += result.shift;
+    if (binaryExponent > 1023 || binaryExponent < -1022) return false;
+    value = fraction * pow2(binaryExponent);
+    return true;
+}
+
+enum class TokenKind : uint8_t {
+    NUMBER, IDENTIFIER, FUNCTION,
+    PLUS, MINUS, MUL, DIV, POW, MOD,
+    LPAREN, RPAREN, LBRACKET, RBRACKET, COMMA, ASSIGN,
+    END
+};
+
+struct Token {
+    TokenKind kind = TokenKind::END;
+    uint32_t begin = 0;     // byte offset in the source
+    uint32_t end = 0;
+    double number = 0.0;
+    uint8_t function = 0;   // index into FUNCTIONS
+};
+
+// Parser::Lexer over the source text itself; offsets need no mapping back
+class Lexer {
+public:
+    constexpr explicit Lexer(std::string_view text) : text(text) {}
+
+    constexpr Token next() {
+        while (i < text.size() && isSpace(text[i])) i++;
+        Token token;
+        token.begin = token.end = static_cast<uint32_t>(i);
+        if (i >= text.size()) return token;
+
+        size_t start = i;
+        if (isDigit(text[i]) || text[i] == '.') {
+            while (i < text.size() && (isDigit(text[i]) || text[i] == '.')) i++;
+            if (i < text.size() && (text[i] == 'e' || text[i] == 'E')) {
+                size_t j = i + 1;
+                if (j < text.size() && (text[j] == '+' || text[j] == '-')) j++;
+                if (j < text.size() && isDigit(text[j])) {
+                    i = j;
+                    while (i < text.size() && isDigit(text[i])) i++;
+                }
+            }
+            token.kind = TokenKind::NUMBER;
+            token.end = static_cast<uint32_t>(i);
+            std::string_view literal = text.substr(start, i - start);
+            if (!parseNumber(literal, token.number)) {
+                fail(ErrorCode::INVALID_NUMBER, start, "Invalid number format: " + std::string(literal));
+            }
+            return token;
+        }
+
+        if (isAlpha(text[i]) || isSqrtSign(text, i)) {
+            while (i < text.size() && (isAlpha(text[i]) || isDigit(text[i]) || text[i] == '_' || isSqrtSign(text, i))) {
+                i += isSqrtSign(text, i) ? 3 : 1;
+            }
+            token.kind = TokenKind::IDENTIFIER;
+            token.end = static_cast<uint32_t>(i);
+            Spelling name(text, start, i);
+            if (name == spell("pi")) {
+                token.kind = TokenKind::NUMBER;
+                token.number = 3.14159265358979323846264338327950288;
+            } else if (name == spell("e")) {
+                token.kind = TokenKind::NUMBER;
+                token.number = 2.71828182845904523536028747135266249;
+            } else if (name == spell("phi")) {
+                token.kind = TokenKind::NUMBER;
+                token.number = 1.61803398874989484820458683436563811;
+            } else {
+                for (size_t f = 0; f < sizeof(FUNCTIONS) / sizeof(FUNCTIONS[0]); f++) {
+                    if (name == spell(FUNCTIONS[f].name)) {
+                        token.kind = TokenKind::FUNCTION;
+                        token.function = static_cast<uint8_t>(f);
+                        break;
+                    }
+                }
+            }
+            return token;
+        }
+
+        switch (text[i]) {
+            case '+': token.kind = TokenKind::PLUS; break;
+            case '-': token.kind = TokenKind::MINUS; break;
+            case '*': token.kind = TokenKind::MUL; break;
+            case '/': token.kind = TokenKind::DIV; break;
+            case '^': token.kind = TokenKind::POW; break;
+            case '%': token.kind = TokenKind::MOD; break;
+            case '(': token.kind = TokenKind::LPAREN; break;
+            case ')': token.kind = TokenKind::RPAREN; break;
+            case '[': token.kind = TokenKind::LBRACKET; break;
+            case ']': token.kind = TokenKind::RBRACKET; break;
+            case ',': token.kind = TokenKind::COMMA; break;
+            case '=': token.kind = TokenKind::ASSIGN; break;
+            default:
+                fail(ErrorCode::UNKNOWN_CHARACTER, i, std::string("Unknown character: ") + text[i]);
+        }
+        i++;
+        token.end = static_cast<uint32_t>(i);
+        return token;
+    }
+
+private:
+    std::string_view text;
+    size_t i = 0;
+};
+
+// Parser's stack entries; LIST has no counterpart as vectors are rejected
+enum class Entry : uint8_t { TOP, BINARY, NEGATE, GROUP, FUNCTION };
+
+struct StackEntry {
+    Entry kind = Entry::TOP;
+    Op op = Op::CONST;              // BINARY
+    uint8_t level = 0;              // BINARY precedence
+    uint8_t function = 0;           // FUNCTION: index into FUNCTIONS
+    bool secondArgument = false;    // binary FUNCTION after ','
+    uint32_t offset = 0;            // operator / opening token
+};
+
+constexpr uint8_t LEVEL_SUM = 1;
+constexpr uint8_t LEVEL_PRODUCT = 2;
+constexpr uint8_t LEVEL_POWER = 3;
+
+} // namespace detail
+
+// A compiled scalar expression. Capacity is the longest source it can hold;
+// the node and stack arrays are sized from it, so a Program is a literal
+// type that can live in a constexpr variable.
+template <size_t Capacity>
+class Program {
+public:
+    static constexpr size_t MAX_NODES = 2 * Capacity + 1;
+    static constexpr uint32_t NO_SLOT = UINT32_MAX;
+
+    struct Binding {
+        std::string_view name;
+        double value;
+    };
+
+    constexpr explicit Program(std::string_view source) {
+        if (source.size() > Capacity) {
+            detail::fail(ErrorCode::UNSUPPORTED_OPERATION, Capacity, "Expression exceeds the program capacity");
+        }
+        for (size_t i = 0; i < source.size(); i++) text[i] = source[i];
+        length = source.size();
+        parse();
+    }
+
+    constexpr std::string_view getSource() const { return std::string_view(text.data(), length); }
+    constexpr size_t size() const { return nodeCount; }
+    constexpr const detail::Node& getNode(size_t i) const { return nodes[i]; }
+    constexpr uint32_t getRoot() const { return root; }
+    constexpr size_t getVariableCount() const { return variableCount; }
+    // Byte offset of the first use of variable slot i
+    constexpr size_t getVariableOffset(size_t slot) const { return variables[slot]; }
+    std::string getVariableName(size_t slot) const { return spelling(slot).str(); }
+
+    // Slot of the named variable, or NO_SLOT when the expression has none
+    constexpr uint32_t findVariable(std::string_view name) const {
+        for (size_t slot = 0; slot < variableCount; slot++) {
+            if (spelling(slot) == detail::spell(name)) return static_cast<uint32_t>(slot);
+        }
+        return NO_SLOT;
+    }
+
+    // values[i] is the value of variable slot i
+    constexpr double evaluate(const double* values) const {
+        std::array<double, MAX_NODES> r{};
+        for (size_t i = 0; i < nodeCount; i++) {
+            const detail::Node& node = nodes[i];
+            double a = node.op == Op::CONST ? node.value : node.op == Op::VAR ? values[node.lhs] : r[node.lhs];
+            r[i] = detail::apply(node, a, r[node.rhs]);
+        }
+        return r[root];
+    }
+
+    // Names not used by the expression are ignored, as in bindVariables
+    constexpr double evaluate(std::initializer_list<Binding> bindings) const {
+        std::array<double, Capacity + 1> values{};
+        std::array<bool, Capacity + 1> bound{};
+        for (const Binding& binding : bindings) {
+            uint32_t slot = findVariable(binding.name);
+            if (slot == NO_SLOT) continue;
+            values[slot] = binding.value;
+            bound[slot] = true;
+        }
+        for (size_t slot = 0; slot < variableCount; slot++) {
+            if (!bound[slot]) {
+                detail::fail(ErrorCode::UNDEFINED_VARIABLE, variables[slot], "Variable not defined: " + getVariableName(slot));
+            }
+        }
+        return evaluate(values.data());
+    }
+
+private:
+    std::array<char, Capacity + 1> text{};
+    size_t length = 0;
+    std::array<detail::Node, MAX_NODES> nodes{};
+    size_t nodeCount = 0;
+    std::array<uint32_t, Capacity + 1> variables{};    // offset of the first use
+    std::array<uint32_t, Capacity + 1> variableEnds{};
+    size_t variableCount = 0;
+    uint32_t root = 0;
+
+    constexpr detail::Spelling spelling(size_t slot) const {
+        return detail::Spelling(getSource(), variables[slot], variableEnds[slot]);
+    }
+
+    // Shares identical nodes, as Expression's hash-consing does
+    constexpr uint32_t addNode(Op op, uint32_t lhs, uint32_t rhs, uint32_t offset, double value = 0.0) {
+        for (size_t i = 0; i < nodeCount; i++) {
+            const detail::Node& node = nodes[i];
+            if (node.op == op && node.lhs == lhs && node.rhs == rhs && node.value == value) {
+                return static_cast<uint32_t>(i);
+            }
+        }
+        nodes[nodeCount] = {op, lhs, rhs, offset, value};
+        return static_cast<uint32_t>(nodeCount++);
+    }
+
+    constexpr uint32_t addVariable(const detail::Token& token) {
+        detail::Spelling name(getSource(), token.begin, token.end);
+        size_t slot = 0;
+        while (slot < variableCount && !(spelling(slot) == name)) slot++;
+        if (slot == variableCount) {
+            variables[slot] = token.begin;
+            variableEnds[slot] = token.end;
+            variableCount++;
+        }
+        return addNode(Op::VAR, static_cast<uint32_t>(slot), 0, token.begin);
+    }
+
+    // Parser::tryCompileInto on fixed-size stacks
+    constexpr void parse() {
+        using detail::Entry;
+        using detail::TokenKind;
+        using detail::fail;
+        std::string_view source = getSource();
+
+        // Lexical errors take precedence over syntax errors anywhere in the
+        // text, as Parser reports them even in trailing text it ignores
+        detail::Lexer scan(source);
+        while (scan.next().kind != TokenKind::END) {}
+
+        detail::Lexer lexer(source);
+        detail::Token token = lexer.next();
+        std::array<detail::StackEntry, 2 * Capacity + 2> stack{};
+        std::array<uint32_t, 2 * Capacity + 2> operands{};
+        size_t depth = 1;      // stack[0] is TOP
+        size_t count = 0;      // operands
+
+        auto reduce = [&]() {
+            const detail::StackEntry& entry = stack[--depth];
+            uint32_t rhs = operands[--count];
+            operands[count - 1] = addNode(entry.op, operands[count - 1], rhs, entry.offset);
+        };
+        auto push = [&](Entry kind, uint32_t offset) -> detail::StackEntry& {
+            detail::StackEntry& entry = stack[depth++];
+            entry = detail::StackEntry();
+            entry.kind = kind;
+            entry.offset = offset;
+            return entry;
+        };
+        auto unsupported = [&](uint32_t offset) {
+            fail(ErrorCode::UNSUPPORTED_OPERATION, offset, "Vector operations are not supported in constexpr expressions");
+        };
+
+        for (;;) {
+            // Expecting an operand
+            if (token.kind == TokenKind::NUMBER) {
+                operands[count++] = addNode(Op::CONST, 0, 0, token.begin, token.number);
+            } else if (token.kind == TokenKind::IDENTIFIER) {
+                operands[count++] = addVariable(token);
+            } else if (token.kind == TokenKind::MINUS || token.kind == TokenKind::PLUS) {
+                if (token.kind == TokenKind::MINUS) push(Entry::NEGATE, token.begin);
+                token = lexer.next();
+                continue;
+            } else if (token.kind == TokenKind::LPAREN) {
+                push(Entry::GROUP, token.begin);
+                token = lexer.next();
+                continue;
+            } else if (token.kind == TokenKind::FUNCTION) {
+                const detail::FunctionInfo& info = detail::FUNCTIONS[token.function];
+                if (info.vector) unsupported(token.begin);
+                if (info.op == Op::RAND || info.op == Op::RANDN) {
+                    fail(ErrorCode::UNSUPPORTED_OPERATION, token.begin,
+                         std::string(info.name) + "() is not supported in constexpr expressions");
+                }
+                uint32_t offset = token.begin;
+                uint8_t function = token.function;
+                token = lexer.next();
+                if (token.kind != TokenKind::LPAREN) {
+                    fail(ErrorCode::EXPECTED_LPAREN, token.begin, "Expected '(' after function: " + std::string(info.name));
+                }
+                push(Entry::FUNCTION, offset).function = function;
+                token = lexer.next();
+                continue;
+            } else if (token.kind == TokenKind::LBRACKET) {
+                unsupported(token.begin);
+            } else {
+                fail(ErrorCode::UNEXPECTED_TOKEN, token.begin, "Unexpected token");
+            }
+            token = lexer.next();
+
+            // After an operand
+            for (;;) {
+                // Prefix minus applies to the factor just completed: -2^2 = 4
+                while (stack[depth - 1].kind == Entry::NEGATE) {
+                    operands[count - 1] = addNode(Op::NEG, operands[count - 1], 0, stack[depth - 1].offset);
+                    depth--;
+                }
+
+                uint8_t level = 0;
+                Op op = Op::CONST;
+                bool implicit = false;
+                switch (token.kind) {
+                    case TokenKind::POW: level = detail::LEVEL_POWER; op = Op::POW; break;
+                    case TokenKind::FUNCTION:
+                    case TokenKind::NUMBER:
+                        level = detail::LEVEL_POWER; op = Op::MUL; implicit = true; break;
+                    case TokenKind::MUL: level = detail::LEVEL_PRODUCT; op = Op::MUL; break;
+                    case TokenKind::DIV: level = detail::LEVEL_PRODUCT; op = Op::DIV; break;
+                    case TokenKind::MOD: level = detail::LEVEL_PRODUCT; op = Op::MOD; break;
+                    case TokenKind::LPAREN:
+                        level = detail::LEVEL_PRODUCT; op = Op::MUL; implicit = true; break;
+                    case TokenKind::PLUS: level = detail::LEVEL_SUM; op = Op::ADD; break;
+                    case TokenKind::MINUS: level = detail::LEVEL_SUM; op = Op::SUB; break;
+                    default: break;
+                }
+
+                if (level > 0) {
+                    while (stack[depth - 1].kind == Entry::BINARY && stack[depth - 1].level >= level) {
+                        reduce();
+                    }
+                    detail::StackEntry& entry = push(Entry::BINARY, token.begin);
+                    entry.op = op;
+                    entry.level = level;
+                    if (!implicit) token = lexer.next();
+                    break;
+                }
+
+                // The current expression ends here; close the innermost construct
+                while (stack[depth - 1].kind == Entry::BINARY) {
+                    reduce();
+                }
+                detail::StackEntry& frame = stack[depth - 1];
+
+                if (frame.kind == Entry::TOP) {
+                    // Anything left over is ignored, as Parser does
+                    root = operands[count - 1];
+                    return;
+                }
+
+                if (frame.kind == Entry::GROUP) {
+                    if (token.kind != TokenKind::RPAREN) {
+                        fail(ErrorCode::EXPECTED_RPAREN, token.begin, "Expected ')' to match '('");
+                    }
+                    depth--;
+                    token = lexer.next();
+                    continue;
+                }
+
+                // FUNCTION
+                const detail::FunctionInfo& info = detail::FUNCTIONS[frame.function];
+                if (info.binary && !frame.secondArgument) {
+                    if (token.kind != TokenKind::COMMA) {
+                        fail(ErrorCode::EXPECTED_COMMA, token.begin,
+                             std::string(info.name) + "() requires two arguments separated by comma");
+                    }
+                    frame.secondArgument = true;
+                    token = lexer.next();
+                    break;
+                }
+                if (token.kind != TokenKind::RPAREN) {
+                    fail(ErrorCode::EXPECTED_RPAREN, token.begin,
+                         info.binary ? "Expected ')' after " + std::string(info.name) + " arguments"
+                                     : std::string("Expected ')' after function argument"));
+                }
+                if (info.binary) {
+                    uint32_t rhs = operands[--count];
+                    operands[count - 1] = addNode(info.op, operands[count - 1], rhs, frame.offset);
+                } else {
+                    operands[count - 1] = addNode(info.op, operands[count - 1], 0, frame.offset);
+                }
+                depth--;
+                token = lexer.next();
+            }
+        }
+    }
+};
+
+template <size_t N>
+constexpr Program<N - 1> compile(const char (&text)[N]) {
+    return Program<N - 1>(std::string_view(text, N - 1));
+}
+
+// For text known only at run time (or to size a Program explicitly)
+template <size_t Capacity>
+constexpr Program<Capacity> compile(std::string_view text) {
+    return Program<Capacity>(text);
+}
+
+// Value of an expression without variables
+template <size_t N>
+constexpr double evaluate(const char (&text)[N]) {
+    return compile(text).evaluate(std::initializer_list<typename Program<N - 1>::Binding>());
+}
+
+// A Program specialized into straight-line code: one statement per node,
+// with the operation fixed at compile time. Created by bind(), which maps
+// argument positions to variable slots.
+template <const auto& P, size_t Arity>
+class Function {
+public:
+    constexpr explicit Function(const std::array<uint32_t, Arity>& slots) : slots(slots) {}
+
+    template <class... Args>
+    constexpr double operator()(Args... args) const {
+        static_assert(sizeof...(Args) == Arity, "pass one value per name given to bind()");
+        const double given[Arity + 1] = {static_cast<double>(args)...};
+        // The extra last slot absorbs names the expression does not use
+        double values[VARIABLES + 1] = {};
+        for (size_t i = 0; i < Arity; i++) values[slots[i]] = given[i];
+        return run(values, std::make_index_sequence<P.size()>());
+    }
+
+private:
+    static constexpr size_t VARIABLES = P.getVariableCount();
+
+    std::array<uint32_t, Arity> slots;
+
+    template <size_t I>
+    static constexpr double step(const double* r, const double* values) {
+        constexpr detail::Node node = P.getNode(I);
+        if constexpr (node.op == Op::CONST) {
+            return node.value;
+        } else if constexpr (node.op == Op::VAR) {
+            return values[node.lhs];
+        } else {
+            return detail::apply(node, r[node.lhs], r[node.rhs]);
+        }
+    }
+
+    template <size_t... I>
+    static constexpr double run(const double* values, std::index_sequence<I...>) {
+        double r[sizeof...(I)] = {};
+        ((r[I] = step<I>(r, values)), ...);
+        return r[P.getRoot()];
+    }
+};
+
+// Binds the variables of P, in the order of the names given, to the
+// arguments of the returned callable. Every variable must be named.
+template <const auto& P, class... Names>
+constexpr Function<P, sizeof...(Names)> bind(Names... names) {
+    constexpr size_t VARIABLES = P.getVariableCount();
+    const std::string_view given[sizeof...(Names) + 1] = {std::string_view(names)...};
+    std::array<uint32_t, sizeof...(Names)> slots{};
+    bool bound[VARIABLES + 1] = {};
+    for (size_t i = 0; i < sizeof...(Names); i++) {
+        uint32_t slot = P.findVariable(given[i]);
+        slots[i] = slot == P.NO_SLOT ? static_cast<uint32_t>(VARIABLES) : slot;
+        bound[slots[i]] = true;
+    }
+    for (size_t slot = 0; slot < VARIABLES; slot++) {
+        if (!bound[slot]) {
+            detail::fail(ErrorCode::UNDEFINED_VARIABLE, P.getVariableOffset(slot),
+                         "Variable not defined: " + P.getVariableName(slot));
+        }
+    }
+    return Function<P, sizeof...(Names)>(slots);
+}
+
+} // namespace calcpp
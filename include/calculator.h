@@ -1,28 +1,73 @@
 #pragma once
 
+#include <memory>
 #include <string>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 #include "parser.h"
+#include "matrix.h"
+#include "table_generator.h"
+#include "profiler.h"
+#include "monte_carlo.h"
+#include "closed_form_index.h"
 
 class Calculator {
 public:
     Calculator();
     
     double calculate(const std::string& expression);
+    // Like calculate(), but the result may also be a vector or matrix
+    Matrix evaluate(const std::string& expression);
+    // Evaluates an already compiled expression against the current variables
+    Matrix evaluate(const Expression& expr);
+    // d(expression)/d(variable) at the current variable values (forward mode)
+    double differentiate(const std::string& expression, const std::string& variable);
+    // Partial derivatives with respect to every variable in the expression (reverse mode)
+    std::vector<std::pair<std::string, double>> gradient(const std::string& expression);
+    // Writes the table described by "expr, x, start, stop, step" to out. The
+    // bounds may be expressions; other variables take their current values.
+    // float32 evaluates in single precision (see TableGenerator::Options).
+    TableGenerator::Stats tabulate(const std::string& arguments, TableGenerator::Format format,
+                                   unsigned threads, std::FILE* out, bool float32 = false);
+    // Per-node timing of `iterations` evaluations at the current variable values
+    Profiler profile(const std::string& expression, size_t iterations);
+    // Monte Carlo estimate for "expr, n[, seed]"; n and seed may be
+    // expressions. Without a seed a random one is used (see Result::seed).
+    // The mean becomes ans.
+    MonteCarlo::Result monteCarlo(const std::string& arguments, unsigned threads);
+    std::string formatMonteCarlo(const MonteCarlo::Result& result) const;
+    // Closed forms for the value of "expr[, tolerance]" (ans when expr is
+    // empty), one per line. The index is opened on first use from the path
+    // given to setIdentifyIndex() or ClosedFormIndex::findDefault().
+    std::string identify(const std::string& arguments);
+    void setIdentifyIndex(const std::string& path);
     void setPrecision(int digits);
     int getPrecision() const;
     void setVariable(const std::string& name, double value);
     double getVariable(const std::string& name);
     bool hasVariable(const std::string& name) const;
+    void setMatrix(const std::string& name, const Matrix& value);
+    bool hasMatrix(const std::string& name) const;
     void clearVariables();
     double getLastResult() const;
     void setLastResult(double value);
     
     std::string formatResult(double value) const;
+    // Allocation-free formatting used by the batch paths; buffer must hold
+    // FORMAT_BUFFER_SIZE bytes. Returns the number of characters written.
+    static constexpr size_t FORMAT_BUFFER_SIZE = 400;
+    static size_t formatNumber(double value, int precision, char* buffer);
+    // formatNumber with at most `digits` significant digits (float results)
+    static size_t formatSignificant(double value, int digits, int precision, char* buffer);
+    std::string formatValue(const Matrix& value) const;
 
 private:
     Parser parser;
     std::unordered_map<std::string, double> variables;
+    std::unordered_map<std::string, Matrix> matrices;
+    std::string identifyIndexPath;
+    std::shared_ptr<ClosedFormIndex> closedForms;
     int precision;
     double lastResult;
 };
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "mapped_file.h"
+
+// Inverse symbolic lookup: recognizes a number as a closed form such as
+// sqrt(3), pi^2/6 or (sqrt(5)+1)/2.
+//
+// The index holds a few million candidates built from rationals and a set
+// of atoms (pi, e, phi and their powers, square, cube and fourth roots,
+// logarithms), each combined with small integers as p*A/q, p/(q*A),
+// (A+p)/q or (A-p)/q. Values are sorted, so a query is a binary search for
+// the tolerance window followed by picking the simplest candidates in it.
+// Candidates that round to the same double keep only the simplest form.
+// Only positive values are stored; the sign of a query carries over.
+//
+// The file is memory-mapped, so opening it costs nothing and a query only
+// touches the pages the search visits. Layout (native endian, sections
+// 8-byte aligned): header, atom values (double), atom weights (uint8),
+// atom names (NUL-terminated), sorted values (double), codes (uint32:
+// form | atom << 2 | p << 12 | q << 22).
+class ClosedFormIndex {
+public:
+    static constexpr uint32_t FORMAT_VERSION = 2;
+    // Relative; results computed in double agree with the closed form to
+    // about 1e-15, digits typed by hand need a looser tolerance
+    static constexpr double DEFAULT_TOLERANCE = 1e-10;
+
+    struct Match {
+        std::string expression;     // parses back with Parser
+        double value = 0.0;
+        double relativeError = 0.0;
+        int complexity = 0;         // lower is simpler
+    };
+
+    struct BuildStats {
+        size_t candidates = 0;
+        size_t entries = 0;         // after removing duplicates
+        size_t bytes = 0;
+    };
+
+    ClosedFormIndex() = default;
+    explicit ClosedFormIndex(const std::string& path);
+
+    void open(const std::string& path);
+    bool isOpen() const { return file.isOpen(); }
+    size_t size() const { return entryCount; }
+
+    // Candidates within `tolerance` of value, simplest first
+    std::vector<Match> identify(double value, double tolerance = DEFAULT_TOLERANCE,
+                                size_t maxMatches = 5) const;
+    // The candidate closest to value, however far
+    Match nearest(double value) const;
+    // Stored entry i (i < size()), in increasing order of value
+    Match entry(size_t i) const;
+
+    // Generates every candidate and writes the index to path
+    static BuildStats build(const std::string& path);
+    // $CALCPP_IDENTIFY_INDEX, else the index built or installed with
+    // calcpp if it exists; empty if there is none
+    static std::string findDefault();
+
+private:
+    MappedFile file;
+    const double* atomValues = nullptr;
+    const uint8_t* atomWeights = nullptr;
+    std::vector<const char*> atomNames;
+    const double* values = nullptr;
+    const uint32_t* codes = nullptr;
+    size_t entryCount = 0;
+
+    Match describe(size_t entry, double query) const;
+};
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "accuracy_report.h"
+#include "expression.h"
+#include "mapped_file.h"
+
+// Evaluates compiled expressions over the numeric columns of a CSV file.
+//
+// The file is memory-mapped and split into blocks at line boundaries.
+// Worker threads each take a block, parse the referenced columns straight
+// out of the mapping into column arrays, evaluate every expression a chunk
+// of rows at a time and format the result rows; the calling thread writes
+// finished blocks in file order. Column names from the header line (quoted
+// names may contain delimiters) bind to expression variables. Quoted data
+// fields may contain delimiters but not newlines. All expressions are
+// compiled into one DAG, so subterms they have in common are evaluated once
+// per chunk.
+//
+// With float32 the parsed columns are rounded to float a chunk at a time
+// and evaluated in single precision; every AccuracySampler::SAMPLE_STRIDE-th
+// row of a block is evaluated again in double to fill Stats::accuracy (all
+// output columns, rows with rand() or randn() excepted).
+class CsvPipeline {
+public:
+    struct Options {
+        std::vector<std::string> expressions;  // "expr" or "name=expr"
+        int precision = 15;
+        unsigned threads = 0;                  // 0 = hardware concurrency
+        char delimiter = ',';
+        size_t blockBytes = size_t(4) << 20;
+        bool float32 = false;
+    };
+
+    struct Stats {
+        size_t rows = 0;
+        size_t bytes = 0;
+        AccuracyReport accuracy;               // float32 only
+    };
+
+    CsvPipeline(const std::string& path, const Options& options);
+
+    // Writes a header of result column names followed by one line per row
+    Stats run(std::FILE* out);
+
+    const std::vector<std::string>& getColumnNames() const { return columnNames; }
+
+    // field as one CSV field: quoted (RFC 4180) if it contains the
+    // delimiter, a quote or a line break, unchanged otherwise
+    static std::string quoteField(const std::string& field, char delimiter = ',');
+
+private:
+    MappedFile file;
+    Options options;
+    std::vector<std::string> columnNames;
+    std::vector<int> fieldToColumn;        // CSV field -> parsed column index, or -1
+    size_t parsedColumns = 0;
+    size_t dataStart = 0;
+    std::vector<std::string> outputNames;
+    Expression expr;                       // one root per output
+    std::vector<int> columnSlots;          // variable slot -> parsed column index
+
+    void processBlock(const char* begin, const char* end, std::string& out, size_t& rows,
+                      AccuracyReport& accuracy) const;
+    void evaluateFloat(const std::vector<std::vector<double>>& columns, size_t rows, std::string& out,
+                       AccuracyReport& accuracy) const;
+};
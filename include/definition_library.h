@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+class Calculator;
+
+// Definition libraries: text files of "name = expression" lines ('#' starts
+// a comment) evaluated in order. A definition may use the ones above it in
+// the same file, but not variables defined elsewhere, so its value depends
+// on the file alone.
+//
+// Loading a file the first time parses and evaluates every line and writes
+// the results to a binary cache next to it (cachePath()). Later loads
+// memory-map the cache and, if it was built from a file with the same size
+// and content hash, take the values from it without touching the parser.
+// Definitions that use rand() or randn(), directly or through another
+// definition, keep their compiled nodes in the cache and are evaluated
+// again on every load.
+//
+// Cache layout (native endian, sections 8-byte aligned): header, definition
+// records, nodes, values (double), names. Node ops are stored as
+// Expression::Op numbers, so FORMAT_VERSION changes with that enum.
+class DefinitionLibrary {
+public:
+    static constexpr uint32_t FORMAT_VERSION = 1;
+
+    struct Stats {
+        size_t definitions = 0;
+        size_t reevaluated = 0;     // definitions that depend on rand()/randn()
+        bool fromCache = false;
+        bool cacheWritten = false;  // false if the cache could not be written
+    };
+
+    // Defines every name in path on calculator. Errors in the file raise
+    // CalcException with a byte offset into the file and define nothing.
+    static Stats load(const std::string& path, Calculator& calculator, bool useCache = true);
+
+    static std::string cachePath(const std::string& path) { return path + ".cache"; }
+    // 64-bit FNV-1a style hash of the source text, taken 8 bytes at a time
+    static uint64_t hash(const char* data, size_t size);
+};
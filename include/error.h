@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+
+// Error reporting shared by the parser and the evaluators.
+// The try* entry points fill a CalcError and return false instead of
+// throwing; the throwing convenience wrappers raise CalcException.
+enum class ErrorCode {
+    NONE = 0,
+    UNKNOWN_CHARACTER,
+    INVALID_NUMBER,
+    UNEXPECTED_TOKEN,
+    EXPECTED_LPAREN,
+    EXPECTED_RPAREN,
+    EXPECTED_RBRACKET,
+    EXPECTED_COMMA,
+    UNKNOWN_FUNCTION,
+    UNDEFINED_VARIABLE,
+    DIVISION_BY_ZERO,
+    MODULO_BY_ZERO,
+    UNSUPPORTED_OPERATION
+};
+
+struct CalcError {
+    ErrorCode code = ErrorCode::NONE;
+    size_t offset = 0;          // byte offset into the source expression
+    std::string message;
+
+    void set(ErrorCode errorCode, size_t errorOffset, std::string text) {
+        code = errorCode;
+        offset = errorOffset;
+        message = std::move(text);
+    }
+};
+
+class CalcException : public std::runtime_error {
+public:
+    explicit CalcException(const CalcError& error)
+        : std::runtime_error(error.message), code(error.code), offset(error.offset) {}
+
+    ErrorCode code;
+    size_t offset;
+};
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+#include "error.h"
+
+class Random;
+
+// Compiled form of an expression.
+// Nodes are stored in evaluation order (children always precede their
+// parent), so evaluating the expression is a single forward sweep and the
+// node list doubles as the tape for reverse-mode differentiation.
+//
+// The builder hash-conses nodes: adding a node identical to an existing one
+// (same operator, operands and constant) returns the existing index, so the
+// node list is a DAG in which every repeated pure subexpression is computed
+// once. LIST and APPEND are never shared because the matrix evaluator
+// consumes a list in place, nor are RAND and RANDN, which draw a new number
+// at every occurrence. Several expressions can be compiled into one
+// Expression (see Parser::compileInto); each records a root.
+class Expression {
+public:
+    enum class Op : uint8_t {
+        CONST,
+        VAR,
+        NEG,
+        ADD,
+        SUB,
+        MUL,
+        DIV,
+        MOD,
+        POW,
+        SIN,
+        COS,
+        TAN,
+        ASIN,
+        ACOS,
+        ATAN,
+        LOG10,
+        LN,
+        SQRT,
+        ABS,
+        FLOOR,
+        CEIL,
+        ROUND,
+        EXP,
+        RAND,       // uniform on [0, 1)
+        RANDN,      // standard normal
+        // Vector / matrix operations (see evaluateMatrix in matrix.h)
+        LIST,       // [x      : start a vector literal or a matrix row list
+        APPEND,     // list, x : append an element or row
+        DOT,
+        MATMUL,
+        SOLVE,
+        NORM,
+        TRANSPOSE,
+        DET
+    };
+
+    struct Node {
+        Op op;
+        uint32_t lhs;     // child node, or variable slot for VAR
+        uint32_t rhs;     // second child for binary operators
+        uint32_t offset;  // byte offset of the originating token
+        double value;     // constant value for CONST
+    };
+
+    // Builder interface (used by Parser)
+    size_t addConstant(double value, size_t offset = 0);
+    size_t addVariable(const std::string& name, size_t offset = 0);
+    size_t addUnary(Op op, size_t operand, size_t offset = 0);
+    size_t addBinary(Op op, size_t lhs, size_t rhs, size_t offset = 0);
+    // RAND or RANDN; every call adds a new node
+    size_t addRandom(Op op, size_t offset = 0);
+    void reserve(size_t count) { nodes.reserve(count); }
+    // Marks a node as the result of an expression; returns the root's number
+    size_t addRoot(size_t node);
+    // Hash-consing is on by default; turn it off before adding nodes to get
+    // one node per occurrence (used to measure what sharing saves)
+    void setHashConsing(bool enabled);
+    bool isHashConsing() const { return hashConsing; }
+
+    const std::vector<Node>& getNodes() const { return nodes; }
+    // First root, or the last node if no root was recorded
+    size_t getRoot() const { return !roots.empty() ? roots[0] : (nodes.empty() ? 0 : nodes.size() - 1); }
+    const std::vector<uint32_t>& getRoots() const { return roots; }
+    const std::vector<std::string>& getVariableNames() const { return variableNames; }
+    size_t getVariableCount() const { return variableNames.size(); }
+    int findVariable(const std::string& name) const;
+
+    // Byte offset of the first use of variable slot i
+    size_t getVariableOffset(size_t slot) const { return variableOffsets[slot]; }
+
+    // Resolve variable slots from a name -> value map.
+    std::vector<double> bindVariables(const std::unordered_map<std::string, double>& vars) const;
+    bool tryBindVariables(const std::unordered_map<std::string, double>& vars,
+                          std::vector<double>& values, CalcError& error) const;
+
+    // values[i] is the value of variable slot i
+    double evaluate(const double* values) const;
+    double evaluate(const double* values, std::vector<double>& registers) const;
+    // Non-throwing evaluation; on failure error.offset points at the operator
+    bool tryEvaluate(const double* values, std::vector<double>& registers,
+                     double& result, CalcError& error) const;
+
+    // Column-at-a-time evaluation of `count` rows: columns[i] points to the
+    // values of variable slot i. Rows that would raise an error in scalar
+    // evaluation (division or modulo by zero) produce NaN instead.
+    // Transcendental functions use VectorMath, so results may differ from
+    // evaluate() by its documented ulp error.
+    // registers is scratch space, resized to nodes * count.
+    void evaluateBatch(const double* const* columns, size_t count, double* out,
+                       std::vector<double>& registers) const;
+    // Same, for every root at once: outs[i] receives root i. Subexpressions
+    // shared between the roots are computed once.
+    void evaluateBatch(const double* const* columns, size_t count, double* const* outs,
+                       std::vector<double>& registers) const;
+    // rand() and randn() draw from `random` instead of the thread's
+    // generator, one node at a time, so a seeded generator reproduces the
+    // batch exactly
+    void evaluateBatch(const double* const* columns, size_t count, double* out,
+                       std::vector<double>& registers, Random& random) const;
+    // Single precision: registers, constants and inputs are float and the
+    // transcendentals use VectorMath's float kernels, which fit twice the
+    // lanes in a SIMD register. Results carry float rounding error (see
+    // AccuracyReport for measuring it against the double path).
+    void evaluateBatch(const float* const* columns, size_t count, float* out,
+                       std::vector<float>& registers) const;
+    void evaluateBatch(const float* const* columns, size_t count, float* const* outs,
+                       std::vector<float>& registers) const;
+
+    bool hasMatrixOps() const;
+    // True if any node is RAND or RANDN
+    bool hasRandomOps() const;
+
+    // One scalar operation as evaluate() performs it, minus the division
+    // checks (x/0 gives inf or NaN). For CONST and VAR the value is passed as a.
+    static double applyScalar(Op op, double a, double b);
+
+    // Nodes without operands: CONST, VAR, RAND, RANDN
+    static bool isLeaf(Op op);
+    static bool isUnary(Op op);
+    static bool isMatrixOp(Op op);
+    static const char* opName(Op op);
+
+private:
+    static constexpr uint32_t EMPTY_BUCKET = UINT32_MAX;
+
+    std::vector<Node> nodes;
+    std::vector<uint32_t> roots;
+    // Open-addressing table of node indices for hash-consing
+    std::vector<uint32_t> buckets;
+    uint32_t highestOperand = 0;   // largest node index used as an operand
+    bool hashConsing = true;
+    std::vector<std::string> variableNames;
+    std::vector<size_t> variableOffsets;
+    std::unordered_map<std::string, uint32_t> variableSlots;
+
+    size_t addNode(const Node& node);
+    void rehash(size_t bucketCount);
+    // T is double or float (instantiated in expression.cpp)
+    template <typename T>
+    void runBatch(const T* const* columns, size_t count, std::vector<T>& registers, Random& random) const;
+};
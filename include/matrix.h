@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <vector>
+#include "expression.h"
+
+// Allocator returning storage aligned for the widest SIMD loads we use.
+template <typename T, size_t Alignment = 64>
+struct AlignedAllocator {
+    using value_type = T;
+
+    AlignedAllocator() = default;
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment>&) {}
+
+    template <typename U>
+    struct rebind { using other = AlignedAllocator<U, Alignment>; };
+
+    T* allocate(size_t n) {
+        size_t bytes = (n * sizeof(T) + Alignment - 1) / Alignment * Alignment;
+#if defined(_MSC_VER)
+        void* p = _aligned_malloc(bytes, Alignment);
+#else
+        void* p = std::aligned_alloc(Alignment, bytes);
+#endif
+        if (p == nullptr) throw std::bad_alloc();
+        return static_cast<T*>(p);
+    }
+
+    void deallocate(T* p, size_t) {
+#if defined(_MSC_VER)
+        _aligned_free(p);
+#else
+        std::free(p);
+#endif
+    }
+
+    template <typename U>
+    bool operator==(const AlignedAllocator<U, Alignment>&) const { return true; }
+    template <typename U>
+    bool operator!=(const AlignedAllocator<U, Alignment>&) const { return false; }
+};
+
+// Scalar, vector or matrix value with contiguous row-major storage.
+// A vector of length n is laid out as a single row (1 x n) so that it
+// broadcasts across the rows of a matrix.
+class Matrix {
+public:
+    Matrix();
+    Matrix(size_t rows, size_t cols, double fill = 0.0);
+
+    static Matrix scalar(double value);
+    static Matrix vector(size_t length, double fill = 0.0);
+
+    size_t rows() const { return rowCount; }
+    size_t cols() const { return colCount; }
+    size_t size() const { return data.size(); }
+    int dims() const { return dimensions; }   // 0 = scalar, 1 = vector, 2 = matrix
+    bool isScalar() const { return dimensions == 0; }
+    bool isVector() const { return dimensions == 1; }
+
+    double* values() { return data.data(); }
+    const double* values() const { return data.data(); }
+    double& operator()(size_t r, size_t c) { return data[r * colCount + c]; }
+    double operator()(size_t r, size_t c) const { return data[r * colCount + c]; }
+    double& operator[](size_t i) { return data[i]; }
+    double operator[](size_t i) const { return data[i]; }
+    double toScalar() const;
+
+    // Element-wise operators with broadcasting
+    Matrix operator+(const Matrix& other) const;
+    Matrix operator-(const Matrix& other) const;
+    Matrix operator*(const Matrix& other) const;
+    Matrix operator/(const Matrix& other) const;
+    Matrix operator%(const Matrix& other) const;
+    Matrix pow(const Matrix& other) const;
+    Matrix operator-() const;
+    Matrix map(double (*f)(double)) const;
+
+    // Linear algebra
+    static Matrix matmul(const Matrix& a, const Matrix& b);
+    static Matrix transpose(const Matrix& m);
+    static double dot(const Matrix& a, const Matrix& b);
+    static double norm(const Matrix& m);
+    static double det(const Matrix& m);
+    static Matrix solve(const Matrix& a, const Matrix& b);
+
+    // Append a scalar to a vector, or a vector as a new row of a matrix
+    // (used to build [..] literals).
+    void append(const Matrix& element);
+
+private:
+    std::vector<double, AlignedAllocator<double>> data;
+    size_t rowCount;
+    size_t colCount;
+    int dimensions;
+};
+
+// Raw C = A * B kernel on row-major storage (A is m x k, B is k x n).
+// Cache-blocked, SIMD micro-kernel, multithreaded for large products.
+void matmulKernel(size_t m, size_t n, size_t k, const double* a, const double* b, double* c);
+
+// Evaluate a compiled expression whose values may be vectors or matrices.
+Matrix evaluateMatrix(const Expression& expr, const std::vector<Matrix>& values);
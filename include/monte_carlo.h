@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "expression.h"
+
+// Monte Carlo estimate of an expression containing rand() and randn().
+//
+// The expression is compiled once and evaluated column-at-a-time. Samples
+// are split into fixed blocks; block b draws from Random(seed, b), and each
+// block's mean and sum of squared deviations are combined in block order
+// (Chan et al.), so a seed gives bit-identical results for any number of
+// threads. Workers take blocks from a shared counter. Samples that are NaN
+// or infinite (division by zero, ln of a negative draw) are counted and left
+// out of the statistics.
+class MonteCarlo {
+public:
+    struct Options {
+        std::string expression;
+        uint64_t samples = 0;
+        uint64_t seed = 0;
+        unsigned threads = 0;                  // 0 = hardware concurrency
+        size_t blockSamples = 16384;
+    };
+
+    struct Result {
+        uint64_t samples = 0;                  // finite samples
+        uint64_t invalid = 0;                  // NaN or infinite samples
+        double mean = 0.0;
+        double variance = 0.0;                 // sample variance (n - 1)
+        double standardError = 0.0;
+        double low = 0.0;                      // 95% confidence interval of the mean
+        double high = 0.0;
+        uint64_t seed = 0;
+    };
+
+    // Two-sided 95% quantile of the standard normal distribution
+    static constexpr double Z_95 = 1.959963984540054;
+
+    // variables supplies the value of every variable the expression uses
+    MonteCarlo(const Options& options, const std::unordered_map<std::string, double>& variables);
+
+    Result run() const;
+
+private:
+    struct Moments {
+        uint64_t count = 0;
+        uint64_t invalid = 0;
+        double mean = 0.0;
+        double m2 = 0.0;                       // sum of squared deviations from mean
+
+        void merge(const Moments& other);
+    };
+
+    Options options;
+    Expression expr;
+    std::vector<double> constants;             // values of the variable slots
+
+    Moments processBlock(size_t index) const;
+};
@@ -4,6 +4,8 @@
 #include <vector>
 #include <unordered_map>
 #include <cmath>
+#include "error.h"
+#include "expression.h"
 
 class Parser {
 public:
@@ -17,6 +19,8 @@ public:
         MOD,        // %
         LPAREN,
         RPAREN,
+        LBRACKET,   // [
+        RBRACKET,   // ]
         FUNCTION,   // sin, cos, etc.
         VARIABLE,
         COMMA,
@@ -30,23 +34,41 @@ public:
         TokenType type;
         std::string value;
         double numValue;
+        size_t offset;      // byte offset in the source expression
     };
 
     Parser();
     std::vector<Token> tokenize(const std::string& expression);
     double parse(const std::string& expression);
+    Expression compile(const std::string& expression);
+    Expression compile(const char* text, size_t length);
+    // Adds expression to expr as a further root, sharing every subexpression
+    // it has in common with what expr already holds; returns the root number
+    size_t compileInto(const std::string& expression, Expression& expr);
+
+    // Non-throwing variants: on failure they return false and describe the
+    // problem (with its byte offset) in error.
+    bool tryTokenize(const std::string& expression, std::vector<Token>& tokens, CalcError& error);
+    bool tryCompile(const std::string& expression, Expression& expr, CalcError& error);
+    bool tryCompile(const char* text, size_t length, Expression& expr, CalcError& error);
+    bool tryCompileInto(const std::string& expression, Expression& expr, CalcError& error);
+    bool tryCompileInto(const char* text, size_t length, Expression& expr, CalcError& error);
     void setVariables(const std::unordered_map<std::string, double>* vars) {
         variables = vars;
     }
+    // Common subexpression sharing in compiled expressions (on by default)
+    void setHashConsing(bool enabled) { hashConsing = enabled; }
 
 private:
     std::unordered_map<std::string, int> functionMap;
     const std::unordered_map<std::string, double>* variables = nullptr;
+    bool hashConsing = true;
     void initializeFunctions();
     
-    double parseExpression(const std::vector<Token>& tokens, size_t& pos);
-    double parseTerm(const std::vector<Token>& tokens, size_t& pos);
-    double parsePower(const std::vector<Token>& tokens, size_t& pos);
-    double parseFactor(const std::vector<Token>& tokens, size_t& pos);
-    double parseFunction(const std::string& funcName, double arg);
+    // Produces tokens one at a time so that compiling never materializes
+    // the whole token list (defined in parser.cpp)
+    class Lexer;
+
+    static constexpr size_t INVALID = static_cast<size_t>(-1);
+    size_t parseFunction(const std::string& funcName, size_t arg, Expression& expr, size_t offset, CalcError& error);
 };
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "expression.h"
+
+// Per-node cost of evaluating a scalar expression.
+//
+// run() times compiling the source and evaluating the compiled form, each
+// `iterations` times. Per-node times are estimates: every node's operation
+// is replayed in isolation `iterations` times on the operand values of a
+// real evaluation, which avoids a timer read per node but leaves out the
+// dispatch and memory traffic of the real loop. rand() and randn() nodes
+// are not replayed, so profiling does not draw from the generator beyond
+// the real evaluations, and show no time. Shared subexpressions are
+// evaluated once per evaluation, so the tree is the spanning tree of the DAG:
+// a shared node is expanded under its first parent and shown as a
+// reference elsewhere. Cumulative time is self time plus that of the
+// expanded children.
+class Profiler {
+public:
+    struct NodeStats {
+        uint64_t replays = 0;           // isolated replays of the node (0 for rand/randn)
+        uint32_t uses = 0;              // operand references to it (> 1 when shared)
+        double selfNanoseconds = 0.0;   // estimated, per evaluation
+        double cumulativeNanoseconds = 0.0;
+    };
+
+    // variables supplies the value of every variable the expression uses
+    Profiler(const std::string& expression, const std::unordered_map<std::string, double>& variables);
+
+    void run(size_t iterations);
+
+    // Summary, per-operation breakdown and the annotated tree (at most
+    // maxTreeLines lines of it)
+    void print(std::ostream& out, size_t maxTreeLines = 200) const;
+    // Folded stacks ("root;child;node nanoseconds" per line), the input
+    // format of flamegraph.pl and speedscope
+    void writeFoldedStacks(std::ostream& out) const;
+
+    const Expression& getExpression() const { return expr; }
+    const std::vector<NodeStats>& getNodeStats() const { return stats; }
+    double getCompileNanoseconds() const { return compileNanoseconds; }
+    double getEvaluateNanoseconds() const { return evaluateNanoseconds; }
+
+private:
+    static constexpr uint32_t NO_PARENT = UINT32_MAX;
+
+    std::string source;
+    Expression expr;
+    std::vector<double> values;
+    std::vector<NodeStats> stats;
+    std::vector<uint32_t> order;       // reachable nodes in tree pre-order
+    std::vector<uint32_t> depths;      // depth of order[i]
+    std::vector<char> shared;          // order[i] is a reference to a node expanded earlier
+    std::vector<uint32_t> treeParents; // node -> the node it is expanded under
+    size_t iterations = 0;
+    double compileNanoseconds = 0.0;
+    double evaluateNanoseconds = 0.0;
+    double result = 0.0;
+
+    std::string label(uint32_t node) const;
+};
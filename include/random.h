@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// xoshiro256** generator (Blackman and Vigna), seeded through splitmix64.
+//
+// A generator built from (seed, stream) is an independent sequence for
+// every stream number, so work split into numbered blocks draws the same
+// numbers whichever thread runs each block. Normal variates come from the
+// Box-Muller transform; fillNormal() computes the logarithms, square roots
+// and sines of a whole array with VectorMath.
+class Random {
+public:
+    explicit Random(uint64_t seed);
+    Random(uint64_t seed, uint64_t stream);
+
+    uint64_t next() {
+        uint64_t result = rotate(state[1] * 5, 7) * 9;
+        uint64_t t = state[1] << 17;
+        state[2] ^= state[0];
+        state[3] ^= state[1];
+        state[1] ^= state[2];
+        state[0] ^= state[3];
+        state[2] ^= t;
+        state[3] = rotate(state[3], 45);
+        return result;
+    }
+
+    // Uniform on [0, 1) with 53 random bits
+    double uniform() { return static_cast<double>(next() >> 11) * 0x1p-53; }
+    // Standard normal; every other call returns the second variate of the
+    // previous Box-Muller pair
+    double normal();
+
+    void fillUniform(double* out, size_t n);
+    void fillNormal(double* out, size_t n);
+    // Single precision: uniform with 24 random bits (so never 1.0f), normal
+    // variates computed in double and rounded
+    void fillUniform(float* out, size_t n);
+    void fillNormal(float* out, size_t n);
+
+    // The calling thread's generator, seeded from std::random_device; used
+    // by rand() and randn() outside mc()
+    static Random& local();
+    static uint64_t randomSeed();
+
+private:
+    uint64_t state[4];
+    double spare = 0.0;
+    bool hasSpare = false;
+
+    static uint64_t rotate(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+};
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "accuracy_report.h"
+#include "expression.h"
+
+// Tabulates an expression over an evenly spaced range of one variable.
+//
+// The expression is compiled once. Row i uses start + i * step (the last
+// row is clamped to stop), so values do not drift over long ranges. Blocks
+// of rows are evaluated column-at-a-time and formatted on worker threads and
+// written in order by the calling thread. Rows that would fail in scalar
+// evaluation (division by zero) produce NaN.
+//
+// With float32 the expression is evaluated in single precision (see
+// Expression::evaluateBatch), CSV output prints results with at most 9
+// significant digits, binary output holds floats, and every
+// AccuracySampler::SAMPLE_STRIDE-th row is evaluated again in double to fill
+// Stats::accuracy. Expressions that use rand() or randn() are not sampled.
+class TableGenerator {
+public:
+    enum class Format {
+        CSV,        // header line (the expression quoted if needed), then "x,value" per row
+        BINARY      // values only, native-endian doubles (floats with float32), no header
+    };
+
+    struct Options {
+        std::string expression;
+        std::string variable;
+        double start = 0.0;
+        double stop = 0.0;
+        double step = 1.0;
+        Format format = Format::CSV;
+        int precision = 15;
+        unsigned threads = 0;                  // 0 = hardware concurrency
+        size_t blockRows = 65536;
+        bool float32 = false;
+    };
+
+    struct Stats {
+        size_t rows = 0;
+        size_t bytes = 0;
+        AccuracyReport accuracy;               // float32 only
+    };
+
+    // variables supplies the values of every other variable the expression uses
+    TableGenerator(const Options& options, const std::unordered_map<std::string, double>& variables);
+
+    Stats run(std::FILE* out);
+
+    size_t getRowCount() const { return rowCount; }
+
+    // Splits "expr, x, start, stop, step" at top-level commas
+    static std::vector<std::string> splitArguments(const std::string& text);
+
+private:
+    Options options;
+    Expression expr;
+    int variableSlot = -1;                     // -1: expression does not use the variable
+    std::vector<double> constants;             // values of the other variable slots
+    size_t rowCount = 0;
+
+    double rowValue(size_t row) const;
+    void processBlock(size_t first, size_t count, std::string& out) const;
+    void processBlockFloat(size_t first, size_t count, std::string& out, AccuracyReport& accuracy) const;
+};
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstddef>
+
+// Element-wise transcendental functions over arrays of doubles.
+//
+// The same algorithms (fdlibm-style argument reduction and polynomials) are
+// compiled once per instruction set and the widest one the CPU supports is
+// picked at first use. Lanes whose input falls outside a kernel's reduced
+// domain (NaN, infinities, subnormals, huge trigonometric arguments, pow with
+// x <= 0 or a result near overflow) are recomputed with libm, so special
+// values follow the C library exactly.
+//
+// Maximum error against glibc libm, measured by bench_vecmath over a
+// float32 sweep and random sets (SSE2 / AVX2 / AVX-512 alike):
+//   sin, cos, asin, acos, atan, exp, ln, pow   1 ulp
+//   log10                                      2 ulp
+//   tan                                        3 ulp
+//   sqrt                                       0 ulp (correctly rounded)
+// Kernels with FMA (AVX2, AVX-512) may differ from SSE2 in the last bit.
+// The SSE2 table uses libm for pow: without FMA its double-double steps
+// are slower than the C library.
+//
+// Float overloads run single-precision kernels (Cephes polynomials) with
+// twice the lanes per vector; they are within 3 float ulp of libm's
+// float functions (see bench_float32). Float pow multiplies in double for
+// a small integer exponent and otherwise goes through the double kernels.
+class VectorMath {
+public:
+    enum class Isa {
+        LIBM,       // scalar calls into the C library (reference)
+        SCALAR,     // portable build of the vector algorithms
+        SSE2,
+        AVX2,       // AVX2 + FMA
+        AVX512      // AVX-512F
+    };
+
+    using UnaryKernel = void (*)(const double* x, double* out, size_t n);
+    using BinaryKernel = void (*)(const double* x, const double* y, double* out, size_t n);
+    using UnaryKernelF = void (*)(const float* x, float* out, size_t n);
+    using BinaryKernelF = void (*)(const float* x, const float* y, float* out, size_t n);
+
+    // One implementation of every function for a particular instruction set
+    struct Kernels {
+        Isa isa;
+        UnaryKernel sin, cos, tan, asin, acos, atan;
+        UnaryKernel exp, ln, log10, sqrt;
+        BinaryKernel pow;
+    };
+
+    struct FloatKernels {
+        Isa isa;
+        UnaryKernelF sin, cos, tan, asin, acos, atan;
+        UnaryKernelF exp, ln, log10, sqrt;
+        BinaryKernelF pow;
+    };
+
+    // Kernel table for an instruction set, or nullptr if it was not compiled
+    // in or the CPU cannot run it
+    static const Kernels* getKernels(Isa isa);
+    static const FloatKernels* getFloatKernels(Isa isa);
+    static bool isSupported(Isa isa) { return getKernels(isa) != nullptr; }
+    static Isa bestIsa();
+    static Isa getIsa();
+    // Overrides the automatic choice; returns false if isa is unsupported
+    static bool setIsa(Isa isa);
+    static const char* isaName(Isa isa);
+
+    // out may alias x (and y) exactly
+    static void sin(const double* x, double* out, size_t n) { active().sin(x, out, n); }
+    static void cos(const double* x, double* out, size_t n) { active().cos(x, out, n); }
+    static void tan(const double* x, double* out, size_t n) { active().tan(x, out, n); }
+    static void asin(const double* x, double* out, size_t n) { active().asin(x, out, n); }
+    static void acos(const double* x, double* out, size_t n) { active().acos(x, out, n); }
+    static void atan(const double* x, double* out, size_t n) { active().atan(x, out, n); }
+    static void exp(const double* x, double* out, size_t n) { active().exp(x, out, n); }
+    static void ln(const double* x, double* out, size_t n) { active().ln(x, out, n); }
+    static void log10(const double* x, double* out, size_t n) { active().log10(x, out, n); }
+    static void sqrt(const double* x, double* out, size_t n) { active().sqrt(x, out, n); }
+    static void pow(const double* x, const double* y, double* out, size_t n) { active().pow(x, y, out, n); }
+
+    // Single precision, same instruction set as the double kernels
+    static void sin(const float* x, float* out, size_t n) { activeFloat().sin(x, out, n); }
+    static void cos(const float* x, float* out, size_t n) { activeFloat().cos(x, out, n); }
+    static void tan(const float* x, float* out, size_t n) { activeFloat().tan(x, out, n); }
+    static void asin(const float* x, float* out, size_t n) { activeFloat().asin(x, out, n); }
+    static void acos(const float* x, float* out, size_t n) { activeFloat().acos(x, out, n); }
+    static void atan(const float* x, float* out, size_t n) { activeFloat().atan(x, out, n); }
+    static void exp(const float* x, float* out, size_t n) { activeFloat().exp(x, out, n); }
+    static void ln(const float* x, float* out, size_t n) { activeFloat().ln(x, out, n); }
+    static void log10(const float* x, float* out, size_t n) { activeFloat().log10(x, out, n); }
+    static void sqrt(const float* x, float* out, size_t n) { activeFloat().sqrt(x, out, n); }
+    static void pow(const float* x, const float* y, float* out, size_t n) { activeFloat().pow(x, y, out, n); }
+
+private:
+    static const Kernels& active();
+    static const FloatKernels& activeFloat();
+};
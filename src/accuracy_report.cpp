@@ -0,0 +1,84 @@
+#include "accuracy_report.h"
+#include <cmath>
+#include <limits>
+
+namespace {
+
+void compare(AccuracyReport& report, double exact, double approximate) {
+    double error = 0.0;
+    if (std::isnan(exact) || std::isnan(approximate)) {
+        if (std::isnan(exact) != std::isnan(approximate)) error = std::numeric_limits<double>::infinity();
+    } else if (exact != approximate) {
+        if (!std::isfinite(exact) || !std::isfinite(approximate)) {
+            error = std::numeric_limits<double>::infinity();
+        } else {
+            double difference = std::abs(approximate - exact);
+            error = exact == 0 ? difference : difference / std::abs(exact);
+        }
+    }
+    if (error > report.maxRelativeError) {
+        report.maxRelativeError = error;
+        report.worstExact = exact;
+        report.worstApproximate = approximate;
+    }
+}
+
+} // namespace
+
+void AccuracyReport::add(double exact, double approximate) {
+    sampledRows++;
+    compare(*this, exact, approximate);
+}
+
+void AccuracyReport::add(const double* exact, const double* approximate, size_t values) {
+    sampledRows++;
+    for (size_t i = 0; i < values; i++) compare(*this, exact[i], approximate[i]);
+}
+
+void AccuracyReport::merge(const AccuracyReport& other) {
+    sampledRows += other.sampledRows;
+    if (other.maxRelativeError > maxRelativeError) {
+        maxRelativeError = other.maxRelativeError;
+        worstExact = other.worstExact;
+        worstApproximate = other.worstApproximate;
+    }
+}
+
+AccuracySampler::AccuracySampler(const Expression& expr, size_t outputs)
+    : expr(expr), outputs(outputs), enabled(!expr.hasRandomOps()), inputs(expr.getVariableCount()) {}
+
+void AccuracySampler::addChunk(size_t first, size_t count, const double* const* columns,
+                               const float* const* floatResults) {
+    if (!enabled) return;
+    for (size_t r = (SAMPLE_STRIDE - first % SAMPLE_STRIDE) % SAMPLE_STRIDE; r < count; r += SAMPLE_STRIDE) {
+        for (size_t slot = 0; slot < inputs.size(); slot++) inputs[slot].push_back(columns[slot][r]);
+        for (size_t i = 0; i < outputs; i++) results.push_back(floatResults[i][r]);
+        samples++;
+    }
+}
+
+void AccuracySampler::finish(AccuracyReport& report) {
+    if (samples == 0) return;
+
+    std::vector<const double*> slots(inputs.size());
+    for (size_t slot = 0; slot < inputs.size(); slot++) slots[slot] = inputs[slot].data();
+    std::vector<std::vector<double>> exact(outputs, std::vector<double>(samples));
+    std::vector<double> registers;
+    if (outputs == 1) {
+        expr.evaluateBatch(slots.data(), samples, exact[0].data(), registers);
+    } else {
+        std::vector<double*> outs;
+        for (auto& output : exact) outs.push_back(output.data());
+        expr.evaluateBatch(slots.data(), samples, outs.data(), registers);
+    }
+
+    std::vector<double> row(outputs);
+    for (size_t s = 0; s < samples; s++) {
+        for (size_t i = 0; i < outputs; i++) row[i] = exact[i][s];
+        report.add(row.data(), results.data() + s * outputs, outputs);
+    }
+
+    for (auto& input : inputs) input.clear();
+    results.clear();
+    samples = 0;
+}
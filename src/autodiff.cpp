@@ -0,0 +1,124 @@
+#include "autodiff.h"
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+
+using Op = Expression::Op;
+
+// Local partial derivatives of node = op(a, b) with value v.
+// Piecewise-constant functions (floor, ceil, round) have zero derivative
+// everywhere they are differentiable; random draws do not depend on anything.
+void partials(Op op, double a, double b, double v, double& da, double& db) {
+    da = 0.0;
+    db = 0.0;
+    switch (op) {
+        case Op::CONST:
+        case Op::VAR:
+        case Op::RAND:
+        case Op::RANDN:
+        case Op::FLOOR:
+        case Op::CEIL:
+        case Op::ROUND:
+            break;
+        case Op::NEG:   da = -1.0; break;
+        case Op::ADD:   da = 1.0; db = 1.0; break;
+        case Op::SUB:   da = 1.0; db = -1.0; break;
+        case Op::MUL:   da = b; db = a; break;
+        case Op::DIV:   da = 1.0 / b; db = -v / b; break;
+        case Op::MOD:   da = 1.0; db = -std::trunc(a / b); break;
+        case Op::POW:
+            // a^0 is constant; b * a^(b-1) would give 0 * inf = NaN at a == 0
+            da = (b == 0) ? 0.0 : b * std::pow(a, b - 1.0);
+            // d/db a^b = a^b ln(a) is only real for a > 0; for a == 0 it is 0
+            db = (a > 0) ? v * std::log(a) : 0.0;
+            break;
+        case Op::SIN:   da = std::cos(a); break;
+        case Op::COS:   da = -std::sin(a); break;
+        case Op::TAN:   da = 1.0 + v * v; break;
+        case Op::ASIN:  da = 1.0 / std::sqrt(1.0 - a * a); break;
+        case Op::ACOS:  da = -1.0 / std::sqrt(1.0 - a * a); break;
+        case Op::ATAN:  da = 1.0 / (1.0 + a * a); break;
+        case Op::LOG10: da = 1.0 / (a * 2.30258509299404568401799145468436421); break;
+        case Op::LN:    da = 1.0 / a; break;
+        case Op::SQRT:  da = 0.5 / v; break;
+        case Op::ABS:   da = (a > 0) ? 1.0 : (a < 0 ? -1.0 : 0.0); break;
+        case Op::EXP:   da = v; break;
+        default:
+            throw std::runtime_error("Cannot differentiate vector operations");
+    }
+}
+
+} // namespace
+
+Dual differentiate(const Expression& expr, const double* values, size_t slot) {
+    const auto& nodes = expr.getNodes();
+    std::vector<double> registers;
+    expr.evaluate(values, registers);
+    std::vector<double> tangents(nodes.size(), 0.0);
+
+    for (size_t i = 0; i < nodes.size(); i++) {
+        const Expression::Node& node = nodes[i];
+        if (node.op == Op::VAR) {
+            tangents[i] = (node.lhs == slot) ? 1.0 : 0.0;
+            continue;
+        }
+        if (Expression::isLeaf(node.op)) continue;
+
+        double a = registers[node.lhs];
+        double b = Expression::isUnary(node.op) ? 0.0 : registers[node.rhs];
+        double da, db;
+        partials(node.op, a, b, registers[i], da, db);
+
+        // Skip zero tangents so that an infinite partial does not turn an
+        // independent operand into NaN
+        double t = 0.0;
+        if (tangents[node.lhs] != 0) t += da * tangents[node.lhs];
+        if (!Expression::isUnary(node.op) && tangents[node.rhs] != 0) t += db * tangents[node.rhs];
+        tangents[i] = t;
+    }
+
+    size_t root = expr.getRoot();
+    return {registers[root], tangents[root]};
+}
+
+double gradient(const Expression& expr, const double* values, double* gradient) {
+    std::vector<double> registers;
+    std::vector<double> adjoints;
+    return ::gradient(expr, values, gradient, registers, adjoints);
+}
+
+double gradient(const Expression& expr, const double* values, double* gradient,
+                std::vector<double>& registers, std::vector<double>& adjoints) {
+    const auto& nodes = expr.getNodes();
+    double result = expr.evaluate(values, registers);
+
+    for (size_t i = 0; i < expr.getVariableCount(); i++) {
+        gradient[i] = 0.0;
+    }
+    adjoints.assign(nodes.size(), 0.0);
+    adjoints[expr.getRoot()] = 1.0;
+
+    for (size_t i = nodes.size(); i-- > 0; ) {
+        const Expression::Node& node = nodes[i];
+        double adjoint = adjoints[i];
+        if (adjoint == 0) continue;
+        if (node.op == Op::VAR) {
+            gradient[node.lhs] += adjoint;
+            continue;
+        }
+        if (Expression::isLeaf(node.op)) continue;
+
+        double a = registers[node.lhs];
+        double b = Expression::isUnary(node.op) ? 0.0 : registers[node.rhs];
+        double da, db;
+        partials(node.op, a, b, registers[i], da, db);
+
+        adjoints[node.lhs] += da * adjoint;
+        if (!Expression::isUnary(node.op)) {
+            adjoints[node.rhs] += db * adjoint;
+        }
+    }
+
+    return result;
+}
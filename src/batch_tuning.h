@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstddef>
+
+// Sizes shared by the batch paths (table, CSV, Monte Carlo). Internal to
+// the library sources.
+
+// Rows (Monte Carlo samples) per evaluateBatch call; keeps the register
+// file in L1/L2
+constexpr size_t CHUNK_ROWS = 512;
+
+// Significant digits that round-trip a float; float32 results print no more
+constexpr int FLOAT_DIGITS = 9;
+
+// Blocks allowed to be evaluated (or parsed) ahead of the writer, per worker
+constexpr size_t BLOCKS_IN_FLIGHT_PER_THREAD = 2;
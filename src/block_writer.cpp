@@ -0,0 +1,80 @@
+#include "block_writer.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+void writeBlocksInOrder(size_t blockCount, unsigned threads, size_t blocksInFlight,
+                        const std::function<void(size_t index, std::string& buffer)>& produce,
+                        std::FILE* out) {
+    if (blockCount == 0) return;
+    threads = static_cast<unsigned>(std::min<size_t>(std::max(1u, threads), blockCount));
+    size_t window = std::max<size_t>(blocksInFlight, threads);
+
+    std::vector<std::string> buffers(blockCount);
+    std::vector<char> ready(blockCount, 0);
+    std::atomic<size_t> nextBlock{0};
+    size_t written = 0;
+    std::mutex mutex;
+    std::condition_variable readyChanged;
+    std::condition_variable writtenChanged;
+    std::string error;
+
+    auto worker = [&]() {
+        for (;;) {
+            size_t index = nextBlock.fetch_add(1);
+            if (index >= blockCount) return;
+            {
+                // Bound memory: do not run too far ahead of the writer
+                std::unique_lock<std::mutex> lock(mutex);
+                writtenChanged.wait(lock, [&] { return index < written + window || !error.empty(); });
+                if (!error.empty()) return;
+            }
+            std::string buffer;
+            try {
+                produce(index, buffer);
+            } catch (const std::exception& e) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (error.empty()) error = e.what();
+                readyChanged.notify_all();
+                writtenChanged.notify_all();
+                return;
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            buffers[index] = std::move(buffer);
+            ready[index] = 1;
+            readyChanged.notify_all();
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (unsigned t = 0; t < threads; t++) {
+        pool.emplace_back(worker);
+    }
+
+    for (size_t index = 0; index < blockCount; index++) {
+        std::string buffer;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            readyChanged.wait(lock, [&] { return ready[index] || !error.empty(); });
+            if (!error.empty()) break;
+            buffer = std::move(buffers[index]);
+        }
+        std::fwrite(buffer.data(), 1, buffer.size(), out);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            written = index + 1;
+        }
+        writtenChanged.notify_all();
+    }
+
+    for (auto& t : pool) {
+        t.join();
+    }
+    if (!error.empty()) {
+        throw std::runtime_error(error);
+    }
+}
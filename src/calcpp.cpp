@@ -0,0 +1,217 @@
+#include "calcpp.h"
+#include "calculator.h"
+#include "parser.h"
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+
+struct calcpp_expr {
+    Expression expr;
+    std::vector<double> values;
+    std::vector<char> bound;
+    std::vector<double> registers;
+    std::vector<float> floatRegisters;
+};
+
+namespace {
+
+static_assert(static_cast<int>(ErrorCode::UNSUPPORTED_OPERATION) == CALCPP_ERR_UNSUPPORTED_OPERATION,
+              "calcpp_status must mirror ErrorCode");
+
+void setError(calcpp_error* error, calcpp_status status, size_t offset, const char* message) {
+    if (error == nullptr) return;
+    error->status = status;
+    error->offset = offset;
+    std::strncpy(error->message, message, sizeof(error->message) - 1);
+    error->message[sizeof(error->message) - 1] = '\0';
+}
+
+void setError(calcpp_error* error, const CalcError& calcError) {
+    setError(error, static_cast<calcpp_status>(calcError.code), calcError.offset, calcError.message.c_str());
+}
+
+void clearError(calcpp_error* error) {
+    if (error == nullptr) return;
+    error->status = CALCPP_OK;
+    error->offset = 0;
+    error->message[0] = '\0';
+}
+
+// Parser construction builds the function table; one per thread is enough
+Parser& threadParser() {
+    thread_local Parser parser;
+    return parser;
+}
+
+} // namespace
+
+extern "C" {
+
+calcpp_expr* calcpp_compile(const char* source, calcpp_error* error) {
+    if (source == nullptr) {
+        setError(error, CALCPP_ERR_INVALID_ARGUMENT, 0, "source is NULL");
+        return nullptr;
+    }
+    return calcpp_compile_n(source, std::strlen(source), error);
+}
+
+calcpp_expr* calcpp_compile_n(const char* source, size_t length, calcpp_error* error) {
+    if (source == nullptr) {
+        setError(error, CALCPP_ERR_INVALID_ARGUMENT, 0, "source is NULL");
+        return nullptr;
+    }
+    try {
+        Expression expr;
+        CalcError compileError;
+        if (!threadParser().tryCompile(source, length, expr, compileError)) {
+            setError(error, compileError);
+            return nullptr;
+        }
+        calcpp_expr* result = new calcpp_expr;
+        result->values.assign(expr.getVariableCount(), 0.0);
+        result->bound.assign(expr.getVariableCount(), 0);
+        result->expr = std::move(expr);
+        clearError(error);
+        return result;
+    } catch (const std::bad_alloc&) {
+        setError(error, CALCPP_ERR_OUT_OF_MEMORY, 0, "Out of memory");
+        return nullptr;
+    }
+}
+
+void calcpp_free(calcpp_expr* expr) {
+    delete expr;
+}
+
+size_t calcpp_variable_count(const calcpp_expr* expr) {
+    return expr ? expr->expr.getVariableCount() : 0;
+}
+
+const char* calcpp_variable_name(const calcpp_expr* expr, size_t index) {
+    if (expr == nullptr || index >= expr->expr.getVariableCount()) return nullptr;
+    return expr->expr.getVariableNames()[index].c_str();
+}
+
+int calcpp_variable_index(const calcpp_expr* expr, const char* name) {
+    if (expr == nullptr || name == nullptr) return -1;
+    try {
+        return expr->expr.findVariable(name);
+    } catch (const std::bad_alloc&) {
+        return -1;
+    }
+}
+
+calcpp_status calcpp_bind(calcpp_expr* expr, const char* name, double value) {
+    int index = calcpp_variable_index(expr, name);
+    if (index < 0) return CALCPP_ERR_UNDEFINED_VARIABLE;
+    return calcpp_bind_index(expr, static_cast<size_t>(index), value);
+}
+
+calcpp_status calcpp_bind_index(calcpp_expr* expr, size_t index, double value) {
+    if (expr == nullptr || index >= expr->values.size()) return CALCPP_ERR_INVALID_ARGUMENT;
+    expr->values[index] = value;
+    expr->bound[index] = 1;
+    return CALCPP_OK;
+}
+
+calcpp_status calcpp_eval(calcpp_expr* expr, double* result, calcpp_error* error) {
+    if (expr == nullptr || result == nullptr) {
+        setError(error, CALCPP_ERR_INVALID_ARGUMENT, 0, "expr or result is NULL");
+        return CALCPP_ERR_INVALID_ARGUMENT;
+    }
+    for (size_t i = 0; i < expr->bound.size(); i++) {
+        if (!expr->bound[i]) {
+            std::string message = "Variable not defined: " + expr->expr.getVariableNames()[i];
+            setError(error, CALCPP_ERR_UNDEFINED_VARIABLE, expr->expr.getVariableOffset(i), message.c_str());
+            return CALCPP_ERR_UNDEFINED_VARIABLE;
+        }
+    }
+    try {
+        CalcError evalError;
+        if (!expr->expr.tryEvaluate(expr->values.data(), expr->registers, *result, evalError)) {
+            setError(error, evalError);
+            return static_cast<calcpp_status>(evalError.code);
+        }
+    } catch (const std::bad_alloc&) {
+        setError(error, CALCPP_ERR_OUT_OF_MEMORY, 0, "Out of memory");
+        return CALCPP_ERR_OUT_OF_MEMORY;
+    }
+    clearError(error);
+    return CALCPP_OK;
+}
+
+calcpp_status calcpp_eval_batch(calcpp_expr* expr, const double* const* columns, size_t count, double* out) {
+    if (expr == nullptr || out == nullptr || (columns == nullptr && expr->expr.getVariableCount() > 0)) {
+        return CALCPP_ERR_INVALID_ARGUMENT;
+    }
+    if (expr->expr.hasMatrixOps()) return CALCPP_ERR_UNSUPPORTED_OPERATION;
+    try {
+        expr->expr.evaluateBatch(columns, count, out, expr->registers);
+    } catch (const std::bad_alloc&) {
+        return CALCPP_ERR_OUT_OF_MEMORY;
+    }
+    return CALCPP_OK;
+}
+
+calcpp_status calcpp_eval_batch_f32(calcpp_expr* expr, const float* const* columns, size_t count, float* out) {
+    if (expr == nullptr || out == nullptr || (columns == nullptr && expr->expr.getVariableCount() > 0)) {
+        return CALCPP_ERR_INVALID_ARGUMENT;
+    }
+    if (expr->expr.hasMatrixOps()) return CALCPP_ERR_UNSUPPORTED_OPERATION;
+    try {
+        expr->expr.evaluateBatch(columns, count, out, expr->floatRegisters);
+    } catch (const std::bad_alloc&) {
+        return CALCPP_ERR_OUT_OF_MEMORY;
+    }
+    return CALCPP_OK;
+}
+
+size_t calcpp_format(double value, int precision, char* buffer, size_t size, calcpp_status* status) {
+    if (precision < 1 || precision > 20 || (buffer == nullptr && size > 0)) {
+        if (status) *status = CALCPP_ERR_INVALID_ARGUMENT;
+        return 0;
+    }
+    char text[Calculator::FORMAT_BUFFER_SIZE];
+    size_t length = Calculator::formatNumber(value, precision, text);
+    if (length + 1 > size) {
+        if (size > 0) {
+            std::memcpy(buffer, text, size - 1);
+            buffer[size - 1] = '\0';
+        }
+        if (status) *status = CALCPP_ERR_BUFFER_TOO_SMALL;
+        return length;
+    }
+    std::memcpy(buffer, text, length);
+    buffer[length] = '\0';
+    if (status) *status = CALCPP_OK;
+    return length;
+}
+
+const char* calcpp_status_string(calcpp_status status) {
+    switch (status) {
+        case CALCPP_OK: return "ok";
+        case CALCPP_ERR_UNKNOWN_CHARACTER: return "unknown character";
+        case CALCPP_ERR_INVALID_NUMBER: return "invalid number";
+        case CALCPP_ERR_UNEXPECTED_TOKEN: return "unexpected token";
+        case CALCPP_ERR_EXPECTED_LPAREN: return "expected '('";
+        case CALCPP_ERR_EXPECTED_RPAREN: return "expected ')'";
+        case CALCPP_ERR_EXPECTED_RBRACKET: return "expected ']'";
+        case CALCPP_ERR_EXPECTED_COMMA: return "expected ','";
+        case CALCPP_ERR_UNKNOWN_FUNCTION: return "unknown function";
+        case CALCPP_ERR_UNDEFINED_VARIABLE: return "undefined variable";
+        case CALCPP_ERR_DIVISION_BY_ZERO: return "division by zero";
+        case CALCPP_ERR_MODULO_BY_ZERO: return "modulo by zero";
+        case CALCPP_ERR_UNSUPPORTED_OPERATION: return "unsupported operation";
+        case CALCPP_ERR_INVALID_ARGUMENT: return "invalid argument";
+        case CALCPP_ERR_OUT_OF_MEMORY: return "out of memory";
+        case CALCPP_ERR_BUFFER_TOO_SMALL: return "buffer too small";
+    }
+    return "unknown status";
+}
+
+const char* calcpp_version(void) {
+    return "1.0.0";
+}
+
+} // extern "C"
@@ -1,19 +1,302 @@
 #include "calculator.h"
-#include <iomanip>
-#include <sstream>
+#include "autodiff.h"
+#include "random.h"
+#include <algorithm>
 #include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+const double POWERS_OF_TEN[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+    1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20
+};
+
+const char DIGIT_PAIRS[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+size_t countDigits(uint64_t value) {
+    size_t count = 1;
+    while (value >= 10) {
+        value /= 10;
+        count++;
+    }
+    return count;
+}
+
+// Writes value as exactly `count` digits (zero padded), two at a time
+size_t writeDigits(uint64_t value, size_t count, char* out) {
+    size_t i = count;
+    while (i >= 2) {
+        std::memcpy(out + i - 2, DIGIT_PAIRS + (value % 100) * 2, 2);
+        value /= 100;
+        i -= 2;
+    }
+    if (i == 1) out[0] = static_cast<char>('0' + value % 10);
+    return count;
+}
+
+// Same output as printf("%.*f"), without the printf machinery for the
+// common case. The integer part (exact below 2^53) is printed as is; the
+// fraction, also exact, is scaled by 10^precision and rounded to an integer
+// that is printed digit by digit. fma recovers the rounding error of the
+// scaling, so halfway cases are decided on the exact product (ties to even,
+// like printf). Larger values fall back to snprintf.
+size_t formatFixed(double value, int precision, char* buffer) {
+    const double LIMIT = 9007199254740992.0;  // 2^53
+    double magnitude = std::abs(value);
+    if (magnitude < LIMIT) {
+        // Truncating conversions stand in for floor on non-negative values
+        uint64_t whole = static_cast<uint64_t>(magnitude);
+        double fraction = magnitude - static_cast<double>(whole);
+        double scale = POWERS_OF_TEN[precision];
+        double scaled = fraction * scale;
+        if (scaled < LIMIT) {
+            uint64_t digits = static_cast<uint64_t>(scaled);
+            double error = std::fma(fraction, scale, -scaled);
+            // Sign of (exact product - digits - 0.5); both terms are exact
+            double aboveHalf = (scaled - static_cast<double>(digits) - 0.5) + error;
+            if (aboveHalf > 0 || (aboveHalf == 0 && (digits & 1))) digits++;
+            if (static_cast<double>(digits) >= scale) {
+                // Fraction rounded up to the next integer
+                digits = 0;
+                whole++;
+            }
+
+            size_t length = 0;
+            if (std::signbit(value)) buffer[length++] = '-';
+            length += writeDigits(whole, countDigits(whole), buffer + length);
+            if (precision > 0) {
+                buffer[length++] = '.';
+                length += writeDigits(digits, static_cast<size_t>(precision), buffer + length);
+            }
+            return length;
+        }
+    }
+    int written = std::snprintf(buffer, Calculator::FORMAT_BUFFER_SIZE, "%.*f", precision, value);
+    return static_cast<size_t>(written);
+}
+
+} // namespace
 
 Calculator::Calculator() : precision(15), lastResult(0.0) {}
 
 double Calculator::calculate(const std::string& expression) {
-    try {
-        parser.setVariables(&variables);
-        lastResult = parser.parse(expression);
+    Matrix result = evaluate(expression);
+    if (!result.isScalar()) {
+        throw std::runtime_error("Result is not a scalar");
+    }
+    return result[0];
+}
+
+Matrix Calculator::evaluate(const std::string& expression) {
+    return evaluate(parser.compile(expression));
+}
+
+Matrix Calculator::evaluate(const Expression& expr) {
+    bool matrixValued = expr.hasMatrixOps();
+    for (const auto& name : expr.getVariableNames()) {
+        if (matrices.count(name)) matrixValued = true;
+    }
+
+    if (!matrixValued) {
+        std::vector<double> values = expr.bindVariables(variables);
+        lastResult = expr.evaluate(values.data());
         variables["ans"] = lastResult;  // Automatically update 'ans' variable
-        return lastResult;
-    } catch (const std::exception& e) {
-        throw;
+        matrices.erase("ans");
+        return Matrix::scalar(lastResult);
+    }
+
+    std::vector<Matrix> values;
+    for (size_t slot = 0; slot < expr.getVariableCount(); slot++) {
+        const std::string& name = expr.getVariableNames()[slot];
+        auto it = matrices.find(name);
+        if (it != matrices.end()) {
+            values.push_back(it->second);
+        } else if (variables.count(name)) {
+            values.push_back(Matrix::scalar(variables[name]));
+        } else {
+            CalcError error;
+            error.set(ErrorCode::UNDEFINED_VARIABLE, expr.getVariableOffset(slot), "Variable not defined: " + name);
+            throw CalcException(error);
+        }
+    }
+
+    Matrix result = evaluateMatrix(expr, values);
+    if (result.isScalar()) {
+        lastResult = result[0];
+        variables["ans"] = lastResult;
+        matrices.erase("ans");
+    } else {
+        matrices["ans"] = result;
+        variables.erase("ans");
+    }
+    return result;
+}
+
+double Calculator::differentiate(const std::string& expression, const std::string& variable) {
+    Expression expr = parser.compile(expression);
+    int slot = expr.findVariable(variable);
+    if (slot < 0 && !hasVariable(variable)) {
+        throw std::runtime_error("Variable not defined: " + variable);
+    }
+    std::vector<double> values = expr.bindVariables(variables);
+    if (slot < 0) {
+        // Expression does not depend on the variable
+        expr.evaluate(values.data());
+        lastResult = 0.0;
+    } else {
+        lastResult = ::differentiate(expr, values.data(), static_cast<size_t>(slot)).derivative;
+    }
+    variables["ans"] = lastResult;
+    return lastResult;
+}
+
+std::vector<std::pair<std::string, double>> Calculator::gradient(const std::string& expression) {
+    Expression expr = parser.compile(expression);
+    std::vector<double> values = expr.bindVariables(variables);
+    std::vector<double> grad(expr.getVariableCount());
+    ::gradient(expr, values.data(), grad.data());
+
+    std::vector<std::pair<std::string, double>> result;
+    for (size_t i = 0; i < grad.size(); i++) {
+        result.emplace_back(expr.getVariableNames()[i], grad[i]);
+    }
+    return result;
+}
+
+TableGenerator::Stats Calculator::tabulate(const std::string& arguments, TableGenerator::Format format,
+                                           unsigned threads, std::FILE* out, bool float32) {
+    std::vector<std::string> parts = TableGenerator::splitArguments(arguments);
+    if (parts.size() != 5) {
+        throw std::runtime_error("table() requires expr, variable, start, stop and step");
+    }
+
+    // Bounds are evaluated without touching ans
+    double bounds[3];
+    for (int i = 0; i < 3; i++) {
+        Expression bound = parser.compile(parts[2 + i]);
+        std::vector<double> values = bound.bindVariables(variables);
+        bounds[i] = bound.evaluate(values.data());
+    }
+
+    TableGenerator::Options options;
+    options.expression = parts[0];
+    options.variable = parts[1];
+    options.start = bounds[0];
+    options.stop = bounds[1];
+    options.step = bounds[2];
+    options.format = format;
+    options.precision = precision;
+    options.threads = threads;
+    options.float32 = float32;
+    TableGenerator generator(options, variables);
+    return generator.run(out);
+}
+
+Profiler Calculator::profile(const std::string& expression, size_t iterations) {
+    Profiler profiler(expression, variables);
+    profiler.run(iterations);
+    return profiler;
+}
+
+MonteCarlo::Result Calculator::monteCarlo(const std::string& arguments, unsigned threads) {
+    std::vector<std::string> parts = TableGenerator::splitArguments(arguments);
+    if (parts.size() != 2 && parts.size() != 3) {
+        throw std::runtime_error("mc() requires expr, sample count and an optional seed");
+    }
+
+    // Like table bounds, the counts are evaluated without touching ans
+    double counts[2];
+    for (size_t i = 1; i < parts.size(); i++) {
+        Expression count = parser.compile(parts[i]);
+        std::vector<double> values = count.bindVariables(variables);
+        counts[i - 1] = count.evaluate(values.data());
+        if (!(counts[i - 1] >= 0 && counts[i - 1] < 0x1p64 && std::floor(counts[i - 1]) == counts[i - 1])) {
+            throw std::runtime_error(i == 1 ? "mc sample count must be a positive integer"
+                                            : "mc seed must be a non-negative integer");
+        }
+    }
+
+    MonteCarlo::Options options;
+    options.expression = parts[0];
+    options.samples = static_cast<uint64_t>(counts[0]);
+    options.seed = parts.size() == 3 ? static_cast<uint64_t>(counts[1]) : Random::randomSeed();
+    options.threads = threads;
+    MonteCarlo::Result result = MonteCarlo(options, variables).run();
+    lastResult = result.mean;
+    variables["ans"] = lastResult;
+    return result;
+}
+
+std::string Calculator::formatMonteCarlo(const MonteCarlo::Result& result) const {
+    std::string text;
+    text += "mean       " + formatResult(result.mean) + "\n";
+    text += "variance   " + formatResult(result.variance) + "\n";
+    text += "std error  " + formatResult(result.standardError) + "\n";
+    text += "95% CI     [" + formatResult(result.low) + ", " + formatResult(result.high) + "]\n";
+    text += "samples    " + std::to_string(result.samples);
+    if (result.invalid > 0) text += " (" + std::to_string(result.invalid) + " NaN or infinite, excluded)";
+    text += "\nseed       " + std::to_string(result.seed) + "\n";
+    return text;
+}
+
+std::string Calculator::identify(const std::string& arguments) {
+    std::vector<std::string> parts = TableGenerator::splitArguments(arguments);
+    if (parts.size() > 2) {
+        throw std::runtime_error("identify requires an expression and an optional tolerance");
+    }
+    // Evaluated without touching ans
+    double numbers[2] = {lastResult, ClosedFormIndex::DEFAULT_TOLERANCE};
+    for (size_t i = 0; i < parts.size(); i++) {
+        if (parts[i].empty()) continue;
+        Expression expr = parser.compile(parts[i]);
+        std::vector<double> values = expr.bindVariables(variables);
+        numbers[i] = expr.evaluate(values.data());
+    }
+    double value = numbers[0];
+    double tolerance = numbers[1];
+    if (!std::isfinite(value)) {
+        throw std::runtime_error("identify requires a finite value");
+    }
+    if (!(tolerance >= 0)) {
+        throw std::runtime_error("identify tolerance must not be negative");
+    }
+
+    if (!closedForms) {
+        std::string path = identifyIndexPath.empty() ? ClosedFormIndex::findDefault() : identifyIndexPath;
+        if (path.empty()) {
+            throw std::runtime_error("No closed-form index found; create one with 'calcpp --build-index FILE' "
+                                     "and set CALCPP_IDENTIFY_INDEX");
+        }
+        closedForms = std::make_shared<ClosedFormIndex>(path);
+    }
+
+    char line[160];
+    std::snprintf(line, sizeof(line), " (tolerance %g)\n", tolerance);
+    std::string text = formatResult(value) + line;
+    std::vector<ClosedFormIndex::Match> matches = closedForms->identify(value, tolerance);
+    if (matches.empty()) {
+        ClosedFormIndex::Match nearest = closedForms->nearest(value);
+        std::snprintf(line, sizeof(line), " (relative error %.3g)\n", nearest.relativeError);
+        return text + "  no closed form within tolerance; nearest is " + nearest.expression + line;
+    }
+    for (const auto& match : matches) {
+        std::snprintf(line, sizeof(line), "  %-32s relative error %.3g\n", match.expression.c_str(),
+                      match.relativeError);
+        text += line;
     }
+    return text;
+}
+
+void Calculator::setIdentifyIndex(const std::string& path) {
+    identifyIndexPath = path;
+    closedForms.reset();
 }
 
 void Calculator::setPrecision(int digits) {
@@ -29,6 +312,7 @@ int Calculator::getPrecision() const {
 
 void Calculator::setVariable(const std::string& name, double value) {
     variables[name] = value;
+    matrices.erase(name);
 }
 
 double Calculator::getVariable(const std::string& name) {
@@ -42,8 +326,22 @@ bool Calculator::hasVariable(const std::string& name) const {
     return variables.find(name) != variables.end();
 }
 
+void Calculator::setMatrix(const std::string& name, const Matrix& value) {
+    if (value.isScalar()) {
+        setVariable(name, value[0]);
+        return;
+    }
+    matrices[name] = value;
+    variables.erase(name);
+}
+
+bool Calculator::hasMatrix(const std::string& name) const {
+    return matrices.find(name) != matrices.end();
+}
+
 void Calculator::clearVariables() {
     variables.clear();
+    matrices.clear();
 }
 
 double Calculator::getLastResult() const {
@@ -55,24 +353,63 @@ void Calculator::setLastResult(double value) {
 }
 
 std::string Calculator::formatResult(double value) const {
+    char buffer[FORMAT_BUFFER_SIZE];
+    return std::string(buffer, formatNumber(value, precision, buffer));
+}
+
+size_t Calculator::formatNumber(double value, int precision, char* buffer) {
     // Handle special cases
-    if (std::isnan(value)) return "NaN";
-    if (std::isinf(value)) return (value > 0) ? "Infinity" : "-Infinity";
+    if (std::isnan(value)) {
+        std::memcpy(buffer, "NaN", 3);
+        return 3;
+    }
+    if (std::isinf(value)) {
+        const char* text = (value > 0) ? "Infinity" : "-Infinity";
+        size_t length = std::strlen(text);
+        std::memcpy(buffer, text, length);
+        return length;
+    }
 
-    std::ostringstream oss;
-    oss << std::fixed << std::setprecision(precision) << value;
-    std::string result = oss.str();
+    size_t length = formatFixed(value, precision, buffer);
 
     // Remove trailing zeros
-    size_t dotPos = result.find('.');
-    if (dotPos != std::string::npos) {
-        size_t lastNonZero = result.find_last_not_of('0');
-        if (lastNonZero != std::string::npos && lastNonZero > dotPos) {
-            result = result.substr(0, lastNonZero + 1);
-        } else if (lastNonZero == dotPos) {
-            result = result.substr(0, dotPos);
+    const char* dot = static_cast<const char*>(std::memchr(buffer, '.', length));
+    if (dot != nullptr) {
+        size_t dotPos = static_cast<size_t>(dot - buffer);
+        while (length > dotPos + 1 && buffer[length - 1] == '0') {
+            length--;
+        }
+        if (length == dotPos + 1) {
+            length = dotPos;
         }
     }
 
+    return length;
+}
+
+size_t Calculator::formatSignificant(double value, int digits, int precision, char* buffer) {
+    if (value != 0 && std::isfinite(value)) {
+        // Decimals past the digits-th significant one are dropped; rounding
+        // up to the next power of ten only adds a trailing zero
+        int exponent = static_cast<int>(std::floor(std::log10(std::abs(value))));
+        precision = std::max(0, std::min(precision, digits - 1 - exponent));
+    }
+    return formatNumber(value, precision, buffer);
+}
+
+std::string Calculator::formatValue(const Matrix& value) const {
+    if (value.isScalar()) return formatResult(value[0]);
+
+    std::string result = "[";
+    for (size_t r = 0; r < value.rows(); r++) {
+        if (r > 0) result += ", ";
+        if (!value.isVector()) result += "[";
+        for (size_t c = 0; c < value.cols(); c++) {
+            if (c > 0) result += ", ";
+            result += formatResult(value(r, c));
+        }
+        if (!value.isVector()) result += "]";
+    }
+    result += "]";
     return result;
 }
@@ -0,0 +1,451 @@
+#include "closed_form_index.h"
+#include "parser.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <numeric>
+#include <stdexcept>
+
+namespace {
+
+const char MAGIC[8] = {'C', 'A', 'L', 'C', 'I', 'D', 'X', '\0'};
+
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t atomCount;
+    uint64_t entryCount;
+    uint64_t namesSize;     // bytes of NUL-terminated atom names
+};
+
+enum Form : uint32_t { MUL, DIV, ADD, SUB };
+
+constexpr uint32_t MAX_ATOMS = 1024;
+constexpr uint32_t MAX_INTEGER = 1023;
+
+// Integer ranges of the combinations
+constexpr uint32_t RATIONAL_LIMIT = 1000;  // p/q on its own
+constexpr uint32_t SCALE_LIMIT = 60;       // p*A/q and p/(q*A)
+constexpr uint32_t SHIFT_LIMIT = 12;       // (A+p)/q and (A-p)/q
+
+// Candidates in a tolerance window that are ranked at most; a wider window
+// is narrowed to the entries nearest the query
+constexpr size_t MAX_WINDOW = 4096;
+
+// Values this close (relative) are treated as the same number
+constexpr double SAME_VALUE = 4.5e-16;
+
+struct Atom {
+    std::string name;
+    uint8_t weight;
+    double value = 0.0;
+    // A product such as pi*sqrt(2) is head * tail; "3*pi*sqrt(2)" parses as
+    // (3*pi)*sqrt(2), and candidates are computed the same way
+    double head = 0.0;
+    double tail = 1.0;
+};
+
+size_t align8(size_t size) {
+    return (size + 7) & ~static_cast<size_t>(7);
+}
+
+bool isSquarefree(uint32_t n) {
+    for (uint32_t d = 2; d * d <= n; d++) {
+        if (n % (d * d) == 0) return false;
+    }
+    return true;
+}
+
+bool isCubefree(uint32_t n) {
+    for (uint32_t d = 2; d * d * d <= n; d++) {
+        if (n % (d * d * d) == 0) return false;
+    }
+    return true;
+}
+
+bool isPerfectPower(uint32_t n) {
+    for (uint32_t base = 2; base * base <= n; base++) {
+        uint32_t power = base * base;
+        while (power < n) power *= base;
+        if (power == n) return true;
+    }
+    return false;
+}
+
+// Everything a candidate combines with integers. Weights rank how simple a
+// form reads; constants and square roots come first. Values come from the
+// parser, so an entry's formula evaluates back to exactly its stored value.
+std::vector<Atom> makeAtoms() {
+    std::vector<Atom> atoms = {
+        {"1", 0},
+        {"pi", 1},
+        {"e", 1},
+        {"phi", 1},
+        {"pi^2", 2},
+        {"pi^3", 2},
+        {"pi^4", 3},
+        {"e^2", 2},
+        {"e^3", 3},
+        {"e^pi", 3},
+        {"pi^e", 3},
+        {"pi*e", 3},
+        {"sqrt(pi)", 2},
+        {"sqrt(e)", 2},
+        {"sqrt(phi)", 3},
+        {"sqrt(2*pi)", 3},
+        {"pi^(1/3)", 3},
+        {"ln(pi)", 3},
+        {"ln(phi)", 3},
+    };
+    for (uint32_t n = 2; n <= 200; n++) {
+        if (isSquarefree(n)) atoms.push_back({"sqrt(" + std::to_string(n) + ")", 2});
+    }
+    for (uint32_t n = 2; n <= 100; n++) {
+        if (isCubefree(n) && !isPerfectPower(n)) {
+            atoms.push_back({std::to_string(n) + "^(1/3)", 3});
+        }
+    }
+    for (uint32_t n = 2; n <= 50; n++) {
+        if (isSquarefree(n)) atoms.push_back({std::to_string(n) + "^(1/4)", 3});
+    }
+    for (uint32_t n = 2; n <= 100; n++) {
+        if (!isPerfectPower(n)) atoms.push_back({"ln(" + std::to_string(n) + ")", 2});
+    }
+    for (uint32_t n = 2; n <= 30; n++) {
+        if (n != 10 && !isPerfectPower(n)) {
+            atoms.push_back({"log10(" + std::to_string(n) + ")", 3});
+        }
+    }
+    for (uint32_t n = 2; n <= 30; n++) {
+        if (isSquarefree(n)) atoms.push_back({"pi*sqrt(" + std::to_string(n) + ")", 3});
+    }
+    Parser parser;
+    for (Atom& atom : atoms) {
+        atom.value = parser.compile(atom.name).evaluate(nullptr);
+        atom.head = atom.value;
+        int depth = 0;
+        for (size_t i = 0; i < atom.name.size(); i++) {
+            char c = atom.name[i];
+            depth += c == '(' ? 1 : c == ')' ? -1 : 0;
+            if (c == '*' && depth == 0) {
+                atom.head = parser.compile(atom.name.substr(0, i)).evaluate(nullptr);
+                atom.tail = parser.compile(atom.name.substr(i + 1)).evaluate(nullptr);
+                break;
+            }
+        }
+    }
+    return atoms;
+}
+
+uint32_t packCode(uint32_t form, uint32_t atom, uint32_t p, uint32_t q) {
+    return form | atom << 2 | p << 12 | q << 22;
+}
+
+uint32_t formOf(uint32_t code) { return code & 3; }
+uint32_t atomOf(uint32_t code) { return (code >> 2) & (MAX_ATOMS - 1); }
+uint32_t numeratorOf(uint32_t code) { return (code >> 12) & MAX_INTEGER; }
+uint32_t denominatorOf(uint32_t code) { return code >> 22; }
+
+// The value of the candidate as the parser evaluates formatName()
+double combine(uint32_t form, const Atom& atom, uint32_t p, uint32_t q) {
+    switch (form) {
+        case MUL: return p == 1 ? atom.value / q : p * atom.head * atom.tail / q;
+        case DIV: return q == 1 ? p / atom.value : p / (q * atom.head * atom.tail);
+        case ADD: return (atom.value + p) / q;
+        default:  return std::abs(atom.value - p) / q;
+    }
+}
+
+int digitCost(uint32_t n) {
+    return n == 1 ? 0 : n < 10 ? 1 : n < 100 ? 2 : 3;
+}
+
+int complexityOf(uint32_t code, uint8_t atomWeight) {
+    int formCost = formOf(code) == MUL ? 0 : 1;
+    return atomWeight + formCost + digitCost(numeratorOf(code)) + digitCost(denominatorOf(code));
+}
+
+std::string formatName(uint32_t code, const std::string& atom, double atomValue) {
+    uint32_t p = numeratorOf(code);
+    uint32_t q = denominatorOf(code);
+    std::string ps = std::to_string(p);
+    std::string qs = std::to_string(q);
+    switch (formOf(code)) {
+        case MUL: {
+            std::string text = atom == "1" ? ps : (p == 1 ? atom : ps + "*" + atom);
+            return q == 1 ? text : text + "/" + qs;
+        }
+        case DIV: {
+            bool product = atom.find('*') != std::string::npos;
+            return ps + "/" + (q == 1 ? (product ? "(" + atom + ")" : atom) : "(" + qs + "*" + atom + ")");
+        }
+        case ADD: {
+            std::string sum = atom + "+" + ps;
+            return q == 1 ? sum : "(" + sum + ")/" + qs;
+        }
+        default: {
+            std::string difference = atomValue > p ? atom + "-" + ps : ps + "-" + atom;
+            return q == 1 ? difference : "(" + difference + ")/" + qs;
+        }
+    }
+}
+
+struct Candidate {
+    double value;
+    uint32_t code;
+    int complexity;
+};
+
+void writeSection(std::FILE* out, const void* data, size_t size, const std::string& path) {
+    static const char padding[8] = {};
+    if ((size > 0 && std::fwrite(data, 1, size, out) != size) ||
+        std::fwrite(padding, 1, align8(size) - size, out) != align8(size) - size) {
+        std::fclose(out);
+        throw std::runtime_error("Cannot write " + path);
+    }
+}
+
+} // namespace
+
+ClosedFormIndex::ClosedFormIndex(const std::string& path) {
+    open(path);
+}
+
+void ClosedFormIndex::open(const std::string& path) {
+    file.open(path);
+    auto invalid = [&]() {
+        file.close();
+        entryCount = 0;
+        throw std::runtime_error("Not a closed-form index of this calcpp version: " + path);
+    };
+    const char* base = file.data();
+    size_t size = file.size();
+    Header header;
+    if (size < sizeof(header)) invalid();
+    std::memcpy(&header, base, sizeof(header));
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != FORMAT_VERSION ||
+        header.atomCount == 0 || header.atomCount > MAX_ATOMS) {
+        invalid();
+    }
+
+    size_t offset = align8(sizeof(header));
+    size_t atomBytes = header.atomCount * sizeof(double) + align8(header.atomCount);
+    if (size - offset < atomBytes || size - offset - atomBytes < header.namesSize) invalid();
+    atomValues = reinterpret_cast<const double*>(base + offset);
+    atomWeights = reinterpret_cast<const uint8_t*>(base + offset + header.atomCount * sizeof(double));
+    offset += atomBytes;
+
+    atomNames.clear();
+    const char* names = base + offset;
+    const char* namesEnd = names + header.namesSize;
+    for (uint32_t i = 0; i < header.atomCount; i++) {
+        const char* end = static_cast<const char*>(std::memchr(names, '\0', namesEnd - names));
+        if (!end) invalid();
+        atomNames.push_back(names);
+        names = end + 1;
+    }
+    offset += align8(header.namesSize);
+
+    if (offset > size || header.entryCount > (size - offset) / (sizeof(double) + sizeof(uint32_t))) invalid();
+    entryCount = static_cast<size_t>(header.entryCount);
+    values = reinterpret_cast<const double*>(base + offset);
+    codes = reinterpret_cast<const uint32_t*>(base + offset + entryCount * sizeof(double));
+}
+
+ClosedFormIndex::Match ClosedFormIndex::describe(size_t entry, double query) const {
+    uint32_t code = codes[entry];
+    uint32_t atom = atomOf(code);
+    if (atom >= atomNames.size()) {
+        throw std::runtime_error("Corrupt closed-form index entry");
+    }
+    Match match;
+    match.expression = formatName(code, atomNames[atom], atomValues[atom]);
+    match.value = values[entry];
+    match.complexity = complexityOf(code, atomWeights[atom]);
+    if (query < 0) {
+        // Prefix minus binds to the first factor (-pi^2 is (-pi)^2), and a
+        // bare sum needs its own parentheses
+        uint32_t form = formOf(code);
+        bool wrap = ((form == ADD || form == SUB) && denominatorOf(code) == 1) ||
+                    (form == MUL && numeratorOf(code) == 1 && std::strchr(atomNames[atom], '^'));
+        match.expression = wrap ? "-(" + match.expression + ")" : "-" + match.expression;
+        match.value = -match.value;
+    }
+    match.relativeError = std::abs(match.value - query) / std::abs(query);
+    return match;
+}
+
+std::vector<ClosedFormIndex::Match> ClosedFormIndex::identify(double value, double tolerance,
+                                                               size_t maxMatches) const {
+    if (!isOpen()) {
+        throw std::runtime_error("No closed-form index is open");
+    }
+    std::vector<Match> matches;
+    if (!std::isfinite(value) || maxMatches == 0) return matches;
+    if (value == 0) {
+        matches.push_back({"0", 0.0, 0.0, 0});
+        return matches;
+    }
+
+    double target = std::abs(value);
+    tolerance = std::max(tolerance, 0.0);
+    const double* end = values + entryCount;
+    size_t begin = std::lower_bound(values, end, target * (1 - tolerance)) - values;
+    size_t last = std::upper_bound(values + begin, end, target * (1 + tolerance)) - values;
+    if (last - begin > MAX_WINDOW) {
+        size_t center = std::lower_bound(values + begin, values + last, target) - values;
+        begin = std::max(begin, center - std::min(center - begin, MAX_WINDOW / 2));
+        last = std::min(last, begin + MAX_WINDOW);
+    }
+
+    // Simplest first, then closest
+    std::vector<std::pair<int, size_t>> window;
+    for (size_t i = begin; i < last; i++) {
+        uint32_t atom = atomOf(codes[i]);
+        window.push_back({complexityOf(codes[i], atom < atomNames.size() ? atomWeights[atom] : 0), i});
+    }
+    std::sort(window.begin(), window.end(), [&](const auto& a, const auto& b) {
+        if (a.first != b.first) return a.first < b.first;
+        return std::abs(values[a.second] - target) < std::abs(values[b.second] - target);
+    });
+    for (size_t i = 0; i < window.size() && matches.size() < maxMatches; i++) {
+        matches.push_back(describe(window[i].second, value));
+    }
+    return matches;
+}
+
+ClosedFormIndex::Match ClosedFormIndex::nearest(double value) const {
+    if (!isOpen() || entryCount == 0) {
+        throw std::runtime_error("No closed-form index is open");
+    }
+    if (value == 0) return {"0", 0.0, 0.0, 0};
+    double target = std::abs(value);
+    size_t i = std::lower_bound(values, values + entryCount, target) - values;
+    if (i == entryCount || (i > 0 && target - values[i - 1] < values[i] - target)) i--;
+    return describe(i, value);
+}
+
+ClosedFormIndex::Match ClosedFormIndex::entry(size_t i) const {
+    if (i >= entryCount) {
+        throw std::out_of_range("Closed-form index entry out of range");
+    }
+    return describe(i, values[i]);
+}
+
+ClosedFormIndex::BuildStats ClosedFormIndex::build(const std::string& path) {
+    std::vector<Atom> atoms = makeAtoms();
+    if (atoms.size() > MAX_ATOMS) {
+        throw std::logic_error("Too many closed-form atoms for the index code");
+    }
+    BuildStats stats;
+    std::vector<Candidate> candidates;
+    auto add = [&](uint32_t form, uint32_t atom, uint32_t p, uint32_t q) {
+        double value = combine(form, atoms[atom], p, q);
+        if (!(value > 0) || !std::isfinite(value)) return;
+        uint32_t code = packCode(form, atom, p, q);
+        candidates.push_back({value, code, complexityOf(code, atoms[atom].weight)});
+    };
+
+    // Rationals, then each atom scaled and shifted by small integers
+    for (uint32_t q = 1; q <= RATIONAL_LIMIT; q++) {
+        for (uint32_t p = 1; p <= RATIONAL_LIMIT; p++) {
+            if (std::gcd(p, q) == 1) add(MUL, 0, p, q);
+        }
+    }
+    for (uint32_t atom = 1; atom < atoms.size(); atom++) {
+        for (uint32_t q = 1; q <= SCALE_LIMIT; q++) {
+            for (uint32_t p = 1; p <= SCALE_LIMIT; p++) {
+                if (std::gcd(p, q) != 1) continue;
+                add(MUL, atom, p, q);
+                add(DIV, atom, p, q);
+            }
+        }
+        for (uint32_t q = 1; q <= SHIFT_LIMIT; q++) {
+            for (uint32_t p = 1; p <= SHIFT_LIMIT; p++) {
+                add(ADD, atom, p, q);
+                add(SUB, atom, p, q);
+            }
+        }
+    }
+    stats.candidates = candidates.size();
+
+    std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) {
+        if (a.value != b.value) return a.value < b.value;
+        if (a.complexity != b.complexity) return a.complexity < b.complexity;
+        return a.code < b.code;
+    });
+    // Equal values (sqrt(2)/2 = 1/sqrt(2), up to rounding) keep the simplest form
+    std::vector<double> values;
+    std::vector<uint32_t> codes;
+    std::vector<int> complexities;
+    for (const Candidate& c : candidates) {
+        if (!values.empty() && c.value - values.back() <= values.back() * SAME_VALUE) {
+            if (c.complexity < complexities.back()) {
+                values.back() = c.value;
+                codes.back() = c.code;
+                complexities.back() = c.complexity;
+            }
+            continue;
+        }
+        values.push_back(c.value);
+        codes.push_back(c.code);
+        complexities.push_back(c.complexity);
+    }
+    candidates.clear();
+    candidates.shrink_to_fit();
+    stats.entries = values.size();
+
+    Header header = {};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = FORMAT_VERSION;
+    header.atomCount = static_cast<uint32_t>(atoms.size());
+    header.entryCount = values.size();
+    std::vector<double> atomValues;
+    std::vector<uint8_t> weights;
+    std::string names;
+    for (const Atom& atom : atoms) {
+        atomValues.push_back(atom.value);
+        weights.push_back(atom.weight);
+        names += atom.name;
+        names.push_back('\0');
+    }
+    header.namesSize = names.size();
+
+    std::FILE* out = std::fopen(path.c_str(), "wb");
+    if (!out) {
+        throw std::runtime_error("Cannot create " + path);
+    }
+    writeSection(out, &header, sizeof(header), path);
+    writeSection(out, atomValues.data(), atomValues.size() * sizeof(double), path);
+    writeSection(out, weights.data(), weights.size(), path);
+    writeSection(out, names.data(), names.size(), path);
+    writeSection(out, values.data(), values.size() * sizeof(double), path);
+    writeSection(out, codes.data(), codes.size() * sizeof(uint32_t), path);
+    if (std::fclose(out) != 0) {
+        throw std::runtime_error("Cannot write " + path);
+    }
+    stats.bytes = align8(sizeof(header)) + atomValues.size() * sizeof(double) + align8(weights.size()) +
+                  align8(names.size()) + values.size() * (sizeof(double) + sizeof(uint32_t));
+    return stats;
+}
+
+std::string ClosedFormIndex::findDefault() {
+    const char* environment = std::getenv("CALCPP_IDENTIFY_INDEX");
+    if (environment && *environment) return environment;
+    const char* const candidates[] = {
+#ifdef CALCPP_IDENTIFY_INDEX_INSTALLED
+        CALCPP_IDENTIFY_INDEX_INSTALLED,
+#endif
+#ifdef CALCPP_IDENTIFY_INDEX_BUILD
+        CALCPP_IDENTIFY_INDEX_BUILD,
+#endif
+        nullptr
+    };
+    for (const char* path : candidates) {
+        if (path && std::ifstream(path).good()) return path;
+    }
+    return "";
+}
@@ -0,0 +1,389 @@
+#include "csv_pipeline.h"
+#include "batch_tuning.h"
+#include "block_writer.h"
+#include "calculator.h"
+#include "parser.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+
+std::string trimField(const char* begin, const char* end) {
+    while (begin < end && std::isspace(static_cast<unsigned char>(*begin))) begin++;
+    while (end > begin && std::isspace(static_cast<unsigned char>(end[-1]))) end--;
+    if (end - begin >= 2 && *begin == '"' && end[-1] == '"') {
+        begin++;
+        end--;
+    }
+    return std::string(begin, end);
+}
+
+// Splits the header line starting at data into column names. Quoted
+// fields may contain the delimiter, newlines and doubled quotes (RFC 4180).
+// Returns the offset just past the header line.
+size_t parseHeader(const char* data, size_t size, char delimiter, std::vector<std::string>& names) {
+    std::string field;
+    bool quoted = false;
+    bool wasQuoted = false;
+    auto finish = [&]() {
+        if (wasQuoted) {
+            names.push_back(field);
+        } else {
+            names.push_back(trimField(field.data(), field.data() + field.size()));
+        }
+        field.clear();
+        wasQuoted = false;
+    };
+    for (size_t i = 0; i < size; i++) {
+        char c = data[i];
+        if (quoted) {
+            if (c != '"') {
+                field.push_back(c);
+            } else if (i + 1 < size && data[i + 1] == '"') {
+                field.push_back('"');
+                i++;
+            } else {
+                quoted = false;
+            }
+        } else if (c == '"' && field.find_first_not_of(" \t") == std::string::npos) {
+            field.clear();
+            quoted = true;
+            wasQuoted = true;
+        } else if (c == delimiter) {
+            finish();
+        } else if (c == '\n') {
+            if (!wasQuoted && !field.empty() && field.back() == '\r') field.pop_back();
+            finish();
+            return i + 1;
+        } else if (!wasQuoted) {
+            field.push_back(c);
+        }
+    }
+    if (size > 0) finish();
+    return size;
+}
+
+// End of the data field starting at field: the next delimiter outside
+// quotes, or end. A quoted field may contain the delimiter and doubled
+// quotes, but not a newline (data rows are split at every newline).
+const char* quotedFieldEnd(const char* field, const char* end, char delimiter) {
+    const char* p = field;
+    while (p < end && (*p == ' ' || *p == '\t')) p++;
+    if (p < end && *p == '"') {
+        for (p++; ; p++) {
+            if (p == end) throw std::runtime_error("Quoted CSV field spans lines (only the header may)");
+            if (*p != '"') continue;
+            if (p + 1 < end && p[1] == '"') {
+                p++;
+            } else {
+                p++;
+                break;
+            }
+        }
+    }
+    const char* next = static_cast<const char*>(std::memchr(p, delimiter, end - p));
+    return next ? next : end;
+}
+
+// Parses a decimal number in [p, end) without copying. Values with at most
+// 15 significant digits and a small exponent are converted exactly with one
+// multiply or divide by a power of ten; anything else falls back to strtod.
+double parseNumber(const char* p, const char* end) {
+    static const double powers[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '"')) p++;
+    while (end > p && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '"' || end[-1] == '\r')) end--;
+    if (p == end) return std::numeric_limits<double>::quiet_NaN();
+
+    const char* start = p;
+    bool negative = false;
+    if (*p == '-' || *p == '+') {
+        negative = (*p == '-');
+        p++;
+    }
+
+    uint64_t mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
+    bool anyDigit = false;
+    while (p < end && *p >= '0' && *p <= '9') {
+        if (digits < 19) {
+            mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+            if (mantissa != 0) digits++;
+        } else {
+            exponent++;
+        }
+        anyDigit = true;
+        p++;
+    }
+    if (p < end && *p == '.') {
+        p++;
+        while (p < end && *p >= '0' && *p <= '9') {
+            if (digits < 19) {
+                mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+                if (mantissa != 0) digits++;
+                exponent--;
+            }
+            anyDigit = true;
+            p++;
+        }
+    }
+    if (anyDigit && p < end && (*p == 'e' || *p == 'E')) {
+        p++;
+        bool expNegative = false;
+        if (p < end && (*p == '-' || *p == '+')) {
+            expNegative = (*p == '-');
+            p++;
+        }
+        int e = 0;
+        bool expDigit = false;
+        while (p < end && *p >= '0' && *p <= '9') {
+            if (e < 100000) e = e * 10 + (*p - '0');
+            expDigit = true;
+            p++;
+        }
+        if (!expDigit) return std::numeric_limits<double>::quiet_NaN();
+        exponent += expNegative ? -e : e;
+    }
+
+    if (anyDigit && p == end && digits <= 15 && exponent >= -22 && exponent <= 22) {
+        double value = static_cast<double>(mantissa);
+        value = exponent < 0 ? value / powers[-exponent] : value * powers[exponent];
+        return negative ? -value : value;
+    }
+
+    // Slow path: long mantissas, large exponents, inf/nan spellings
+    char buffer[128];
+    size_t length = static_cast<size_t>(end - start);
+    if (length >= sizeof(buffer)) return std::numeric_limits<double>::quiet_NaN();
+    std::memcpy(buffer, start, length);
+    buffer[length] = '\0';
+    char* parsedEnd = nullptr;
+    double value = std::strtod(buffer, &parsedEnd);
+    if (parsedEnd != buffer + length) return std::numeric_limits<double>::quiet_NaN();
+    return value;
+}
+
+} // namespace
+
+std::string CsvPipeline::quoteField(const std::string& field, char delimiter) {
+    if (field.find_first_of(std::string("\"\r\n") + delimiter) == std::string::npos) return field;
+    std::string quoted = "\"";
+    for (char c : field) {
+        if (c == '"') quoted.push_back('"');
+        quoted.push_back(c);
+    }
+    quoted.push_back('"');
+    return quoted;
+}
+
+CsvPipeline::CsvPipeline(const std::string& path, const Options& opts)
+    : file(path), options(opts) {
+    if (options.expressions.empty()) {
+        throw std::runtime_error("--csv requires at least one --expr");
+    }
+
+    // Header line
+    dataStart = parseHeader(file.data(), file.size(), options.delimiter, columnNames);
+    fieldToColumn.assign(columnNames.size(), -1);
+
+    Parser parser;
+    for (const std::string& text : options.expressions) {
+        size_t assign = text.find('=');
+        std::string source = text;
+        std::string name = text;
+        if (assign != std::string::npos && assign > 0) {
+            std::string prefix = trimField(text.data(), text.data() + assign);
+            if (!prefix.empty() && std::isalpha(static_cast<unsigned char>(prefix[0]))) {
+                name = prefix;
+                source = text.substr(assign + 1);
+            }
+        }
+        parser.compileInto(source, expr);
+        outputNames.push_back(name);
+    }
+    if (expr.hasMatrixOps()) {
+        throw std::runtime_error("Vector operations are not supported in --csv expressions");
+    }
+
+    for (const auto& variable : expr.getVariableNames()) {
+        auto it = std::find(columnNames.begin(), columnNames.end(), variable);
+        if (it == columnNames.end()) {
+            throw std::runtime_error("Unknown column: " + variable);
+        }
+        size_t fieldIndex = static_cast<size_t>(it - columnNames.begin());
+        if (fieldToColumn[fieldIndex] < 0) {
+            fieldToColumn[fieldIndex] = static_cast<int>(parsedColumns++);
+        }
+        columnSlots.push_back(fieldToColumn[fieldIndex]);
+    }
+}
+
+void CsvPipeline::processBlock(const char* begin, const char* end, std::string& out, size_t& rows,
+                               AccuracyReport& accuracy) const {
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    std::vector<std::vector<double>> columns(parsedColumns);
+    size_t estimate = static_cast<size_t>(end - begin) / 16 + 1;
+    for (auto& column : columns) column.reserve(estimate);
+
+    // Parse: only the referenced fields are converted
+    rows = 0;
+    const char* line = begin;
+    while (line < end) {
+        const char* lineEnd = static_cast<const char*>(std::memchr(line, '\n', end - line));
+        if (lineEnd == nullptr) lineEnd = end;
+        const char* contentEnd = lineEnd;
+        if (contentEnd > line && contentEnd[-1] == '\r') contentEnd--;
+        if (contentEnd == line) {
+            line = lineEnd + 1;
+            continue;
+        }
+
+        // Lines without quotes split on every delimiter
+        bool quoted = std::memchr(line, '"', contentEnd - line) != nullptr;
+        size_t fieldIndex = 0;
+        size_t filled = 0;
+        const char* field = line;
+        while (fieldIndex < fieldToColumn.size()) {
+            const char* next;
+            if (quoted) {
+                next = quotedFieldEnd(field, contentEnd, options.delimiter);
+            } else {
+                next = static_cast<const char*>(std::memchr(field, options.delimiter, contentEnd - field));
+                if (next == nullptr) next = contentEnd;
+            }
+            int column = fieldToColumn[fieldIndex];
+            if (column >= 0) {
+                columns[column].push_back(parseNumber(field, next));
+                filled++;
+                if (filled == parsedColumns) break;
+            }
+            fieldIndex++;
+            if (next == contentEnd) break;
+            field = next + 1;
+        }
+        // Short rows: missing fields read as NaN
+        for (auto& column : columns) {
+            if (column.size() == rows) column.push_back(nan);
+        }
+        rows++;
+        line = lineEnd + 1;
+    }
+
+    if (options.float32) {
+        evaluateFloat(columns, rows, out, accuracy);
+        return;
+    }
+
+    // Evaluate and format a chunk of rows at a time
+    std::vector<double> registers;
+    std::vector<std::vector<double>> results(outputNames.size(), std::vector<double>(CHUNK_ROWS));
+    std::vector<double*> resultPointers;
+    for (auto& result : results) resultPointers.push_back(result.data());
+    std::vector<const double*> slots(columnSlots.size());
+    char number[Calculator::FORMAT_BUFFER_SIZE];
+    out.reserve(rows * outputNames.size() * 12);
+
+    for (size_t first = 0; first < rows; first += CHUNK_ROWS) {
+        size_t count = std::min(CHUNK_ROWS, rows - first);
+        for (size_t slot = 0; slot < columnSlots.size(); slot++) {
+            slots[slot] = columns[columnSlots[slot]].data() + first;
+        }
+        expr.evaluateBatch(slots.data(), count, resultPointers.data(), registers);
+
+        for (size_t r = 0; r < count; r++) {
+            for (size_t e = 0; e < outputNames.size(); e++) {
+                if (e > 0) out.push_back(options.delimiter);
+                out.append(number, Calculator::formatNumber(results[e][r], options.precision, number));
+            }
+            out.push_back('\n');
+        }
+    }
+}
+
+void CsvPipeline::evaluateFloat(const std::vector<std::vector<double>>& columns, size_t rows, std::string& out,
+                                AccuracyReport& accuracy) const {
+    size_t outputs = outputNames.size();
+    std::vector<std::vector<float>> floatColumns(columns.size(), std::vector<float>(CHUNK_ROWS));
+    std::vector<float> registers;
+    std::vector<std::vector<float>> results(outputs, std::vector<float>(CHUNK_ROWS));
+    std::vector<float*> resultPointers;
+    for (auto& result : results) resultPointers.push_back(result.data());
+    std::vector<const float*> slots(columnSlots.size());
+    for (size_t slot = 0; slot < columnSlots.size(); slot++) {
+        slots[slot] = floatColumns[columnSlots[slot]].data();
+    }
+    std::vector<const double*> exactSlots(columnSlots.size());
+    AccuracySampler sampler(expr, outputs);
+    char number[Calculator::FORMAT_BUFFER_SIZE];
+    out.reserve(rows * outputs * 12);
+
+    for (size_t first = 0; first < rows; first += CHUNK_ROWS) {
+        size_t count = std::min(CHUNK_ROWS, rows - first);
+        for (size_t c = 0; c < columns.size(); c++) {
+            for (size_t r = 0; r < count; r++) floatColumns[c][r] = static_cast<float>(columns[c][first + r]);
+        }
+        expr.evaluateBatch(slots.data(), count, resultPointers.data(), registers);
+        for (size_t slot = 0; slot < columnSlots.size(); slot++) {
+            exactSlots[slot] = columns[columnSlots[slot]].data() + first;
+        }
+        sampler.addChunk(first, count, exactSlots.data(), resultPointers.data());
+
+        for (size_t r = 0; r < count; r++) {
+            for (size_t e = 0; e < outputs; e++) {
+                if (e > 0) out.push_back(options.delimiter);
+                out.append(number, Calculator::formatSignificant(results[e][r], FLOAT_DIGITS, options.precision, number));
+            }
+            out.push_back('\n');
+        }
+    }
+    sampler.finish(accuracy);
+}
+
+CsvPipeline::Stats CsvPipeline::run(std::FILE* out) {
+    Stats stats;
+    stats.bytes = file.size();
+
+    std::string header;
+    for (size_t e = 0; e < outputNames.size(); e++) {
+        if (e > 0) header.push_back(options.delimiter);
+        header += quoteField(outputNames[e], options.delimiter);
+    }
+    header.push_back('\n');
+    std::fwrite(header.data(), 1, header.size(), out);
+
+    // Split the data region into blocks ending on line boundaries
+    const char* data = file.data();
+    size_t size = file.size();
+    std::vector<std::pair<size_t, size_t>> blocks;
+    for (size_t pos = dataStart; pos < size; ) {
+        size_t next = std::min(size, pos + options.blockBytes);
+        if (next < size) {
+            const char* nl = static_cast<const char*>(std::memchr(data + next, '\n', size - next));
+            next = nl ? static_cast<size_t>(nl - data) + 1 : size;
+        }
+        blocks.emplace_back(pos, next);
+        pos = next;
+    }
+    if (blocks.empty()) return stats;
+
+    unsigned threads = options.threads ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+    std::vector<size_t> rowCounts(blocks.size(), 0);
+    std::vector<AccuracyReport> blockAccuracy(blocks.size());
+    writeBlocksInOrder(blocks.size(), threads, threads * BLOCKS_IN_FLIGHT_PER_THREAD,
+                       [&](size_t index, std::string& buffer) {
+                           processBlock(data + blocks[index].first, data + blocks[index].second,
+                                        buffer, rowCounts[index], blockAccuracy[index]);
+                       }, out);
+    for (size_t rows : rowCounts) stats.rows += rows;
+    for (const AccuracyReport& accuracy : blockAccuracy) stats.accuracy.merge(accuracy);
+    return stats;
+}
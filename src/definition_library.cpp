@@ -0,0 +1,477 @@
+#include "definition_library.h"
+#include "calculator.h"
+#include "mapped_file.h"
+#include <cstdio>
+#include <cstring>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace {
+
+const char MAGIC[8] = {'C', 'A', 'L', 'C', 'L', 'I', 'B', '\0'};
+// Written as a native integer; a cache from a machine of the other byte
+// order reads it back differently and is rebuilt
+constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint64_t sourceSize;
+    uint64_t sourceHash;
+    uint64_t definitionCount;
+    uint64_t reevaluatedCount;
+    uint64_t nodeCount;
+    uint64_t valueCount;
+    uint64_t namesSize;
+};
+
+// A stored value is values[first..] (1 double for a scalar, rows * cols
+// otherwise); a definition that is evaluated on every load has nodeCount > 0
+// and its nodes are nodes[first..first + nodeCount)
+struct DefinitionRecord {
+    uint32_t nameOffset;
+    uint32_t nameLength;
+    uint32_t dims;          // as Matrix::dims()
+    uint32_t rows;
+    uint32_t cols;
+    uint32_t nodeCount;
+    uint32_t root;          // relative to first
+    uint32_t flags;
+    uint64_t first;
+};
+
+// The value is used by a definition that is evaluated on every load
+constexpr uint32_t REFERENCED = 1;
+
+// Operands are relative to the definition's first node. VAR keeps its name
+// as an offset and length into the names section.
+struct NodeRecord {
+    uint8_t op;
+    uint8_t padding[3];
+    uint32_t lhs;
+    uint32_t rhs;
+    uint32_t offset;        // byte offset in the source file, for errors
+    double value;
+};
+
+// Every section size is a multiple of 8, so the mapped sections stay aligned
+static_assert(sizeof(Header) % 8 == 0, "unaligned cache header");
+static_assert(sizeof(DefinitionRecord) % 8 == 0, "unaligned definition record");
+static_assert(sizeof(NodeRecord) % 8 == 0, "unaligned node record");
+
+// Sections of a mapped cache
+struct Sections {
+    const DefinitionRecord* records = nullptr;
+    const NodeRecord* nodes = nullptr;
+    const double* values = nullptr;
+    const char* names = nullptr;
+    size_t definitionCount = 0;
+    size_t reevaluatedCount = 0;
+    size_t nodeCount = 0;
+    size_t valueCount = 0;
+    size_t namesSize = 0;
+};
+
+struct Library {
+    std::vector<DefinitionRecord> records;
+    std::vector<NodeRecord> nodes;
+    std::vector<double> values;
+    std::string names;
+    size_t reevaluatedCount = 0;
+};
+
+// The definitions seen so far; mirrors Calculator::evaluate() without ans
+class Environment {
+public:
+    void set(const std::string& name, const Matrix& value) {
+        if (value.isScalar()) {
+            scalars[name] = value[0];
+            matrices.erase(name);
+        } else {
+            matrices[name] = value;
+            scalars.erase(name);
+        }
+    }
+
+    Matrix evaluate(const Expression& expr) const {
+        bool matrixValued = expr.hasMatrixOps();
+        for (const auto& name : expr.getVariableNames()) {
+            if (matrices.count(name)) matrixValued = true;
+        }
+        if (!matrixValued) {
+            std::vector<double> values = expr.bindVariables(scalars);
+            return Matrix::scalar(expr.evaluate(values.data()));
+        }
+
+        std::vector<Matrix> values;
+        for (size_t slot = 0; slot < expr.getVariableCount(); slot++) {
+            const std::string& name = expr.getVariableNames()[slot];
+            auto matrix = matrices.find(name);
+            auto scalar = scalars.find(name);
+            if (matrix != matrices.end()) {
+                values.push_back(matrix->second);
+            } else if (scalar != scalars.end()) {
+                values.push_back(Matrix::scalar(scalar->second));
+            } else {
+                CalcError error;
+                error.set(ErrorCode::UNDEFINED_VARIABLE, expr.getVariableOffset(slot), "Variable not defined: " + name);
+                throw CalcException(error);
+            }
+        }
+        return evaluateMatrix(expr, values);
+    }
+
+    void defineOn(Calculator& calculator) const {
+        for (const auto& entry : scalars) calculator.setVariable(entry.first, entry.second);
+        for (const auto& entry : matrices) calculator.setMatrix(entry.first, entry.second);
+    }
+
+private:
+    std::unordered_map<std::string, double> scalars;
+    std::unordered_map<std::string, Matrix> matrices;
+};
+
+[[noreturn]] void fail(ErrorCode code, size_t offset, const std::string& message) {
+    CalcError error;
+    error.set(code, offset, message);
+    throw CalcException(error);
+}
+
+// Evaluates expr, moving error offsets (which are relative to the
+// expression text starting at `base`) into the file. Matrix shape errors
+// carry no offset and point at the start of the expression.
+Matrix evaluateAt(const Environment& environment, const Expression& expr, size_t base) {
+    try {
+        return environment.evaluate(expr);
+    } catch (const CalcException& e) {
+        fail(e.code, base + e.offset, e.what());
+    } catch (const std::runtime_error& e) {
+        fail(ErrorCode::UNSUPPORTED_OPERATION, base, e.what());
+    }
+}
+
+bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+bool usesRandom(const Expression& expr, const std::unordered_set<std::string>& reevaluated) {
+    for (const Expression::Node& node : expr.getNodes()) {
+        if (node.op == Expression::Op::RAND || node.op == Expression::Op::RANDN) return true;
+    }
+    for (const std::string& name : expr.getVariableNames()) {
+        if (reevaluated.count(name)) return true;
+    }
+    return false;
+}
+
+// Parses and evaluates the source into environment and collects what the
+// cache stores
+Library compile(const char* data, size_t size, Environment& environment) {
+    Library library;
+    Parser parser;
+    std::unordered_set<std::string> reevaluated;
+    std::unordered_map<std::string, size_t> latest;     // name -> its last record
+    std::vector<Parser::Token> tokens;
+    CalcError error;
+
+    for (size_t lineStart = 0; lineStart < size; ) {
+        const char* newline = static_cast<const char*>(std::memchr(data + lineStart, '\n', size - lineStart));
+        size_t lineEnd = newline ? newline - data : size;
+        const char* comment = static_cast<const char*>(std::memchr(data + lineStart, '#', lineEnd - lineStart));
+        size_t begin = lineStart;
+        size_t end = comment ? comment - data : lineEnd;
+        lineStart = lineEnd + 1;
+        while (begin < end && isSpace(data[begin])) begin++;
+        while (end > begin && isSpace(data[end - 1])) end--;
+        if (begin == end) continue;
+
+        const char* assign = static_cast<const char*>(std::memchr(data + begin, '=', end - begin));
+        if (!assign) fail(ErrorCode::UNEXPECTED_TOKEN, begin, "Expected 'name = expression'");
+        size_t nameEnd = assign - data;
+        while (nameEnd > begin && isSpace(data[nameEnd - 1])) nameEnd--;
+        std::string name(data + begin, nameEnd - begin);
+        // The lexer decides what is a name: constants and functions are not
+        if (!parser.tryTokenize(name, tokens, error) || tokens.size() != 2 ||
+            tokens[0].type != Parser::TokenType::VARIABLE || name == "ans") {
+            fail(ErrorCode::UNEXPECTED_TOKEN, begin, "Invalid definition name: " + name);
+        }
+
+        size_t expressionBegin = assign - data + 1;
+        while (expressionBegin < end && isSpace(data[expressionBegin])) expressionBegin++;
+        Expression expr;
+        if (!parser.tryCompile(data + expressionBegin, end - expressionBegin, expr, error)) {
+            fail(error.code, expressionBegin + error.offset, error.message);
+        }
+        Matrix value = evaluateAt(environment, expr, expressionBegin);
+
+        DefinitionRecord record = {};
+        record.nameOffset = static_cast<uint32_t>(library.names.size());
+        record.nameLength = static_cast<uint32_t>(name.size());
+        library.names += name;
+        record.dims = static_cast<uint32_t>(value.dims());
+        record.rows = static_cast<uint32_t>(value.rows());
+        record.cols = static_cast<uint32_t>(value.cols());
+        if (usesRandom(expr, reevaluated)) {
+            // Keep the nodes; the value has to be drawn again on every load
+            reevaluated.insert(name);
+            library.reevaluatedCount++;
+            for (const std::string& variable : expr.getVariableNames()) {
+                library.records[latest.at(variable)].flags |= REFERENCED;
+            }
+            const std::vector<Expression::Node>& nodes = expr.getNodes();
+            record.first = library.nodes.size();
+            record.nodeCount = static_cast<uint32_t>(nodes.size());
+            record.root = static_cast<uint32_t>(expr.getRoot());
+            for (const Expression::Node& node : nodes) {
+                NodeRecord stored = {};
+                stored.op = static_cast<uint8_t>(node.op);
+                stored.lhs = node.lhs;
+                stored.rhs = node.rhs;
+                stored.offset = static_cast<uint32_t>(expressionBegin + node.offset);
+                stored.value = node.value;
+                if (node.op == Expression::Op::VAR) {
+                    const std::string& variable = expr.getVariableNames()[node.lhs];
+                    stored.lhs = static_cast<uint32_t>(library.names.size());
+                    stored.rhs = static_cast<uint32_t>(variable.size());
+                    library.names += variable;
+                }
+                library.nodes.push_back(stored);
+            }
+        } else {
+            reevaluated.erase(name);
+            record.first = library.values.size();
+            library.values.insert(library.values.end(), value.values(), value.values() + value.size());
+        }
+        latest[name] = library.records.size();
+        library.records.push_back(record);
+        environment.set(name, value);
+    }
+    return library;
+}
+
+bool writeAll(std::FILE* out, const void* data, size_t size) {
+    return size == 0 || std::fwrite(data, 1, size, out) == size;
+}
+
+// Writes to a temporary file and renames it over the cache, so a reader
+// never maps a half-written cache. Failure only costs the next start time.
+bool writeCache(const std::string& path, const Library& library, size_t sourceSize, uint64_t sourceHash) {
+    if (library.names.size() > UINT32_MAX || library.nodes.size() > UINT32_MAX) return false;
+    Header header = {};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = DefinitionLibrary::FORMAT_VERSION;
+    header.byteOrder = BYTE_ORDER_MARK;
+    header.sourceSize = sourceSize;
+    header.sourceHash = sourceHash;
+    header.definitionCount = library.records.size();
+    header.reevaluatedCount = library.reevaluatedCount;
+    header.nodeCount = library.nodes.size();
+    header.valueCount = library.values.size();
+    header.namesSize = library.names.size();
+
+    std::string temporary = path + ".tmp";
+    std::FILE* out = std::fopen(temporary.c_str(), "wb");
+    if (!out) return false;
+    bool written = writeAll(out, &header, sizeof(header)) &&
+                   writeAll(out, library.records.data(), library.records.size() * sizeof(DefinitionRecord)) &&
+                   writeAll(out, library.nodes.data(), library.nodes.size() * sizeof(NodeRecord)) &&
+                   writeAll(out, library.values.data(), library.values.size() * sizeof(double)) &&
+                   writeAll(out, library.names.data(), library.names.size());
+    written = std::fclose(out) == 0 && written;
+    if (written) {
+        std::remove(path.c_str());  // rename() does not replace files on Windows
+        written = std::rename(temporary.c_str(), path.c_str()) == 0;
+    }
+    if (!written) std::remove(temporary.c_str());
+    return written;
+}
+
+bool validNodes(const Sections& sections, const DefinitionRecord& record) {
+    if (record.first > sections.nodeCount || record.nodeCount > sections.nodeCount - record.first ||
+        record.root >= record.nodeCount) {
+        return false;
+    }
+    for (uint32_t k = 0; k < record.nodeCount; k++) {
+        const NodeRecord& node = sections.nodes[record.first + k];
+        if (node.op > static_cast<uint8_t>(Expression::Op::DET)) return false;
+        Expression::Op op = static_cast<Expression::Op>(node.op);
+        if (op == Expression::Op::VAR) {
+            if (node.lhs > sections.namesSize || node.rhs > sections.namesSize - node.lhs) return false;
+        } else if (!Expression::isLeaf(op)) {
+            if (node.lhs >= k || (!Expression::isUnary(op) && node.rhs >= k)) return false;
+        }
+    }
+    return true;
+}
+
+// Maps the cache and checks that it belongs to this source and is intact;
+// anything else means it has to be rebuilt
+bool openCache(const std::string& path, size_t sourceSize, uint64_t sourceHash, MappedFile& file,
+               Sections& sections) {
+    try {
+        file.open(path);
+    } catch (const std::exception&) {
+        return false;
+    }
+    Header header;
+    if (file.size() < sizeof(header)) return false;
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != DefinitionLibrary::FORMAT_VERSION ||
+        header.byteOrder != BYTE_ORDER_MARK || header.sourceSize != sourceSize || header.sourceHash != sourceHash) {
+        return false;
+    }
+
+    // Section sizes are checked one at a time so that no product overflows
+    size_t remaining = file.size() - sizeof(header);
+    if (header.definitionCount > remaining / sizeof(DefinitionRecord)) return false;
+    remaining -= header.definitionCount * sizeof(DefinitionRecord);
+    if (header.nodeCount > remaining / sizeof(NodeRecord)) return false;
+    remaining -= header.nodeCount * sizeof(NodeRecord);
+    if (header.valueCount > remaining / sizeof(double)) return false;
+    remaining -= header.valueCount * sizeof(double);
+    if (header.namesSize != remaining) return false;
+
+    const char* base = file.data() + sizeof(header);
+    sections.definitionCount = static_cast<size_t>(header.definitionCount);
+    sections.reevaluatedCount = static_cast<size_t>(header.reevaluatedCount);
+    sections.nodeCount = static_cast<size_t>(header.nodeCount);
+    sections.valueCount = static_cast<size_t>(header.valueCount);
+    sections.namesSize = static_cast<size_t>(header.namesSize);
+    sections.records = reinterpret_cast<const DefinitionRecord*>(base);
+    base += sections.definitionCount * sizeof(DefinitionRecord);
+    sections.nodes = reinterpret_cast<const NodeRecord*>(base);
+    base += sections.nodeCount * sizeof(NodeRecord);
+    sections.values = reinterpret_cast<const double*>(base);
+    base += sections.valueCount * sizeof(double);
+    sections.names = base;
+
+    // Check every record before defining anything, so a damaged cache never
+    // leaves the calculator half loaded
+    for (size_t i = 0; i < sections.definitionCount; i++) {
+        const DefinitionRecord& record = sections.records[i];
+        if (record.nameOffset > sections.namesSize || record.nameLength > sections.namesSize - record.nameOffset ||
+            record.dims > 2 || (record.dims == 1 && record.rows != 1)) {
+            return false;
+        }
+        if (record.nodeCount > 0) {
+            if (!validNodes(sections, record)) return false;
+        } else {
+            uint64_t count = record.dims == 0 ? 1 : static_cast<uint64_t>(record.rows) * record.cols;
+            if (record.first > sections.valueCount || count > sections.valueCount - record.first) return false;
+        }
+    }
+    return true;
+}
+
+Expression rebuild(const Sections& sections, const DefinitionRecord& record) {
+    Expression expr;
+    expr.reserve(record.nodeCount);
+    std::vector<size_t> index(record.nodeCount);
+    for (uint32_t k = 0; k < record.nodeCount; k++) {
+        const NodeRecord& node = sections.nodes[record.first + k];
+        Expression::Op op = static_cast<Expression::Op>(node.op);
+        if (op == Expression::Op::CONST) {
+            index[k] = expr.addConstant(node.value, node.offset);
+        } else if (op == Expression::Op::VAR) {
+            index[k] = expr.addVariable(std::string(sections.names + node.lhs, node.rhs), node.offset);
+        } else if (op == Expression::Op::RAND || op == Expression::Op::RANDN) {
+            index[k] = expr.addRandom(op, node.offset);
+        } else if (Expression::isUnary(op)) {
+            index[k] = expr.addUnary(op, index[node.lhs], node.offset);
+        } else {
+            index[k] = expr.addBinary(op, index[node.lhs], index[node.rhs], node.offset);
+        }
+    }
+    expr.addRoot(index[record.root]);
+    return expr;
+}
+
+Matrix storedValue(const Sections& sections, const DefinitionRecord& record) {
+    const double* values = sections.values + record.first;
+    if (record.dims == 0) return Matrix::scalar(values[0]);
+    Matrix value = record.dims == 1 ? Matrix::vector(record.cols) : Matrix(record.rows, record.cols);
+    std::memcpy(value.values(), values, value.size() * sizeof(double));
+    return value;
+}
+
+void define(const Sections& sections, Calculator& calculator) {
+    // Re-evaluated definitions can fail, so they are all drawn before any
+    // name is defined. Only what they use goes into their environment.
+    Environment environment;
+    std::vector<Matrix> drawn;
+    drawn.reserve(sections.reevaluatedCount);
+    for (size_t i = 0; i < sections.definitionCount; i++) {
+        const DefinitionRecord& record = sections.records[i];
+        if (record.nodeCount == 0 && !(record.flags & REFERENCED)) continue;
+        std::string name(sections.names + record.nameOffset, record.nameLength);
+        if (record.nodeCount > 0) {
+            drawn.push_back(evaluateAt(environment, rebuild(sections, record), 0));
+            if (record.flags & REFERENCED) environment.set(name, drawn.back());
+        } else {
+            environment.set(name, storedValue(sections, record));
+        }
+    }
+
+    size_t next = 0;
+    for (size_t i = 0; i < sections.definitionCount; i++) {
+        const DefinitionRecord& record = sections.records[i];
+        std::string name(sections.names + record.nameOffset, record.nameLength);
+        if (record.nodeCount > 0) {
+            calculator.setMatrix(name, drawn[next++]);
+        } else if (record.dims == 0) {
+            calculator.setVariable(name, sections.values[record.first]);
+        } else {
+            calculator.setMatrix(name, storedValue(sections, record));
+        }
+    }
+}
+
+} // namespace
+
+uint64_t DefinitionLibrary::hash(const char* data, size_t size) {
+    // FNV-1a taken a word at a time: one multiply per 8 bytes keeps hashing
+    // a large library well below the cost of reading it
+    const uint64_t prime = 0x100000001B3ull;
+    uint64_t h = 0xCBF29CE484222325ull ^ size;
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, data + i, sizeof(word));
+        h = (h ^ word) * prime;
+        h ^= h >> 32;
+    }
+    for (; i < size; i++) {
+        h = (h ^ static_cast<unsigned char>(data[i])) * prime;
+    }
+    return h;
+}
+
+DefinitionLibrary::Stats DefinitionLibrary::load(const std::string& path, Calculator& calculator, bool useCache) {
+    MappedFile source(path);
+    uint64_t sourceHash = hash(source.data(), source.size());
+    std::string cache = cachePath(path);
+    Stats stats;
+
+    if (useCache) {
+        MappedFile file;
+        Sections sections;
+        if (openCache(cache, source.size(), sourceHash, file, sections)) {
+            define(sections, calculator);
+            stats.definitions = sections.definitionCount;
+            stats.reevaluated = sections.reevaluatedCount;
+            stats.fromCache = true;
+            return stats;
+        }
+    }
+
+    // Nothing is defined unless the whole file evaluates
+    Environment environment;
+    Library library = compile(source.data(), source.size(), environment);
+    environment.defineOn(calculator);
+    stats.definitions = library.records.size();
+    stats.reevaluated = library.reevaluatedCount;
+    if (useCache) stats.cacheWritten = writeCache(cache, library, source.size(), sourceHash);
+    return stats;
+}
@@ -0,0 +1,429 @@
+#include "expression.h"
+#include "random.h"
+#include "vector_math.h"
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+
+uint64_t valueBits(double value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+uint64_t hashNode(const Expression::Node& node) {
+    uint64_t h = static_cast<uint64_t>(node.op);
+    h = h * 0x9E3779B97F4A7C15ull + node.lhs;
+    h = h * 0x9E3779B97F4A7C15ull + node.rhs;
+    h = h * 0x9E3779B97F4A7C15ull + valueBits(node.value);
+    return h ^ (h >> 29);
+}
+
+// Structural identity; the source offset does not take part
+bool sameNode(const Expression::Node& a, const Expression::Node& b) {
+    return a.op == b.op && a.lhs == b.lhs && a.rhs == b.rhs && valueBits(a.value) == valueBits(b.value);
+}
+
+bool isShareable(Expression::Op op) {
+    using Op = Expression::Op;
+    // A list is appended to in place by the matrix evaluator; each random
+    // draw is a different value
+    return op != Op::LIST && op != Op::APPEND && op != Op::RAND && op != Op::RANDN;
+}
+
+} // namespace
+
+size_t Expression::addNode(const Node& node) {
+    if (!hashConsing || !isShareable(node.op)) {
+        nodes.push_back(node);
+        return nodes.size() - 1;
+    }
+    // Keep the table at most half full
+    if ((nodes.size() + 1) * 2 > buckets.size()) {
+        rehash(std::max<size_t>(64, buckets.size() * 2));
+    }
+    size_t mask = buckets.size() - 1;
+    size_t i = hashNode(node) & mask;
+    // An operand that nothing uses yet cannot appear in an existing node,
+    // so the node is new and the search for a duplicate can be skipped
+    bool hasOperands = !isLeaf(node.op);
+    bool fresh = hasOperands && std::max(node.lhs, node.rhs) > highestOperand;
+    for (; ; i = (i + 1) & mask) {
+        uint32_t index = buckets[i];
+        if (index == EMPTY_BUCKET) {
+            buckets[i] = static_cast<uint32_t>(nodes.size());
+            if (hasOperands) highestOperand = std::max(highestOperand, std::max(node.lhs, node.rhs));
+            nodes.push_back(node);
+            return nodes.size() - 1;
+        }
+        if (!fresh && sameNode(nodes[index], node)) return index;
+    }
+}
+
+void Expression::rehash(size_t bucketCount) {
+    buckets.assign(bucketCount, EMPTY_BUCKET);
+    size_t mask = bucketCount - 1;
+    for (size_t index = 0; index < nodes.size(); index++) {
+        const Node& node = nodes[index];
+        if (!isShareable(node.op)) continue;
+        if (!isLeaf(node.op)) {
+            highestOperand = std::max(highestOperand, std::max(node.lhs, node.rhs));
+        }
+        size_t i = hashNode(node) & mask;
+        while (buckets[i] != EMPTY_BUCKET) i = (i + 1) & mask;
+        buckets[i] = static_cast<uint32_t>(index);
+    }
+}
+
+void Expression::setHashConsing(bool enabled) {
+    hashConsing = enabled;
+    if (!enabled) {
+        buckets.clear();
+        buckets.shrink_to_fit();
+    } else if (!nodes.empty()) {
+        size_t bucketCount = 64;
+        while (bucketCount < nodes.size() * 2) bucketCount *= 2;
+        rehash(bucketCount);
+    }
+}
+
+size_t Expression::addRoot(size_t node) {
+    roots.push_back(static_cast<uint32_t>(node));
+    return roots.size() - 1;
+}
+
+size_t Expression::addConstant(double value, size_t offset) {
+    return addNode({Op::CONST, 0, 0, static_cast<uint32_t>(offset), value});
+}
+
+size_t Expression::addVariable(const std::string& name, size_t offset) {
+    uint32_t slot;
+    auto it = variableSlots.find(name);
+    if (it != variableSlots.end()) {
+        slot = it->second;
+    } else {
+        slot = static_cast<uint32_t>(variableNames.size());
+        variableNames.push_back(name);
+        variableOffsets.push_back(offset);
+        variableSlots[name] = slot;
+    }
+    return addNode({Op::VAR, slot, 0, static_cast<uint32_t>(offset), 0.0});
+}
+
+size_t Expression::addUnary(Op op, size_t operand, size_t offset) {
+    return addNode({op, static_cast<uint32_t>(operand), 0, static_cast<uint32_t>(offset), 0.0});
+}
+
+size_t Expression::addBinary(Op op, size_t lhs, size_t rhs, size_t offset) {
+    return addNode({op, static_cast<uint32_t>(lhs), static_cast<uint32_t>(rhs),
+                    static_cast<uint32_t>(offset), 0.0});
+}
+
+size_t Expression::addRandom(Op op, size_t offset) {
+    return addNode({op, 0, 0, static_cast<uint32_t>(offset), 0.0});
+}
+
+int Expression::findVariable(const std::string& name) const {
+    auto it = variableSlots.find(name);
+    return it != variableSlots.end() ? static_cast<int>(it->second) : -1;
+}
+
+std::vector<double> Expression::bindVariables(const std::unordered_map<std::string, double>& vars) const {
+    std::vector<double> values;
+    CalcError error;
+    if (!tryBindVariables(vars, values, error)) {
+        throw CalcException(error);
+    }
+    return values;
+}
+
+bool Expression::tryBindVariables(const std::unordered_map<std::string, double>& vars,
+                                  std::vector<double>& values, CalcError& error) const {
+    values.resize(variableNames.size());
+    for (size_t i = 0; i < variableNames.size(); i++) {
+        auto it = vars.find(variableNames[i]);
+        if (it == vars.end()) {
+            error.set(ErrorCode::UNDEFINED_VARIABLE, variableOffsets[i], "Variable not defined: " + variableNames[i]);
+            return false;
+        }
+        values[i] = it->second;
+    }
+    return true;
+}
+
+bool Expression::isLeaf(Op op) {
+    return op == Op::CONST || op == Op::VAR || op == Op::RAND || op == Op::RANDN;
+}
+
+bool Expression::isUnary(Op op) {
+    switch (op) {
+        case Op::CONST:
+        case Op::VAR:
+        case Op::RAND:
+        case Op::RANDN:
+        case Op::ADD:
+        case Op::SUB:
+        case Op::MUL:
+        case Op::DIV:
+        case Op::MOD:
+        case Op::POW:
+        case Op::APPEND:
+        case Op::DOT:
+        case Op::MATMUL:
+        case Op::SOLVE:
+            return false;
+        default:
+            return true;
+    }
+}
+
+bool Expression::isMatrixOp(Op op) {
+    return op >= Op::LIST;
+}
+
+bool Expression::hasMatrixOps() const {
+    for (const Node& node : nodes) {
+        if (isMatrixOp(node.op)) return true;
+    }
+    return false;
+}
+
+bool Expression::hasRandomOps() const {
+    for (const Node& node : nodes) {
+        if (node.op == Op::RAND || node.op == Op::RANDN) return true;
+    }
+    return false;
+}
+
+const char* Expression::opName(Op op) {
+    switch (op) {
+        case Op::CONST: return "const";
+        case Op::VAR:   return "var";
+        case Op::NEG:   return "neg";
+        case Op::ADD:   return "+";
+        case Op::SUB:   return "-";
+        case Op::MUL:   return "*";
+        case Op::DIV:   return "/";
+        case Op::MOD:   return "%";
+        case Op::POW:   return "^";
+        case Op::SIN:   return "sin";
+        case Op::COS:   return "cos";
+        case Op::TAN:   return "tan";
+        case Op::ASIN:  return "asin";
+        case Op::ACOS:  return "acos";
+        case Op::ATAN:  return "atan";
+        case Op::LOG10: return "log10";
+        case Op::LN:    return "ln";
+        case Op::SQRT:  return "sqrt";
+        case Op::ABS:   return "abs";
+        case Op::FLOOR: return "floor";
+        case Op::CEIL:  return "ceil";
+        case Op::ROUND: return "round";
+        case Op::EXP:   return "exp";
+        case Op::RAND:  return "rand";
+        case Op::RANDN: return "randn";
+        case Op::LIST:  return "[";
+        case Op::APPEND: return ",";
+        case Op::DOT:   return "dot";
+        case Op::MATMUL: return "matmul";
+        case Op::SOLVE: return "solve";
+        case Op::NORM:  return "norm";
+        case Op::TRANSPOSE: return "transpose";
+        case Op::DET:   return "det";
+    }
+    return "?";
+}
+
+double Expression::applyScalar(Op op, double a, double b) {
+    switch (op) {
+        case Op::CONST:
+        case Op::VAR:   return a;
+        case Op::NEG:   return -a;
+        case Op::ADD:   return a + b;
+        case Op::SUB:   return a - b;
+        case Op::MUL:   return a * b;
+        case Op::DIV:   return a / b;
+        case Op::MOD:   return std::fmod(a, b);
+        case Op::POW:   return std::pow(a, b);
+        case Op::SIN:   return std::sin(a);
+        case Op::COS:   return std::cos(a);
+        case Op::TAN:   return std::tan(a);
+        case Op::ASIN:  return std::asin(a);
+        case Op::ACOS:  return std::acos(a);
+        case Op::ATAN:  return std::atan(a);
+        case Op::LOG10: return std::log10(a);
+        case Op::LN:    return std::log(a);
+        case Op::SQRT:  return std::sqrt(a);
+        case Op::ABS:   return std::abs(a);
+        case Op::FLOOR: return std::floor(a);
+        case Op::CEIL:  return std::ceil(a);
+        case Op::ROUND: return std::round(a);
+        case Op::EXP:   return std::exp(a);
+        case Op::RAND:  return Random::local().uniform();
+        case Op::RANDN: return Random::local().normal();
+        default:
+            throw std::runtime_error("Vector operations are not supported in scalar evaluation");
+    }
+}
+
+double Expression::evaluate(const double* values) const {
+    std::vector<double> registers;
+    return evaluate(values, registers);
+}
+
+double Expression::evaluate(const double* values, std::vector<double>& registers) const {
+    double result;
+    CalcError error;
+    if (!tryEvaluate(values, registers, result, error)) {
+        throw CalcException(error);
+    }
+    return result;
+}
+
+bool Expression::tryEvaluate(const double* values, std::vector<double>& registers,
+                             double& result, CalcError& error) const {
+    registers.resize(nodes.size());
+    double* r = registers.data();
+
+    for (size_t i = 0; i < nodes.size(); i++) {
+        const Node& node = nodes[i];
+        switch (node.op) {
+            case Op::CONST: r[i] = node.value; break;
+            case Op::VAR:   r[i] = values[node.lhs]; break;
+            case Op::NEG:   r[i] = -r[node.lhs]; break;
+            case Op::ADD:   r[i] = r[node.lhs] + r[node.rhs]; break;
+            case Op::SUB:   r[i] = r[node.lhs] - r[node.rhs]; break;
+            case Op::MUL:   r[i] = r[node.lhs] * r[node.rhs]; break;
+            case Op::DIV:
+                if (r[node.rhs] == 0) {
+                    error.set(ErrorCode::DIVISION_BY_ZERO, node.offset, "Division by zero");
+                    return false;
+                }
+                r[i] = r[node.lhs] / r[node.rhs];
+                break;
+            case Op::MOD:
+                if (r[node.rhs] == 0) {
+                    error.set(ErrorCode::MODULO_BY_ZERO, node.offset, "Modulo by zero");
+                    return false;
+                }
+                r[i] = std::fmod(r[node.lhs], r[node.rhs]);
+                break;
+            case Op::POW:   r[i] = std::pow(r[node.lhs], r[node.rhs]); break;
+            case Op::SIN:   r[i] = std::sin(r[node.lhs]); break;
+            case Op::COS:   r[i] = std::cos(r[node.lhs]); break;
+            case Op::TAN:   r[i] = std::tan(r[node.lhs]); break;
+            case Op::ASIN:  r[i] = std::asin(r[node.lhs]); break;
+            case Op::ACOS:  r[i] = std::acos(r[node.lhs]); break;
+            case Op::ATAN:  r[i] = std::atan(r[node.lhs]); break;
+            case Op::LOG10: r[i] = std::log10(r[node.lhs]); break;
+            case Op::LN:    r[i] = std::log(r[node.lhs]); break;
+            case Op::SQRT:  r[i] = std::sqrt(r[node.lhs]); break;
+            case Op::ABS:   r[i] = std::abs(r[node.lhs]); break;
+            case Op::FLOOR: r[i] = std::floor(r[node.lhs]); break;
+            case Op::CEIL:  r[i] = std::ceil(r[node.lhs]); break;
+            case Op::ROUND: r[i] = std::round(r[node.lhs]); break;
+            case Op::EXP:   r[i] = std::exp(r[node.lhs]); break;
+            case Op::RAND:  r[i] = Random::local().uniform(); break;
+            case Op::RANDN: r[i] = Random::local().normal(); break;
+            default:
+                error.set(ErrorCode::UNSUPPORTED_OPERATION, node.offset,
+                          "Vector operations are not supported in scalar evaluation");
+                return false;
+        }
+    }
+
+    result = r[getRoot()];
+    return true;
+}
+
+void Expression::evaluateBatch(const double* const* columns, size_t count, double* out,
+                               std::vector<double>& registers) const {
+    runBatch(columns, count, registers, Random::local());
+    std::memcpy(out, registers.data() + getRoot() * count, count * sizeof(double));
+}
+
+void Expression::evaluateBatch(const double* const* columns, size_t count, double* const* outs,
+                               std::vector<double>& registers) const {
+    runBatch(columns, count, registers, Random::local());
+    for (size_t i = 0; i < roots.size(); i++) {
+        std::memcpy(outs[i], registers.data() + roots[i] * count, count * sizeof(double));
+    }
+}
+
+void Expression::evaluateBatch(const double* const* columns, size_t count, double* out,
+                               std::vector<double>& registers, Random& random) const {
+    runBatch(columns, count, registers, random);
+    std::memcpy(out, registers.data() + getRoot() * count, count * sizeof(double));
+}
+
+void Expression::evaluateBatch(const float* const* columns, size_t count, float* out,
+                               std::vector<float>& registers) const {
+    runBatch(columns, count, registers, Random::local());
+    std::memcpy(out, registers.data() + getRoot() * count, count * sizeof(float));
+}
+
+void Expression::evaluateBatch(const float* const* columns, size_t count, float* const* outs,
+                               std::vector<float>& registers) const {
+    runBatch(columns, count, registers, Random::local());
+    for (size_t i = 0; i < roots.size(); i++) {
+        std::memcpy(outs[i], registers.data() + roots[i] * count, count * sizeof(float));
+    }
+}
+
+template <typename T>
+void Expression::runBatch(const T* const* columns, size_t count, std::vector<T>& registers,
+                          Random& random) const {
+    const T nan = std::numeric_limits<T>::quiet_NaN();
+    registers.resize(nodes.size() * count);
+    T* base = registers.data();
+
+    for (size_t i = 0; i < nodes.size(); i++) {
+        const Node& node = nodes[i];
+        T* o = base + i * count;
+        const T* a = base + node.lhs * count;
+        const T* b = base + node.rhs * count;
+
+        switch (node.op) {
+            case Op::CONST:
+                std::fill(o, o + count, static_cast<T>(node.value));
+                break;
+            case Op::VAR:
+                std::memcpy(o, columns[node.lhs], count * sizeof(T));
+                break;
+            case Op::NEG:   for (size_t k = 0; k < count; k++) o[k] = -a[k]; break;
+            case Op::ADD:   for (size_t k = 0; k < count; k++) o[k] = a[k] + b[k]; break;
+            case Op::SUB:   for (size_t k = 0; k < count; k++) o[k] = a[k] - b[k]; break;
+            case Op::MUL:   for (size_t k = 0; k < count; k++) o[k] = a[k] * b[k]; break;
+            case Op::DIV:
+                for (size_t k = 0; k < count; k++) o[k] = b[k] == 0 ? nan : a[k] / b[k];
+                break;
+            case Op::MOD:
+                for (size_t k = 0; k < count; k++) o[k] = b[k] == 0 ? nan : std::fmod(a[k], b[k]);
+                break;
+            // Transcendentals go through the vectorized kernels
+            case Op::POW:   VectorMath::pow(a, b, o, count); break;
+            case Op::SIN:   VectorMath::sin(a, o, count); break;
+            case Op::COS:   VectorMath::cos(a, o, count); break;
+            case Op::TAN:   VectorMath::tan(a, o, count); break;
+            case Op::ASIN:  VectorMath::asin(a, o, count); break;
+            case Op::ACOS:  VectorMath::acos(a, o, count); break;
+            case Op::ATAN:  VectorMath::atan(a, o, count); break;
+            case Op::LOG10: VectorMath::log10(a, o, count); break;
+            case Op::LN:    VectorMath::ln(a, o, count); break;
+            case Op::SQRT:  VectorMath::sqrt(a, o, count); break;
+            case Op::ABS:   for (size_t k = 0; k < count; k++) o[k] = std::abs(a[k]); break;
+            case Op::FLOOR: for (size_t k = 0; k < count; k++) o[k] = std::floor(a[k]); break;
+            case Op::CEIL:  for (size_t k = 0; k < count; k++) o[k] = std::ceil(a[k]); break;
+            case Op::ROUND: for (size_t k = 0; k < count; k++) o[k] = std::round(a[k]); break;
+            case Op::EXP:   VectorMath::exp(a, o, count); break;
+            case Op::RAND:  random.fillUniform(o, count); break;
+            case Op::RANDN: random.fillNormal(o, count); break;
+            default:
+                throw std::runtime_error("Vector operations are not supported in batch evaluation");
+        }
+    }
+}
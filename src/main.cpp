@@ -1,23 +1,100 @@
 #include "calculator.h"
 #include "repl.h"
+#include "csv_pipeline.h"
+#include "definition_library.h"
+#include "mapped_file.h"
+#include <cstdio>
+#include <fstream>
 #include <iostream>
 #include <string>
+#include <vector>
+
+#if defined(_WIN32)
+#include <fcntl.h>
+#include <io.h>
+#endif
 
 void showVersion() {
     std::cout << "calcpp v1.0.0 - CLI Calculator\n";
     std::cout << "Built with C++17\n";
 }
 
+// Point at the failing position of an expression on stderr
+void showErrorPosition(const std::string& expression, size_t offset) {
+    if (expression.empty() || offset > expression.size()) return;
+    size_t column = 0;
+    for (size_t i = 0; i < offset; i++) {
+        // Count UTF-8 code points so the caret lines up under √
+        if ((static_cast<unsigned char>(expression[i]) & 0xC0) != 0x80) column++;
+    }
+    std::cerr << "  " << expression << "\n";
+    std::cerr << "  " << std::string(column, ' ') << "^\n";
+}
+
+// Locate an error inside an expression file: line and column, plus the
+// surrounding text of that line (files can be one very long line)
+void showFilePosition(const std::string& path, const char* data, size_t size, size_t offset) {
+    if (offset > size) return;
+    size_t line = 1;
+    size_t lineStart = 0;
+    for (size_t i = 0; i < offset; i++) {
+        if (data[i] == '\n') {
+            line++;
+            lineStart = i + 1;
+        }
+    }
+    size_t lineEnd = offset;
+    while (lineEnd < size && data[lineEnd] != '\n' && data[lineEnd] != '\r') lineEnd++;
+
+    const size_t context = 40;
+    size_t first = offset - lineStart > context ? offset - context : lineStart;
+    size_t last = lineEnd - offset > context ? offset + context : lineEnd;
+    std::cerr << "  at " << path << ":" << line << ":" << (offset - lineStart + 1) << "\n";
+    showErrorPosition(std::string(data + first, last - first), offset - first);
+}
+
+// What --float32 cost in accuracy, on stderr so it stays out of the data
+void showAccuracy(const AccuracyReport& accuracy) {
+    if (accuracy.sampledRows == 0) {
+        std::fprintf(stderr, "float32: no rows sampled\n");
+        return;
+    }
+    std::fprintf(stderr, "float32: max relative error %.3g over %zu sampled rows (worst: %.17g exact, %.9g float)\n",
+                 accuracy.maxRelativeError, accuracy.sampledRows, accuracy.worstExact, accuracy.worstApproximate);
+}
+
 void showUsage() {
     std::cout << "Usage: calcpp [options] [expression]\n\n";
     std::cout << "Options:\n";
     std::cout << "  -h, --help         Show this help message\n";
     std::cout << "  -v, --version      Show version information\n";
-    std::cout << "  -p, --precision N  Set precision (1-20 digits)\n\n";
+    std::cout << "  -p, --precision N  Set precision (1-20 digits)\n";
+    std::cout << "  -f, --file FILE    Evaluate the expression stored in FILE\n";
+    std::cout << "  --load FILE        Define the 'name = expr' lines of FILE (repeatable, cached)\n";
+    std::cout << "  --csv FILE         Evaluate --expr over the columns of a CSV file\n";
+    std::cout << "  --expr EXPR        Expression for --csv (repeatable, 'name=expr' names the column)\n";
+    std::cout << "  --table ARGS       Tabulate 'expr, x, start, stop, step' as CSV\n";
+    std::cout << "  --binary           Write --table values as raw doubles (floats with --float32)\n";
+    std::cout << "  --float32          Evaluate --csv and --table in single precision; reports the\n";
+    std::cout << "                     error of sampled rows against double on stderr\n";
+    std::cout << "  --mc ARGS          Monte Carlo estimate of 'expr, n[, seed]'\n";
+    std::cout << "  --identify ARGS    Closed forms matching the value of 'expr[, tolerance]'\n";
+    std::cout << "  --index FILE       Closed-form index for --identify\n";
+    std::cout << "  --build-index FILE Generate the closed-form index into FILE\n";
+    std::cout << "  --threads N        Worker threads for batch modes (default: all cores)\n";
+    std::cout << "  --profile          Time the expression per node instead of printing its value\n";
+    std::cout << "  --iterations N     Evaluations for --profile (default: 10000)\n";
+    std::cout << "  --folded FILE      With --profile, write flamegraph folded stacks to FILE\n\n";
     std::cout << "Examples:\n";
     std::cout << "  calcpp \"3 + 5 * 2\"\n";
     std::cout << "  calcpp \"sqrt(16)\"\n";
     std::cout << "  calcpp \"sin(pi/2)\"\n";
+    std::cout << "  calcpp --csv data.csv --expr \"total=price*qty\"\n";
+    std::cout << "  calcpp --table \"sin(x), x, 0, 2*pi, pi/180\" > sin.csv\n";
+    std::cout << "  calcpp --float32 --binary --table \"sin(x)*exp(x/-8), x, 0, 50, 1e-6\" > damped.f32\n";
+    std::cout << "  calcpp --identify \"1.7320508075688772\"\n";
+    std::cout << "  calcpp --mc \"exp(0.2*randn()), 1e7, 42\"\n";
+    std::cout << "  calcpp --load constants.calc \"c^2\"\n";
     std::cout << "  calcpp              (interactive mode)\n";
 }
 
@@ -33,6 +110,18 @@ int main(int argc, char* argv[]) {
 
     // Parse arguments
     std::string expression;
+    std::string csvPath;
+    std::string filePath;
+    std::string tableArguments;
+    std::string mcArguments;
+    std::string identifyArguments;
+    std::string buildIndexPath;
+    std::vector<std::string> loadPaths;
+    bool binary = false;
+    bool profile = false;
+    size_t profileIterations = 10000;
+    std::string foldedPath;
+    CsvPipeline::Options csvOptions;
     for (int i = 1; i < argc; i++) {
         std::string arg = argv[i];
 
@@ -57,6 +146,77 @@ int main(int argc, char* argv[]) {
                 std::cerr << "Error: -p/--precision requires a value\n";
                 return 1;
             }
+        } else if (arg == "-f" || arg == "--file") {
+            if (i + 1 >= argc) {
+                std::cerr << "Error: " << arg << " requires a value\n";
+                return 1;
+            }
+            filePath = argv[++i];
+        } else if (arg == "--load") {
+            if (i + 1 >= argc) {
+                std::cerr << "Error: " << arg << " requires a value\n";
+                return 1;
+            }
+            loadPaths.push_back(argv[++i]);
+        } else if (arg == "--table" || arg == "--mc") {
+            if (i + 1 >= argc) {
+                std::cerr << "Error: " << arg << " requires a value\n";
+                return 1;
+            }
+            (arg == "--table" ? tableArguments : mcArguments) = argv[++i];
+        } else if (arg == "--identify" || arg == "--index" || arg == "--build-index") {
+            if (i + 1 >= argc) {
+                std::cerr << "Error: " << arg << " requires a value\n";
+                return 1;
+            }
+            std::string value = argv[++i];
+            if (arg == "--identify") {
+                identifyArguments = value;
+            } else if (arg == "--index") {
+                calculator.setIdentifyIndex(value);
+            } else {
+                buildIndexPath = value;
+            }
+        } else if (arg == "--binary") {
+            binary = true;
+        } else if (arg == "--float32") {
+            csvOptions.float32 = true;
+        } else if (arg == "--profile") {
+            profile = true;
+        } else if (arg == "--iterations" || arg == "--folded") {
+            if (i + 1 >= argc) {
+                std::cerr << "Error: " << arg << " requires a value\n";
+                return 1;
+            }
+            std::string value = argv[++i];
+            if (arg == "--folded") {
+                foldedPath = value;
+            } else {
+                try {
+                    profileIterations = std::stoul(value);
+                } catch (const std::exception& e) {
+                    std::cerr << "Error: Invalid iteration count\n";
+                    return 1;
+                }
+            }
+        } else if (arg == "--csv" || arg == "--expr" || arg == "--threads") {
+            if (i + 1 >= argc) {
+                std::cerr << "Error: " << arg << " requires a value\n";
+                return 1;
+            }
+            std::string value = argv[++i];
+            if (arg == "--csv") {
+                csvPath = value;
+            } else if (arg == "--expr") {
+                csvOptions.expressions.push_back(value);
+            } else {
+                try {
+                    csvOptions.threads = static_cast<unsigned>(std::stoul(value));
+                } catch (const std::exception& e) {
+                    std::cerr << "Error: Invalid thread count\n";
+                    return 1;
+                }
+            }
         } else if (!arg.empty() && arg[0] != '-') {
             // Treat as expression
             if (!expression.empty()) {
@@ -66,10 +226,150 @@ int main(int argc, char* argv[]) {
         }
     }
 
+    for (const std::string& path : loadPaths) {
+        try {
+            DefinitionLibrary::load(path, calculator);
+        } catch (const CalcException& e) {
+            std::cerr << "Error: " << e.what() << "\n";
+            MappedFile file(path);
+            showFilePosition(path, file.data(), file.size(), e.offset);
+            return 1;
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << "\n";
+            return 1;
+        }
+    }
+
+    if (!csvPath.empty()) {
+        try {
+            csvOptions.precision = calculator.getPrecision();
+            CsvPipeline pipeline(csvPath, csvOptions);
+            CsvPipeline::Stats stats = pipeline.run(stdout);
+            if (csvOptions.float32) {
+                std::fflush(stdout);
+                showAccuracy(stats.accuracy);
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << "\n";
+            return 1;
+        }
+        return 0;
+    }
+
+    if (!tableArguments.empty()) {
+        try {
+#if defined(_WIN32)
+            // Raw values must not go through newline translation
+            if (binary) _setmode(_fileno(stdout), _O_BINARY);
+#endif
+            TableGenerator::Stats stats =
+                calculator.tabulate(tableArguments,
+                                    binary ? TableGenerator::Format::BINARY : TableGenerator::Format::CSV,
+                                    csvOptions.threads, stdout, csvOptions.float32);
+            if (csvOptions.float32) {
+                std::fflush(stdout);
+                showAccuracy(stats.accuracy);
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << "\n";
+            return 1;
+        }
+        return 0;
+    }
+
+    if (!buildIndexPath.empty()) {
+        try {
+            ClosedFormIndex::BuildStats stats = ClosedFormIndex::build(buildIndexPath);
+            std::cout << buildIndexPath << ": " << stats.entries << " closed forms (" << stats.candidates
+                      << " generated), " << stats.bytes << " bytes\n";
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << "\n";
+            return 1;
+        }
+        return 0;
+    }
+
+    if (!identifyArguments.empty()) {
+        try {
+            std::cout << calculator.identify(identifyArguments);
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << "\n";
+            return 1;
+        }
+        return 0;
+    }
+
+    if (!mcArguments.empty()) {
+        try {
+            MonteCarlo::Result result = calculator.monteCarlo(mcArguments, csvOptions.threads);
+            std::cout << calculator.formatMonteCarlo(result);
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << "\n";
+            return 1;
+        }
+        return 0;
+    }
+
+    if (profile) {
+        try {
+            if (!filePath.empty()) {
+                MappedFile file(filePath);
+                expression.assign(file.data(), file.size());
+            }
+            Profiler profiler = calculator.profile(expression, profileIterations);
+            profiler.print(std::cout);
+            if (!foldedPath.empty()) {
+                std::ofstream folded(foldedPath);
+                if (!folded) throw std::runtime_error("Cannot open " + foldedPath);
+                profiler.writeFoldedStacks(folded);
+            }
+        } catch (const CalcException& e) {
+            std::cerr << "Error: " << e.what() << "\n";
+            showErrorPosition(expression, e.offset);
+            return 1;
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << "\n";
+            return 1;
+        }
+        return 0;
+    }
+
+    if (!filePath.empty()) {
+        // The file is compiled straight out of the mapping; the parser keeps
+        // its own stack, so arbitrarily deep nesting is fine
+        MappedFile file;
+        try {
+            file.open(filePath);
+            Parser parser;
+            Expression expr = parser.compile(file.data(), file.size());
+            Matrix result = calculator.evaluate(expr);
+            std::cout << calculator.formatValue(result) << "\n";
+        } catch (const CalcException& e) {
+            std::cerr << "Error: " << e.what() << "\n";
+            showFilePosition(filePath, file.data(), file.size(), e.offset);
+            return 1;
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << "\n";
+            return 1;
+        }
+        return 0;
+    }
+
+    // Libraries alone open the REPL with their definitions
+    if (expression.empty() && !loadPaths.empty()) {
+        REPL repl(calculator);
+        repl.run();
+        return 0;
+    }
+
     // Calculate and output result
     try {
-        double result = calculator.calculate(expression);
-        std::cout << calculator.formatResult(result) << "\n";
+        Matrix result = calculator.evaluate(expression);
+        std::cout << calculator.formatValue(result) << "\n";
+    } catch (const CalcException& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        showErrorPosition(expression, e.offset);
+        return 1;
     } catch (const std::exception& e) {
         std::cerr << "Error: " << e.what() << "\n";
         return 1;
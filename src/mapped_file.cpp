@@ -0,0 +1,126 @@
+#include "mapped_file.h"
+#include <stdexcept>
+#include <utility>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::string& path) {
+    open(path);
+}
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept {
+    *this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        close();
+        begin = std::exchange(other.begin, nullptr);
+        length = std::exchange(other.length, 0);
+        opened = std::exchange(other.opened, false);
+#if defined(_WIN32)
+        fileHandle = std::exchange(other.fileHandle, nullptr);
+        mappingHandle = std::exchange(other.mappingHandle, nullptr);
+#endif
+    }
+    return *this;
+}
+
+#if defined(_WIN32)
+
+void MappedFile::open(const std::string& path) {
+    close();
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                              OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("Cannot open file: " + path);
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) {
+        CloseHandle(file);
+        throw std::runtime_error("Cannot read file size: " + path);
+    }
+    fileHandle = file;
+    opened = true;
+    length = static_cast<size_t>(size.QuadPart);
+    if (length == 0) return;
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr) {
+        close();
+        throw std::runtime_error("Cannot map file: " + path);
+    }
+    mappingHandle = mapping;
+    begin = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    if (begin == nullptr) {
+        close();
+        throw std::runtime_error("Cannot map file: " + path);
+    }
+}
+
+void MappedFile::close() {
+    if (begin != nullptr) UnmapViewOfFile(begin);
+    if (mappingHandle != nullptr) CloseHandle(mappingHandle);
+    if (fileHandle != nullptr) CloseHandle(fileHandle);
+    begin = nullptr;
+    mappingHandle = nullptr;
+    fileHandle = nullptr;
+    length = 0;
+    opened = false;
+}
+
+#else
+
+void MappedFile::open(const std::string& path) {
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open file: " + path);
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        ::close(fd);
+        throw std::runtime_error("Cannot read file size: " + path);
+    }
+    opened = true;
+    length = static_cast<size_t>(st.st_size);
+    if (length == 0) {
+        ::close(fd);
+        return;
+    }
+
+    void* p = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);  // the mapping keeps its own reference
+    if (p == MAP_FAILED) {
+        length = 0;
+        opened = false;
+        throw std::runtime_error("Cannot map file: " + path);
+    }
+#if defined(MADV_SEQUENTIAL)
+    madvise(p, length, MADV_SEQUENTIAL);
+#endif
+    begin = static_cast<const char*>(p);
+}
+
+void MappedFile::close() {
+    if (begin != nullptr) {
+        munmap(const_cast<char*>(begin), length);
+    }
+    begin = nullptr;
+    length = 0;
+    opened = false;
+}
+
+#endif
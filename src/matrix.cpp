@@ -0,0 +1,466 @@
+#include "matrix.h"
+#include "random.h"
+#include "vector_math.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CALCPP_MATMUL_SSE2 1
+#endif
+
+Matrix::Matrix() : data(1, 0.0), rowCount(1), colCount(1), dimensions(0) {}
+
+Matrix::Matrix(size_t rows, size_t cols, double fill)
+    : data(rows * cols, fill), rowCount(rows), colCount(cols), dimensions(2) {}
+
+Matrix Matrix::scalar(double value) {
+    Matrix m;
+    m.data[0] = value;
+    return m;
+}
+
+Matrix Matrix::vector(size_t length, double fill) {
+    Matrix m(1, length, fill);
+    m.dimensions = 1;
+    return m;
+}
+
+double Matrix::toScalar() const {
+    if (!isScalar()) {
+        throw std::runtime_error("Expected a scalar value");
+    }
+    return data[0];
+}
+
+namespace {
+
+std::string shapeString(const Matrix& m) {
+    if (m.isScalar()) return "scalar";
+    if (m.isVector()) return "vector(" + std::to_string(m.cols()) + ")";
+    return std::to_string(m.rows()) + "x" + std::to_string(m.cols());
+}
+
+// Element-wise binary operation with NumPy-style broadcasting: a dimension
+// of size 1 stretches to match the other operand.
+template <typename F>
+Matrix broadcast(const Matrix& a, const Matrix& b, F f) {
+    if (a.rows() == b.rows() && a.cols() == b.cols()) {
+        Matrix result = a.dims() >= b.dims() ? a : b;
+        const double* pa = a.values();
+        const double* pb = b.values();
+        double* out = result.values();
+        for (size_t i = 0; i < result.size(); i++) {
+            out[i] = f(pa[i], pb[i]);
+        }
+        return result;
+    }
+
+    if ((a.rows() != b.rows() && a.rows() != 1 && b.rows() != 1) ||
+        (a.cols() != b.cols() && a.cols() != 1 && b.cols() != 1)) {
+        throw std::runtime_error("Shape mismatch: " + shapeString(a) + " and " + shapeString(b));
+    }
+
+    size_t rows = std::max(a.rows(), b.rows());
+    size_t cols = std::max(a.cols(), b.cols());
+    Matrix result = (std::max(a.dims(), b.dims()) == 1) ? Matrix::vector(cols) : Matrix(rows, cols);
+    size_t aRowStep = a.rows() == 1 ? 0 : a.cols();
+    size_t bRowStep = b.rows() == 1 ? 0 : b.cols();
+    size_t aColStep = a.cols() == 1 ? 0 : 1;
+    size_t bColStep = b.cols() == 1 ? 0 : 1;
+
+    for (size_t r = 0; r < rows; r++) {
+        const double* pa = a.values() + r * aRowStep;
+        const double* pb = b.values() + r * bRowStep;
+        double* out = result.values() + r * cols;
+        for (size_t c = 0; c < cols; c++) {
+            out[c] = f(pa[c * aColStep], pb[c * bColStep]);
+        }
+    }
+    return result;
+}
+
+} // namespace
+
+Matrix Matrix::operator+(const Matrix& other) const {
+    return broadcast(*this, other, [](double x, double y) { return x + y; });
+}
+
+Matrix Matrix::operator-(const Matrix& other) const {
+    return broadcast(*this, other, [](double x, double y) { return x - y; });
+}
+
+Matrix Matrix::operator*(const Matrix& other) const {
+    return broadcast(*this, other, [](double x, double y) { return x * y; });
+}
+
+Matrix Matrix::operator/(const Matrix& other) const {
+    return broadcast(*this, other, [](double x, double y) {
+        if (y == 0) throw std::runtime_error("Division by zero");
+        return x / y;
+    });
+}
+
+Matrix Matrix::operator%(const Matrix& other) const {
+    return broadcast(*this, other, [](double x, double y) {
+        if (y == 0) throw std::runtime_error("Modulo by zero");
+        return std::fmod(x, y);
+    });
+}
+
+Matrix Matrix::pow(const Matrix& other) const {
+    return broadcast(*this, other, [](double x, double y) { return std::pow(x, y); });
+}
+
+Matrix Matrix::operator-() const {
+    Matrix result = *this;
+    for (double& v : result.data) v = -v;
+    return result;
+}
+
+Matrix Matrix::map(double (*f)(double)) const {
+    Matrix result = *this;
+    for (double& v : result.data) v = f(v);
+    return result;
+}
+
+void Matrix::append(const Matrix& element) {
+    if (isVector() && element.isScalar()) {
+        data.push_back(element.data[0]);
+        colCount++;
+        return;
+    }
+    if (dimensions == 2 && element.isVector()) {
+        if (element.cols() != colCount) {
+            throw std::runtime_error("Inconsistent row lengths in matrix literal");
+        }
+        data.insert(data.end(), element.data.begin(), element.data.end());
+        rowCount++;
+        return;
+    }
+    throw std::runtime_error("Cannot mix scalars and vectors in a literal");
+}
+
+// ---------------------------------------------------------------------------
+// Matrix multiply
+//
+// The blocked algorithm lives in matrix_kernels.inc. This file builds it for
+// the baseline instruction set (SSE2 on x86-64, plain doubles elsewhere);
+// matrix_avx2.cpp and matrix_avx512.cpp build it with wider vectors and FMA,
+// and the build VectorMath picked for this CPU (getIsa()) is used.
+// ---------------------------------------------------------------------------
+
+namespace {
+
+#if defined(CALCPP_MATMUL_SSE2)
+struct Gemm {
+    using V = __m128d;
+    static constexpr size_t LANES = 2;
+    static constexpr size_t MR = 4;
+
+    static V load(const double* p) { return _mm_loadu_pd(p); }
+    static void store(double* p, V v) { _mm_storeu_pd(p, v); }
+    static V set(double x) { return _mm_set1_pd(x); }
+    static V zero() { return _mm_setzero_pd(); }
+    static V fma(V a, V b, V c) { return _mm_add_pd(_mm_mul_pd(a, b), c); }
+};
+#else
+struct Gemm {
+    using V = double;
+    static constexpr size_t LANES = 1;
+    static constexpr size_t MR = 4;
+
+    static V load(const double* p) { return *p; }
+    static void store(double* p, V v) { *p = v; }
+    static V set(double x) { return x; }
+    static V zero() { return 0.0; }
+    static V fma(V a, V b, V c) { return a * b + c; }
+};
+#endif
+
+} // namespace
+
+#include "matrix_kernels.inc"
+
+#if defined(CALCPP_VECTOR_MATH_X86)
+void avx2MatmulRows(size_t m, size_t n, size_t k, const double* a, const double* b, double* c);
+void avx512MatmulRows(size_t m, size_t n, size_t k, const double* a, const double* b, double* c);
+#endif
+
+namespace {
+
+using MatmulRows = void (*)(size_t m, size_t n, size_t k, const double* a, const double* b, double* c);
+
+// Below this many multiply-adds a single thread is faster
+constexpr size_t PARALLEL_THRESHOLD = size_t(1) << 22;
+
+// Thread bands start on a multiple of every build's MR
+constexpr size_t BAND_ROWS = 8;
+
+MatmulRows selectMatmul() {
+#if defined(CALCPP_VECTOR_MATH_X86)
+    switch (VectorMath::getIsa()) {
+        case VectorMath::Isa::AVX512: return avx512MatmulRows;
+        case VectorMath::Isa::AVX2: return avx2MatmulRows;
+        default: break;
+    }
+#endif
+    return BlockedMatmul<Gemm>::rows;
+}
+
+} // namespace
+
+void matmulKernel(size_t m, size_t n, size_t k, const double* a, const double* b, double* c) {
+    std::fill(c, c + m * n, 0.0);
+    if (m == 0 || n == 0 || k == 0) return;
+
+    size_t threads = 1;
+    if (m * n * k >= PARALLEL_THRESHOLD) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+        threads = std::min(threads, (m + BAND_ROWS - 1) / BAND_ROWS);
+    }
+    MatmulRows matmulRows = selectMatmul();
+    if (threads <= 1) {
+        matmulRows(m, n, k, a, b, c);
+        return;
+    }
+
+    // Each thread owns a contiguous band of rows of C (and its own pack
+    // buffers), so no synchronization is needed beyond the final join.
+    size_t band = ((m + threads - 1) / threads + BAND_ROWS - 1) / BAND_ROWS * BAND_ROWS;
+    std::vector<std::thread> workers;
+    for (size_t start = 0; start < m; start += band) {
+        size_t rows = std::min(band, m - start);
+        workers.emplace_back(matmulRows, rows, n, k, a + start * k, b, c + start * n);
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+Matrix Matrix::matmul(const Matrix& a, const Matrix& b) {
+    if (a.isScalar() || b.isScalar()) {
+        throw std::runtime_error("matmul() requires vector or matrix arguments");
+    }
+    if (a.isVector() && b.isVector()) {
+        return scalar(dot(a, b));
+    }
+
+    // A vector on the right acts as a column
+    size_t bRows = b.isVector() ? b.cols() : b.rows();
+    size_t bCols = b.isVector() ? 1 : b.cols();
+    if (a.cols() != bRows) {
+        throw std::runtime_error("matmul() shape mismatch: " + shapeString(a) + " and " + shapeString(b));
+    }
+
+    Matrix result(a.rows(), bCols);
+    matmulKernel(a.rows(), bCols, a.cols(), a.values(), b.values(), result.values());
+    if (a.isVector() || b.isVector()) {
+        result.dimensions = 1;
+        result.colCount = result.data.size();
+        result.rowCount = 1;
+    }
+    return result;
+}
+
+Matrix Matrix::transpose(const Matrix& m) {
+    if (m.isScalar()) return m;
+    Matrix result(m.cols(), m.rows());
+    for (size_t r = 0; r < m.rows(); r++) {
+        for (size_t c = 0; c < m.cols(); c++) {
+            result(c, r) = m(r, c);
+        }
+    }
+    return result;
+}
+
+double Matrix::dot(const Matrix& a, const Matrix& b) {
+    if (a.size() != b.size() || a.isScalar() || b.isScalar()) {
+        throw std::runtime_error("dot() shape mismatch: " + shapeString(a) + " and " + shapeString(b));
+    }
+    double sum = 0.0;
+    for (size_t i = 0; i < a.size(); i++) {
+        sum += a.data[i] * b.data[i];
+    }
+    return sum;
+}
+
+double Matrix::norm(const Matrix& m) {
+    double sum = 0.0;
+    for (double v : m.data) {
+        sum += v * v;
+    }
+    return std::sqrt(sum);
+}
+
+double Matrix::det(const Matrix& m) {
+    if (m.isScalar()) return m.data[0];
+    if (m.dims() != 2 || m.rows() != m.cols()) {
+        throw std::runtime_error("det() requires a square matrix");
+    }
+
+    // LU decomposition with partial pivoting
+    size_t n = m.rows();
+    Matrix lu = m;
+    double result = 1.0;
+    for (size_t col = 0; col < n; col++) {
+        size_t pivot = col;
+        for (size_t r = col + 1; r < n; r++) {
+            if (std::abs(lu(r, col)) > std::abs(lu(pivot, col))) pivot = r;
+        }
+        if (lu(pivot, col) == 0) return 0.0;
+        if (pivot != col) {
+            for (size_t c = 0; c < n; c++) std::swap(lu(pivot, c), lu(col, c));
+            result = -result;
+        }
+        double diag = lu(col, col);
+        result *= diag;
+        for (size_t r = col + 1; r < n; r++) {
+            double factor = lu(r, col) / diag;
+            for (size_t c = col + 1; c < n; c++) {
+                lu(r, c) -= factor * lu(col, c);
+            }
+        }
+    }
+    return result;
+}
+
+Matrix Matrix::solve(const Matrix& a, const Matrix& b) {
+    if (a.dims() != 2 || a.rows() != a.cols()) {
+        throw std::runtime_error("solve() requires a square matrix");
+    }
+    size_t n = a.rows();
+    size_t bRows = b.isVector() ? b.cols() : b.rows();
+    size_t rhs = b.isVector() ? 1 : b.cols();
+    if (b.isScalar() || bRows != n) {
+        throw std::runtime_error("solve() shape mismatch: " + shapeString(a) + " and " + shapeString(b));
+    }
+
+    // Gaussian elimination with partial pivoting on [A | B]
+    Matrix lu = a;
+    Matrix x(n, rhs);
+    std::copy(b.data.begin(), b.data.end(), x.data.begin());
+
+    double scale = 0.0;
+    for (double v : lu.data) scale = std::max(scale, std::abs(v));
+
+    for (size_t col = 0; col < n; col++) {
+        size_t pivot = col;
+        for (size_t r = col + 1; r < n; r++) {
+            if (std::abs(lu(r, col)) > std::abs(lu(pivot, col))) pivot = r;
+        }
+        if (std::abs(lu(pivot, col)) <= scale * 1e-14) {
+            throw std::runtime_error("Matrix is singular");
+        }
+        if (pivot != col) {
+            for (size_t c = 0; c < n; c++) std::swap(lu(pivot, c), lu(col, c));
+            for (size_t c = 0; c < rhs; c++) std::swap(x(pivot, c), x(col, c));
+        }
+        for (size_t r = col + 1; r < n; r++) {
+            double factor = lu(r, col) / lu(col, col);
+            if (factor == 0) continue;
+            for (size_t c = col + 1; c < n; c++) lu(r, c) -= factor * lu(col, c);
+            for (size_t c = 0; c < rhs; c++) x(r, c) -= factor * x(col, c);
+        }
+    }
+
+    // Back substitution
+    for (size_t col = n; col-- > 0; ) {
+        for (size_t c = 0; c < rhs; c++) {
+            double sum = x(col, c);
+            for (size_t k = col + 1; k < n; k++) sum -= lu(col, k) * x(k, c);
+            x(col, c) = sum / lu(col, col);
+        }
+    }
+
+    if (b.isVector()) {
+        x.dimensions = 1;
+        x.rowCount = 1;
+        x.colCount = n;
+    }
+    return x;
+}
+
+// ---------------------------------------------------------------------------
+// Evaluation of compiled expressions over matrix values
+// ---------------------------------------------------------------------------
+
+namespace {
+
+double (*elementFunction(Expression::Op op))(double) {
+    using Op = Expression::Op;
+    switch (op) {
+        case Op::SIN:   return [](double x) { return std::sin(x); };
+        case Op::COS:   return [](double x) { return std::cos(x); };
+        case Op::TAN:   return [](double x) { return std::tan(x); };
+        case Op::ASIN:  return [](double x) { return std::asin(x); };
+        case Op::ACOS:  return [](double x) { return std::acos(x); };
+        case Op::ATAN:  return [](double x) { return std::atan(x); };
+        case Op::LOG10: return [](double x) { return std::log10(x); };
+        case Op::LN:    return [](double x) { return std::log(x); };
+        case Op::SQRT:  return [](double x) { return std::sqrt(x); };
+        case Op::ABS:   return [](double x) { return std::abs(x); };
+        case Op::FLOOR: return [](double x) { return std::floor(x); };
+        case Op::CEIL:  return [](double x) { return std::ceil(x); };
+        case Op::ROUND: return [](double x) { return std::round(x); };
+        case Op::EXP:   return [](double x) { return std::exp(x); };
+        default:        return nullptr;
+    }
+}
+
+} // namespace
+
+Matrix evaluateMatrix(const Expression& expr, const std::vector<Matrix>& values) {
+    using Op = Expression::Op;
+    const auto& nodes = expr.getNodes();
+    std::vector<Matrix> r(nodes.size());
+
+    for (size_t i = 0; i < nodes.size(); i++) {
+        const Expression::Node& node = nodes[i];
+        switch (node.op) {
+            case Op::CONST: r[i] = Matrix::scalar(node.value); break;
+            case Op::VAR:   r[i] = values[node.lhs]; break;
+            case Op::NEG:   r[i] = -r[node.lhs]; break;
+            case Op::ADD:   r[i] = r[node.lhs] + r[node.rhs]; break;
+            case Op::SUB:   r[i] = r[node.lhs] - r[node.rhs]; break;
+            case Op::MUL:   r[i] = r[node.lhs] * r[node.rhs]; break;
+            case Op::DIV:   r[i] = r[node.lhs] / r[node.rhs]; break;
+            case Op::MOD:   r[i] = r[node.lhs] % r[node.rhs]; break;
+            case Op::POW:   r[i] = r[node.lhs].pow(r[node.rhs]); break;
+            case Op::RAND:  r[i] = Matrix::scalar(Random::local().uniform()); break;
+            case Op::RANDN: r[i] = Matrix::scalar(Random::local().normal()); break;
+            case Op::LIST: {
+                const Matrix& first = r[node.lhs];
+                if (first.isScalar()) {
+                    r[i] = Matrix::vector(1, first[0]);
+                } else if (first.isVector()) {
+                    r[i] = Matrix(1, first.cols());
+                    std::copy(first.values(), first.values() + first.size(), r[i].values());
+                } else {
+                    throw std::runtime_error("Only vectors and matrices are supported in literals");
+                }
+                break;
+            }
+            case Op::APPEND:
+                // A list node feeds exactly one APPEND, so it can be consumed
+                r[i] = std::move(r[node.lhs]);
+                r[i].append(r[node.rhs]);
+                break;
+            case Op::DOT:       r[i] = Matrix::scalar(Matrix::dot(r[node.lhs], r[node.rhs])); break;
+            case Op::MATMUL:    r[i] = Matrix::matmul(r[node.lhs], r[node.rhs]); break;
+            case Op::SOLVE:     r[i] = Matrix::solve(r[node.lhs], r[node.rhs]); break;
+            case Op::NORM:      r[i] = Matrix::scalar(Matrix::norm(r[node.lhs])); break;
+            case Op::TRANSPOSE: r[i] = Matrix::transpose(r[node.lhs]); break;
+            case Op::DET:       r[i] = Matrix::scalar(Matrix::det(r[node.lhs])); break;
+            default:
+                r[i] = r[node.lhs].map(elementFunction(node.op));
+                break;
+        }
+    }
+
+    return std::move(r[expr.getRoot()]);
+}
@@ -0,0 +1,32 @@
+// AVX2 + FMA build of the blocked matrix multiply (4 x 8 micro-kernel).
+// Compiled with AVX2/FMA code generation; only called after CPU detection.
+#include "matrix.h"
+
+#if defined(CALCPP_VECTOR_MATH_X86)
+#include <algorithm>
+#include <immintrin.h>
+#include <vector>
+
+namespace {
+
+struct Gemm {
+    using V = __m256d;
+    static constexpr size_t LANES = 4;
+    static constexpr size_t MR = 4;
+
+    static V load(const double* p) { return _mm256_loadu_pd(p); }
+    static void store(double* p, V v) { _mm256_storeu_pd(p, v); }
+    static V set(double x) { return _mm256_set1_pd(x); }
+    static V zero() { return _mm256_setzero_pd(); }
+    static V fma(V a, V b, V c) { return _mm256_fmadd_pd(a, b, c); }
+};
+
+} // namespace
+
+#include "matrix_kernels.inc"
+
+void avx2MatmulRows(size_t m, size_t n, size_t k, const double* a, const double* b, double* c) {
+    BlockedMatmul<Gemm>::rows(m, n, k, a, b, c);
+}
+
+#endif
@@ -0,0 +1,33 @@
+// AVX-512F build of the blocked matrix multiply (8 x 16 micro-kernel: 16 of
+// the 32 vector registers hold accumulators).
+// Compiled with AVX-512F code generation; only called after CPU detection.
+#include "matrix.h"
+
+#if defined(CALCPP_VECTOR_MATH_X86)
+#include <algorithm>
+#include <immintrin.h>
+#include <vector>
+
+namespace {
+
+struct Gemm {
+    using V = __m512d;
+    static constexpr size_t LANES = 8;
+    static constexpr size_t MR = 8;
+
+    static V load(const double* p) { return _mm512_loadu_pd(p); }
+    static void store(double* p, V v) { _mm512_storeu_pd(p, v); }
+    static V set(double x) { return _mm512_set1_pd(x); }
+    static V zero() { return _mm512_setzero_pd(); }
+    static V fma(V a, V b, V c) { return _mm512_fmadd_pd(a, b, c); }
+};
+
+} // namespace
+
+#include "matrix_kernels.inc"
+
+void avx512MatmulRows(size_t m, size_t n, size_t k, const double* a, const double* b, double* c) {
+    BlockedMatmul<Gemm>::rows(m, n, k, a, b, c);
+}
+
+#endif
@@ -0,0 +1,131 @@
+#include "monte_carlo.h"
+#include "batch_tuning.h"
+#include "parser.h"
+#include "random.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+
+void MonteCarlo::Moments::merge(const Moments& other) {
+    invalid += other.invalid;
+    if (other.count == 0) return;
+    if (count == 0) {
+        count = other.count;
+        mean = other.mean;
+        m2 = other.m2;
+        return;
+    }
+    double n = static_cast<double>(count);
+    double m = static_cast<double>(other.count);
+    double delta = other.mean - mean;
+    mean += delta * (m / (n + m));
+    m2 += other.m2 + delta * delta * (n * m / (n + m));
+    count += other.count;
+}
+
+MonteCarlo::MonteCarlo(const Options& opts, const std::unordered_map<std::string, double>& variables)
+    : options(opts) {
+    if (options.samples == 0) {
+        throw std::runtime_error("mc requires at least one sample");
+    }
+    if (options.blockSamples == 0) options.blockSamples = CHUNK_ROWS;
+
+    Parser parser;
+    expr = parser.compile(options.expression);
+    if (expr.hasMatrixOps()) {
+        throw std::runtime_error("Vector operations are not supported in mc expressions");
+    }
+    constants = expr.bindVariables(variables);
+}
+
+MonteCarlo::Moments MonteCarlo::processBlock(size_t index) const {
+    uint64_t first = static_cast<uint64_t>(index) * options.blockSamples;
+    size_t count = static_cast<size_t>(std::min<uint64_t>(options.blockSamples, options.samples - first));
+
+    std::vector<std::vector<double>> columns(expr.getVariableCount());
+    std::vector<const double*> slots(expr.getVariableCount());
+    for (size_t slot = 0; slot < columns.size(); slot++) {
+        columns[slot].assign(CHUNK_ROWS, constants[slot]);
+        slots[slot] = columns[slot].data();
+    }
+    std::vector<double> y(CHUNK_ROWS);
+    std::vector<double> registers;
+    Random random(options.seed, index);
+
+    Moments block;
+    for (size_t done = 0; done < count; done += CHUNK_ROWS) {
+        size_t n = std::min(CHUNK_ROWS, count - done);
+        expr.evaluateBatch(slots.data(), n, y.data(), registers, random);
+
+        // Two passes over the chunk, then merged into the block
+        Moments chunk;
+        double sum = 0.0;
+        for (size_t k = 0; k < n; k++) {
+            if (std::isfinite(y[k])) {
+                sum += y[k];
+                chunk.count++;
+            }
+        }
+        chunk.invalid = n - chunk.count;
+        if (chunk.count > 0) {
+            chunk.mean = sum / static_cast<double>(chunk.count);
+            for (size_t k = 0; k < n; k++) {
+                if (std::isfinite(y[k])) {
+                    double d = y[k] - chunk.mean;
+                    chunk.m2 += d * d;
+                }
+            }
+        }
+        block.merge(chunk);
+    }
+    return block;
+}
+
+MonteCarlo::Result MonteCarlo::run() const {
+    size_t blocks = static_cast<size_t>((options.samples + options.blockSamples - 1) / options.blockSamples);
+    std::vector<Moments> moments(blocks);
+    unsigned threads = options.threads ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+    threads = static_cast<unsigned>(std::min<size_t>(threads, blocks));
+
+    std::atomic<size_t> next{0};
+    auto work = [&]() {
+        for (size_t index; (index = next.fetch_add(1, std::memory_order_relaxed)) < blocks; ) {
+            moments[index] = processBlock(index);
+        }
+    };
+    if (threads <= 1) {
+        work();
+    } else {
+        std::vector<std::thread> workers;
+        for (unsigned t = 0; t < threads; t++) {
+            workers.emplace_back(work);
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+
+    // Block order, not completion order, fixes the rounding of the sums
+    Moments total;
+    for (const Moments& block : moments) total.merge(block);
+
+    Result result;
+    result.seed = options.seed;
+    result.samples = total.count;
+    result.invalid = total.invalid;
+    if (total.count == 0) {
+        result.mean = result.variance = result.standardError = std::numeric_limits<double>::quiet_NaN();
+        result.low = result.high = result.mean;
+        return result;
+    }
+    double n = static_cast<double>(total.count);
+    result.mean = total.mean;
+    result.variance = total.count > 1 ? total.m2 / (n - 1.0) : 0.0;
+    result.standardError = std::sqrt(result.variance / n);
+    result.low = result.mean - Z_95 * result.standardError;
+    result.high = result.mean + Z_95 * result.standardError;
+    return result;
+}
@@ -1,7 +1,9 @@
 #include "parser.h"
+#include <algorithm>
 #include <cctype>
-#include <stdexcept>
-#include <sstream>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
 
 Parser::Parser() {
     initializeFunctions();
@@ -14,364 +16,511 @@ void Parser::initializeFunctions() {
         {"log", 6}, {"log10", 7}, {"ln", 8},
         {"sqrt", 9}, {"abs", 10}, {"floor", 11},
         {"ceil", 12}, {"round", 13}, {"exp", 14},
-        {"pow", 15}
+        {"pow", 15},
+        {"dot", 16}, {"norm", 17}, {"matmul", 18},
+        {"transpose", 19}, {"det", 20}, {"solve", 21},
+        {"rand", 22}, {"randn", 23}
     };
 }
 
-std::vector<Parser::Token> Parser::tokenize(const std::string& expression) {
-    std::vector<Token> tokens;
+// Tokens are produced on demand while compiling, so parsing a very large
+// expression never holds more than the current token in memory. The source
+// is only copied when it contains √, which is rewritten to "sqrt".
+class Parser::Lexer {
+public:
+    Lexer(const Parser& owner, const char* text, size_t length)
+        : parser(owner), source(text), size(length) {
+        // UTF-8 √ is E2 88 9A. offsets maps positions in processed back to
+        // the source and is only built when a √ is present.
+        static const char SQRT_SIGN[] = "\xE2\x88\x9A";
+        if (std::search(text, text + length, SQRT_SIGN, SQRT_SIGN + 3) == text + length) {
+            return;
+        }
+        for (size_t j = 0; j < length; ) {
+            if (j + 2 < length &&
+                (unsigned char)text[j] == 0xE2 &&
+                (unsigned char)text[j+1] == 0x88 &&
+                (unsigned char)text[j+2] == 0x9A) {
+                processed += "sqrt";
+                offsets.insert(offsets.end(), 4, j);
+                j += 3;
+            } else {
+                processed += text[j];
+                offsets.push_back(j);
+                j++;
+            }
+        }
+        offsets.push_back(length);
+        source = processed.data();
+        size = processed.size();
+    }
+
+    // Reads the next token; END is returned repeatedly at the end of input
+    bool next(Token& token, CalcError& tokenError);
+
+private:
+    const Parser& parser;
+    const char* source;
+    size_t size;
     size_t i = 0;
-    
-    // Preprocess: Convert √ to sqrt(
-    // UTF-8 √ is E2 88 9A
     std::string processed;
-    for (size_t j = 0; j < expression.length(); ) {
-        // Check for √ (UTF-8: E2 88 9A)
-        if (j + 2 < expression.length() && 
-            (unsigned char)expression[j] == 0xE2 && 
-            (unsigned char)expression[j+1] == 0x88 && 
-            (unsigned char)expression[j+2] == 0x9A) {
-            processed += "sqrt";
-            j += 3;
-        } else {
-            processed += expression[j];
-            j++;
-        }
+    std::vector<size_t> offsets;
+
+    size_t sourceOffset(size_t index) const {
+        return offsets.empty() ? index : offsets[index];
+    }
+    void setToken(Token& token, TokenType type, size_t start, size_t length, double numValue) const {
+        token.type = type;
+        token.value.assign(source + start, length);
+        token.numValue = numValue;
+        token.offset = sourceOffset(start);
+    }
+};
+
+bool Parser::Lexer::next(Token& token, CalcError& tokenError) {
+    while (i < size && std::isspace(static_cast<unsigned char>(source[i]))) {
+        i++;
+    }
+    if (i >= size) {
+        setToken(token, TokenType::END, size, 0, 0.0);
+        return true;
     }
 
-    while (i < processed.length()) {
-        if (std::isspace(processed[i])) {
+    size_t start = i;
+    if (std::isdigit(static_cast<unsigned char>(source[i])) || source[i] == '.') {
+        while (i < size && (std::isdigit(static_cast<unsigned char>(source[i])) || source[i] == '.')) {
             i++;
-            continue;
         }
 
-        if (std::isdigit(processed[i]) || processed[i] == '.') {
-            std::string numStr;
-            while (i < processed.length() && (std::isdigit(processed[i]) || processed[i] == '.')) {
-                numStr += processed[i++];
+        // Check for scientific notation (e or E)
+        if (i < size && (source[i] == 'e' || source[i] == 'E')) {
+            size_t tempI = i + 1;
+            // Handle optional + or - sign after e
+            if (tempI < size && (source[tempI] == '+' || source[tempI] == '-')) {
+                tempI++;
             }
-            
-            // Check for scientific notation (e or E)
-            if (i < processed.length() && (processed[i] == 'e' || processed[i] == 'E')) {
-                size_t tempI = i + 1;
-                // Handle optional + or - sign after e
-                if (tempI < processed.length() && (processed[tempI] == '+' || processed[tempI] == '-')) {
-                    tempI++;
-                }
-                // Check if there's at least one digit after e/E
-                if (tempI < processed.length() && std::isdigit(processed[tempI])) {
-                    numStr += processed[i++];
-                    if (i < processed.length() && (processed[i] == '+' || processed[i] == '-')) {
-                        numStr += processed[i++];
-                    }
-                    // Collect exponent digits
-                    while (i < processed.length() && std::isdigit(processed[i])) {
-                        numStr += processed[i++];
-                    }
+            // Check if there's at least one digit after e/E
+            if (tempI < size && std::isdigit(static_cast<unsigned char>(source[tempI]))) {
+                i = tempI;
+                // Collect exponent digits
+                while (i < size && std::isdigit(static_cast<unsigned char>(source[i]))) {
+                    i++;
                 }
             }
-            
-            Token token;
-            token.type = TokenType::NUMBER;
-            token.value = numStr;
-            try {
-                token.numValue = std::stod(numStr);
-            } catch (const std::exception& e) {
-                throw std::runtime_error("Invalid number format: " + numStr);
-            }
-            tokens.push_back(token);
-            continue;
         }
 
-        if (std::isalpha(processed[i])) {
-            std::string name;
-            while (i < processed.length() && (std::isalnum(processed[i]) || processed[i] == '_')) {
-                name += processed[i++];
-            }
+        // Like std::stod: a valid prefix is accepted, no digits or an
+        // out-of-range value is an error
+        setToken(token, TokenType::NUMBER, start, i - start, 0.0);
+        char* end = nullptr;
+        errno = 0;
+        double value = std::strtod(token.value.c_str(), &end);
+        if (end == token.value.c_str() || errno == ERANGE) {
+            tokenError.set(ErrorCode::INVALID_NUMBER, sourceOffset(start), "Invalid number format: " + token.value);
+            return false;
+        }
+        token.numValue = value;
+        return true;
+    }
 
-            Token token;
-            if (name == "pi") {
-                token.type = TokenType::NUMBER;
-                token.value = "pi";
-                token.numValue = 3.14159265358979323846264338327950288;
-            } else if (name == "e") {
-                token.type = TokenType::NUMBER;
-                token.value = "e";
-                token.numValue = 2.71828182845904523536028747135266249;
-            } else if (name == "phi") {
-                token.type = TokenType::NUMBER;
-                token.value = "phi";
-                token.numValue = 1.61803398874989484820458683436563811;
-            } else if (functionMap.count(name)) {
-                token.type = TokenType::FUNCTION;
-                token.value = name;
-            } else {
-                token.type = TokenType::VARIABLE;
-                token.value = name;
-            }
-            tokens.push_back(token);
-            continue;
+    if (std::isalpha(static_cast<unsigned char>(source[i]))) {
+        while (i < size && (std::isalnum(static_cast<unsigned char>(source[i])) || source[i] == '_')) {
+            i++;
         }
+        setToken(token, TokenType::VARIABLE, start, i - start, 0.0);
+        const std::string& name = token.value;
 
-        switch (processed[i]) {
-            case '+': {
-                Token token;
-                token.type = TokenType::PLUS;
-                token.value = "+";
-                tokens.push_back(token);
-                i++;
-                break;
-            }
-            case '-': {
-                Token token;
-                token.type = TokenType::MINUS;
-                token.value = "-";
-                tokens.push_back(token);
-                i++;
-                break;
-            }
-            case '*': {
-                Token token;
-                token.type = TokenType::MUL;
-                token.value = "*";
-                tokens.push_back(token);
-                i++;
-                break;
-            }
-            case '/': {
-                Token token;
-                token.type = TokenType::DIV;
-                token.value = "/";
-                tokens.push_back(token);
-                i++;
-                break;
-            }
-            case '^': {
-                Token token;
-                token.type = TokenType::POW;
-                token.value = "^";
-                tokens.push_back(token);
-                i++;
-                break;
-            }
-            case '%': {
-                Token token;
-                token.type = TokenType::MOD;
-                token.value = "%";
-                tokens.push_back(token);
-                i++;
-                break;
-            }
-            case '(': {
-                Token token;
-                token.type = TokenType::LPAREN;
-                token.value = "(";
-                tokens.push_back(token);
-                i++;
-                break;
-            }
-            case ')': {
-                Token token;
-                token.type = TokenType::RPAREN;
-                token.value = ")";
-                tokens.push_back(token);
-                i++;
-                break;
-            }
-            case ',': {
-                Token token;
-                token.type = TokenType::COMMA;
-                token.value = ",";
-                tokens.push_back(token);
-                i++;
-                break;
-            }
-            case '=': {
-                Token token;
-                token.type = TokenType::ASSIGN;
-                token.value = "=";
-                tokens.push_back(token);
-                i++;
-                break;
-            }
-            default:
-                throw std::runtime_error(std::string("Unknown character: ") + processed[i]);
+        if (name == "pi") {
+            token.type = TokenType::NUMBER;
+            token.numValue = 3.14159265358979323846264338327950288;
+        } else if (name == "e") {
+            token.type = TokenType::NUMBER;
+            token.numValue = 2.71828182845904523536028747135266249;
+        } else if (name == "phi") {
+            token.type = TokenType::NUMBER;
+            token.numValue = 1.61803398874989484820458683436563811;
+        } else if (parser.functionMap.count(name)) {
+            token.type = TokenType::FUNCTION;
         }
+        return true;
     }
 
-    Token endToken;
-    endToken.type = TokenType::END;
-    tokens.push_back(endToken);
-    return tokens;
+    TokenType type;
+    switch (source[i]) {
+        case '+': type = TokenType::PLUS; break;
+        case '-': type = TokenType::MINUS; break;
+        case '*': type = TokenType::MUL; break;
+        case '/': type = TokenType::DIV; break;
+        case '^': type = TokenType::POW; break;
+        case '%': type = TokenType::MOD; break;
+        case '(': type = TokenType::LPAREN; break;
+        case ')': type = TokenType::RPAREN; break;
+        case '[': type = TokenType::LBRACKET; break;
+        case ']': type = TokenType::RBRACKET; break;
+        case ',': type = TokenType::COMMA; break;
+        case '=': type = TokenType::ASSIGN; break;
+        default:
+            tokenError.set(ErrorCode::UNKNOWN_CHARACTER, sourceOffset(i),
+                           std::string("Unknown character: ") + source[i]);
+            return false;
+    }
+    setToken(token, type, start, 1, 0.0);
+    i++;
+    return true;
 }
 
-double Parser::parseFunction(const std::string& funcName, double arg) {
-    if (funcName == "sin") return std::sin(arg);
-    if (funcName == "cos") return std::cos(arg);
-    if (funcName == "tan") return std::tan(arg);
-    if (funcName == "asin") return std::asin(arg);
-    if (funcName == "acos") return std::acos(arg);
-    if (funcName == "atan") return std::atan(arg);
-    if (funcName == "log") return std::log10(arg);
-    if (funcName == "log10") return std::log10(arg);
-    if (funcName == "ln") return std::log(arg);
-    if (funcName == "sqrt") return std::sqrt(arg);
-    if (funcName == "abs") return std::abs(arg);
-    if (funcName == "floor") return std::floor(arg);
-    if (funcName == "ceil") return std::ceil(arg);
-    if (funcName == "round") return std::round(arg);
-    if (funcName == "exp") return std::exp(arg);
-    throw std::runtime_error("Unknown function: " + funcName);
+std::vector<Parser::Token> Parser::tokenize(const std::string& expression) {
+    std::vector<Token> tokens;
+    CalcError tokenError;
+    if (!tryTokenize(expression, tokens, tokenError)) {
+        throw CalcException(tokenError);
+    }
+    return tokens;
 }
 
-double Parser::parseFactor(const std::vector<Token>& tokens, size_t& pos) {
-    const Token& token = tokens[pos];
+bool Parser::tryTokenize(const std::string& expression, std::vector<Token>& tokens, CalcError& tokenError) {
+    tokens.clear();
+    Lexer lexer(*this, expression.data(), expression.size());
+    Token token;
+    do {
+        if (!lexer.next(token, tokenError)) {
+            return false;
+        }
+        tokens.push_back(token);
+    } while (token.type != TokenType::END);
+    return true;
+}
 
-    if (token.type == TokenType::NUMBER) {
-        pos++;
-        return token.numValue;
+size_t Parser::parseFunction(const std::string& funcName, size_t arg, Expression& expr, size_t offset, CalcError& compileError) {
+    using Op = Expression::Op;
+    Op op;
+    if (funcName == "sin") op = Op::SIN;
+    else if (funcName == "cos") op = Op::COS;
+    else if (funcName == "tan") op = Op::TAN;
+    else if (funcName == "asin") op = Op::ASIN;
+    else if (funcName == "acos") op = Op::ACOS;
+    else if (funcName == "atan") op = Op::ATAN;
+    else if (funcName == "log") op = Op::LOG10;
+    else if (funcName == "log10") op = Op::LOG10;
+    else if (funcName == "ln") op = Op::LN;
+    else if (funcName == "sqrt") op = Op::SQRT;
+    else if (funcName == "abs") op = Op::ABS;
+    else if (funcName == "floor") op = Op::FLOOR;
+    else if (funcName == "ceil") op = Op::CEIL;
+    else if (funcName == "round") op = Op::ROUND;
+    else if (funcName == "exp") op = Op::EXP;
+    else if (funcName == "norm") op = Op::NORM;
+    else if (funcName == "transpose") op = Op::TRANSPOSE;
+    else if (funcName == "det") op = Op::DET;
+    else {
+        compileError.set(ErrorCode::UNKNOWN_FUNCTION, offset, "Unknown function: " + funcName);
+        return INVALID;
     }
+    return expr.addUnary(op, arg, offset);
+}
 
-    if (token.type == TokenType::VARIABLE) {
-        pos++;
-        if (variables != nullptr && variables->find(token.value) != variables->end()) {
-            return variables->at(token.value);
-        }
-        throw std::runtime_error("Variable not defined: " + token.value);
+namespace {
+
+// Entries of the parser's explicit stack. Operators wait in BINARY and
+// NEGATE entries until their right operand is complete; GROUP, FUNCTION and
+// LIST entries mark an open bracket and the construct to finish when it
+// closes; TOP sits at the bottom.
+enum class Entry : uint8_t { TOP, BINARY, NEGATE, GROUP, FUNCTION, LIST };
+
+// Offsets and node indices are 32-bit like those in Expression::Node,
+// which keeps an entry at 16 bytes for deeply nested input.
+struct StackEntry {
+    Entry kind;
+    Expression::Op op = Expression::Op::CONST;   // BINARY, binary FUNCTION
+    uint8_t level = 0;                           // BINARY precedence
+    bool secondArgument = false;                 // binary FUNCTION after ','
+    uint32_t offset = 0;                         // operator / opening token
+    uint32_t node = 0;                           // LIST built so far
+    uint32_t separator = 0;                      // LIST: offset of the last ','
+};
+
+// Binding levels, loosest first. Implicit multiplication takes the level of
+// the construct it was historically parsed at: before '(' it binds like '*',
+// before a function or number like '^' (2pi^2 = (2pi)^2). All operators,
+// including '^', associate to the left.
+constexpr uint8_t LEVEL_SUM = 1;
+constexpr uint8_t LEVEL_PRODUCT = 2;
+constexpr uint8_t LEVEL_POWER = 3;
+
+constexpr uint32_t EMPTY_LIST = UINT32_MAX;
+
+} // namespace
+
+// Operator-precedence parser driven by an explicit stack instead of
+// recursion, so nesting depth is limited only by memory and every token is
+// handled once. It alternates between two states: expecting an operand
+// (prefix operators and openers are pushed) and after an operand (pending
+// operators of equal or higher level are reduced, then the next operator is
+// pushed, or the innermost open construct is closed).
+bool Parser::tryCompile(const char* text, size_t length, Expression& expr, CalcError& compileError) {
+    expr = Expression();
+    expr.setHashConsing(hashConsing);
+    // Typical input yields well under one node per two bytes; reserving up
+    // front avoids copying a large node list while it grows
+    expr.reserve(length / 2 + 1);
+    return tryCompileInto(text, length, expr, compileError);
+}
+
+bool Parser::tryCompileInto(const char* text, size_t length, Expression& expr, CalcError& compileError) {
+    using Op = Expression::Op;
+    Lexer lexer(*this, text, length);
+    Token token;
+    if (!lexer.next(token, compileError)) {
+        return false;
     }
 
-    if (token.type == TokenType::FUNCTION) {
-        std::string funcName = token.value;
-        pos++;
-        if (pos >= tokens.size() || tokens[pos].type != TokenType::LPAREN) {
-            throw std::runtime_error("Expected '(' after function: " + funcName);
+    // Lexical errors take precedence over syntax errors and are reported
+    // even in trailing text the grammar ignores, as when the whole
+    // expression was tokenized up front
+    auto finish = [&](bool parsed) {
+        CalcError lexError;
+        while (token.type != TokenType::END) {
+            if (!lexer.next(token, lexError)) {
+                compileError = std::move(lexError);
+                return false;
+            }
         }
-        pos++;
-        
-        // Handle pow function with two arguments
-        if (funcName == "pow") {
-            double arg1 = parseExpression(tokens, pos);
-            if (pos >= tokens.size() || tokens[pos].type != TokenType::COMMA) {
-                throw std::runtime_error("pow() requires two arguments separated by comma");
+        return parsed;
+    };
+    auto fail = [&](ErrorCode code, size_t offset, std::string message) {
+        compileError.set(code, offset, std::move(message));
+        return finish(false);
+    };
+    auto advance = [&]() {
+        return lexer.next(token, compileError);
+    };
+
+    std::vector<StackEntry> stack;
+    std::vector<size_t> operands;
+    std::vector<std::string> functionNames;      // one per open FUNCTION entry
+    stack.push_back({Entry::TOP});
+
+    auto reduce = [&]() {
+        const StackEntry& entry = stack.back();
+        size_t rhs = operands.back();
+        operands.pop_back();
+        operands.back() = expr.addBinary(entry.op, operands.back(), rhs, entry.offset);
+        stack.pop_back();
+    };
+
+    for (;;) {
+        // Expecting an operand
+        if (token.type == TokenType::NUMBER) {
+            operands.push_back(expr.addConstant(token.numValue, token.offset));
+        } else if (token.type == TokenType::VARIABLE) {
+            operands.push_back(expr.addVariable(token.value, token.offset));
+        } else if (token.type == TokenType::MINUS || token.type == TokenType::PLUS) {
+            if (token.type == TokenType::MINUS) {
+                StackEntry entry{Entry::NEGATE};
+                entry.offset = static_cast<uint32_t>(token.offset);
+                stack.push_back(entry);
             }
-            pos++; // skip comma
-            double arg2 = parseExpression(tokens, pos);
-            if (pos >= tokens.size() || tokens[pos].type != TokenType::RPAREN) {
-                throw std::runtime_error("Expected ')' after pow arguments");
+            if (!advance()) return false;
+            continue;
+        } else if (token.type == TokenType::LPAREN) {
+            StackEntry entry{Entry::GROUP};
+            entry.offset = static_cast<uint32_t>(token.offset);
+            stack.push_back(entry);
+            if (!advance()) return false;
+            continue;
+        } else if (token.type == TokenType::FUNCTION) {
+            StackEntry entry{Entry::FUNCTION};
+            entry.offset = static_cast<uint32_t>(token.offset);
+            functionNames.push_back(token.value);
+            const std::string& funcName = functionNames.back();
+            if (!advance()) return false;
+            if (token.type != TokenType::LPAREN) {
+                return fail(ErrorCode::EXPECTED_LPAREN, token.offset, "Expected '(' after function: " + funcName);
             }
-            pos++;
-            return std::pow(arg1, arg2);
-        }
-        
-        double arg = parseExpression(tokens, pos);
-        if (pos >= tokens.size() || tokens[pos].type != TokenType::RPAREN) {
-            throw std::runtime_error("Expected ')' after function argument");
+            // Functions without arguments are complete at ')'
+            if (funcName == "rand" || funcName == "randn") {
+                Op op = funcName == "rand" ? Op::RAND : Op::RANDN;
+                if (!advance()) return false;
+                if (token.type != TokenType::RPAREN) {
+                    return fail(ErrorCode::EXPECTED_RPAREN, token.offset, funcName + "() takes no arguments");
+                }
+                operands.push_back(expr.addRandom(op, entry.offset));
+                functionNames.pop_back();
+            } else {
+                // Functions with two arguments
+                if (funcName == "pow") entry.op = Op::POW;
+                else if (funcName == "dot") entry.op = Op::DOT;
+                else if (funcName == "matmul") entry.op = Op::MATMUL;
+                else if (funcName == "solve") entry.op = Op::SOLVE;
+                stack.push_back(entry);
+                if (!advance()) return false;
+                continue;
+            }
+        } else if (token.type == TokenType::LBRACKET) {
+            // Vector literal [a, b, ...]; a list of vectors forms a matrix
+            StackEntry entry{Entry::LIST};
+            entry.offset = static_cast<uint32_t>(token.offset);
+            entry.node = EMPTY_LIST;
+            if (!advance()) return false;
+            if (token.type == TokenType::RBRACKET) {
+                return fail(ErrorCode::UNEXPECTED_TOKEN, token.offset, "Empty vector literal");
+            }
+            stack.push_back(entry);
+            continue;
+        } else {
+            return fail(ErrorCode::UNEXPECTED_TOKEN, token.offset, "Unexpected token");
         }
-        pos++;
-        return parseFunction(funcName, arg);
-    }
+        if (!advance()) return false;
 
-    if (token.type == TokenType::LPAREN) {
-        pos++;
-        double result = parseExpression(tokens, pos);
-        if (pos >= tokens.size() || tokens[pos].type != TokenType::RPAREN) {
-            throw std::runtime_error("Expected ')' to match '('");
-        }
-        pos++;
-        return result;
-    }
+        // After an operand
+        for (;;) {
+            // Prefix minus applies to the factor just completed: -2^2 = 4
+            while (stack.back().kind == Entry::NEGATE) {
+                operands.back() = expr.addUnary(Op::NEG, operands.back(), stack.back().offset);
+                stack.pop_back();
+            }
 
-    if (token.type == TokenType::MINUS) {
-        pos++;
-        return -parseFactor(tokens, pos);
-    }
+            uint8_t level = 0;
+            Op op = Op::CONST;
+            bool implicit = false;
+            switch (token.type) {
+                case TokenType::POW: level = LEVEL_POWER; op = Op::POW; break;
+                case TokenType::FUNCTION:
+                case TokenType::NUMBER:
+                    // Implicit multiplication: 2pi -> 2*pi, 2log(x) -> 2*log(x)
+                    level = LEVEL_POWER; op = Op::MUL; implicit = true; break;
+                case TokenType::MUL: level = LEVEL_PRODUCT; op = Op::MUL; break;
+                // Division by zero is reported when the expression is evaluated
+                case TokenType::DIV: level = LEVEL_PRODUCT; op = Op::DIV; break;
+                case TokenType::MOD: level = LEVEL_PRODUCT; op = Op::MOD; break;
+                case TokenType::LPAREN:
+                    // Implicit multiplication: 2(3+4) -> 2*(3+4)
+                    level = LEVEL_PRODUCT; op = Op::MUL; implicit = true; break;
+                case TokenType::PLUS: level = LEVEL_SUM; op = Op::ADD; break;
+                case TokenType::MINUS: level = LEVEL_SUM; op = Op::SUB; break;
+                default: break;
+            }
 
-    if (token.type == TokenType::PLUS) {
-        pos++;
-        return parseFactor(tokens, pos);
-    }
+            if (level > 0) {
+                while (stack.back().kind == Entry::BINARY && stack.back().level >= level) {
+                    reduce();
+                }
+                StackEntry entry{Entry::BINARY};
+                entry.op = op;
+                entry.level = level;
+                entry.offset = static_cast<uint32_t>(token.offset);
+                stack.push_back(entry);
+                if (!implicit && !advance()) return false;
+                break;
+            }
 
-    throw std::runtime_error("Unexpected token");
-}
+            // The current expression ends here; close the innermost construct
+            while (stack.back().kind == Entry::BINARY) {
+                reduce();
+            }
+            StackEntry& frame = stack.back();
 
-double Parser::parseTerm(const std::vector<Token>& tokens, size_t& pos) {
-    double result = parsePower(tokens, pos);
-
-    while (pos < tokens.size()) {
-        const Token& token = tokens[pos];
-        if (token.type == TokenType::MUL) {
-            pos++;
-            result *= parsePower(tokens, pos);
-        } else if (token.type == TokenType::DIV) {
-            pos++;
-            double divisor = parsePower(tokens, pos);
-            if (divisor == 0) {
-                throw std::runtime_error("Division by zero");
+            if (frame.kind == Entry::TOP) {
+                // Anything left over is ignored, as it always has been
+                if (!finish(true)) return false;
+                expr.addRoot(operands.back());
+                return true;
             }
-            result /= divisor;
-        } else if (token.type == TokenType::MOD) {
-            pos++;
-            double mod = parsePower(tokens, pos);
-            if (mod == 0) {
-                throw std::runtime_error("Modulo by zero");
+
+            if (frame.kind == Entry::GROUP) {
+                if (token.type != TokenType::RPAREN) {
+                    return fail(ErrorCode::EXPECTED_RPAREN, token.offset, "Expected ')' to match '('");
+                }
+                stack.pop_back();
+                if (!advance()) return false;
+                continue;
             }
-            result = std::fmod(result, mod);
-        } else if (token.type == TokenType::FUNCTION || (token.type == TokenType::LPAREN && pos > 0)) {
-            // Implicit multiplication: 2log(x) -> 2*log(x), 2(3+4) -> 2*(3+4)
-            result *= parsePower(tokens, pos);
-        } else {
-            break;
-        }
-    }
 
-    return result;
-}
+            if (frame.kind == Entry::FUNCTION) {
+                const std::string& funcName = functionNames.back();
+                bool binary = frame.op != Op::CONST;
+                if (binary && !frame.secondArgument) {
+                    if (token.type != TokenType::COMMA) {
+                        return fail(ErrorCode::EXPECTED_COMMA, token.offset,
+                                    funcName + "() requires two arguments separated by comma");
+                    }
+                    frame.secondArgument = true;
+                    if (!advance()) return false;
+                    break;
+                }
+                if (token.type != TokenType::RPAREN) {
+                    return fail(ErrorCode::EXPECTED_RPAREN, token.offset,
+                                binary ? "Expected ')' after " + funcName + " arguments"
+                                       : std::string("Expected ')' after function argument"));
+                }
+                if (binary) {
+                    size_t rhs = operands.back();
+                    operands.pop_back();
+                    operands.back() = expr.addBinary(frame.op, operands.back(), rhs, frame.offset);
+                } else {
+                    size_t node = parseFunction(funcName, operands.back(), expr, frame.offset, compileError);
+                    if (node == INVALID) return finish(false);
+                    operands.back() = node;
+                }
+                functionNames.pop_back();
+                stack.pop_back();
+                if (!advance()) return false;
+                continue;
+            }
 
-double Parser::parsePower(const std::vector<Token>& tokens, size_t& pos) {
-    double result = parseFactor(tokens, pos);
-
-    while (pos < tokens.size()) {
-        const Token& token = tokens[pos];
-        if (token.type == TokenType::POW) {
-            pos++;
-            result = std::pow(result, parseFactor(tokens, pos));
-        } else if (token.type == TokenType::FUNCTION || 
-                   (token.type == TokenType::NUMBER && token.value != "(" && token.value != ")")) {
-            // Implicit multiplication: 2pi -> 2*pi (but not at end of expression)
-            if (pos < tokens.size()) {
-                result *= parseFactor(tokens, pos);
-            } else {
+            // LIST: append the element just parsed
+            size_t element = operands.back();
+            operands.pop_back();
+            frame.node = static_cast<uint32_t>(frame.node == EMPTY_LIST
+                ? expr.addUnary(Op::LIST, element, frame.offset)
+                : expr.addBinary(Op::APPEND, frame.node, element, frame.separator));
+            if (token.type == TokenType::COMMA) {
+                frame.separator = static_cast<uint32_t>(token.offset);
+                if (!advance()) return false;
                 break;
             }
-        } else {
-            break;
+            if (token.type != TokenType::RBRACKET) {
+                return fail(ErrorCode::EXPECTED_RBRACKET, token.offset, "Expected ']' to match '['");
+            }
+            operands.push_back(frame.node);
+            stack.pop_back();
+            if (!advance()) return false;
         }
     }
+}
 
-    return result;
+bool Parser::tryCompile(const std::string& expression, Expression& expr, CalcError& compileError) {
+    return tryCompile(expression.data(), expression.size(), expr, compileError);
 }
 
-double Parser::parseExpression(const std::vector<Token>& tokens, size_t& pos) {
-    double result = parseTerm(tokens, pos);
-
-    while (pos < tokens.size()) {
-        const Token& token = tokens[pos];
-        if (token.type == TokenType::PLUS) {
-            pos++;
-            result += parseTerm(tokens, pos);
-        } else if (token.type == TokenType::MINUS) {
-            pos++;
-            result -= parseTerm(tokens, pos);
-        } else {
-            break;
-        }
+bool Parser::tryCompileInto(const std::string& expression, Expression& expr, CalcError& compileError) {
+    return tryCompileInto(expression.data(), expression.size(), expr, compileError);
+}
+
+size_t Parser::compileInto(const std::string& expression, Expression& expr) {
+    CalcError compileError;
+    if (!tryCompileInto(expression, expr, compileError)) {
+        throw CalcException(compileError);
     }
+    return expr.getRoots().size() - 1;
+}
 
-    return result;
+Expression Parser::compile(const std::string& expression) {
+    return compile(expression.data(), expression.size());
+}
+
+Expression Parser::compile(const char* text, size_t length) {
+    Expression expr;
+    CalcError compileError;
+    if (!tryCompile(text, length, expr, compileError)) {
+        throw CalcException(compileError);
+    }
+    return expr;
 }
 
 double Parser::parse(const std::string& expression) {
-    auto tokens = tokenize(expression);
-    size_t pos = 0;
-    return parseExpression(tokens, pos);
+    Expression expr = compile(expression);
+    static const std::unordered_map<std::string, double> noVariables;
+    std::vector<double> values = expr.bindVariables(variables ? *variables : noVariables);
+    return expr.evaluate(values.data());
 }
@@ -0,0 +1,240 @@
+#include "profiler.h"
+#include "parser.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <stdexcept>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using Op = Expression::Op;
+
+// Compiling is timed until this budget is spent, even if that takes fewer
+// than `iterations` rounds
+constexpr double COMPILE_BUDGET_SECONDS = 1.0;
+
+// Deeper frames are merged so folded lines stay bounded on deep chains
+constexpr size_t MAX_FOLDED_FRAMES = 256;
+
+double nanosecondsSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+}
+
+std::string format(const char* pattern, double value) {
+    char buffer[64];
+    std::snprintf(buffer, sizeof(buffer), pattern, value);
+    return buffer;
+}
+
+} // namespace
+
+Profiler::Profiler(const std::string& expression, const std::unordered_map<std::string, double>& variables)
+    : source(expression) {
+    Parser parser;
+    expr = parser.compile(source);
+    if (expr.hasMatrixOps()) {
+        throw std::runtime_error("profile supports scalar expressions only");
+    }
+    values = expr.bindVariables(variables);
+    // Surfaces evaluation errors (division by zero) before any timing
+    result = expr.evaluate(values.data());
+
+    // Pre-order walk from the root; a node reached again is a reference
+    const auto& nodes = expr.getNodes();
+    stats.assign(nodes.size(), NodeStats());
+    treeParents.assign(nodes.size(), NO_PARENT);
+    struct Visit {
+        uint32_t node;
+        uint32_t depth;
+        uint32_t parent;
+    };
+    std::vector<Visit> stack{{static_cast<uint32_t>(expr.getRoot()), 0, NO_PARENT}};
+    std::vector<char> expanded(nodes.size(), 0);
+    while (!stack.empty()) {
+        Visit visit = stack.back();
+        stack.pop_back();
+        order.push_back(visit.node);
+        depths.push_back(visit.depth);
+        shared.push_back(expanded[visit.node]);
+        if (expanded[visit.node]) continue;
+        expanded[visit.node] = 1;
+        treeParents[visit.node] = visit.parent;
+
+        const Expression::Node& node = nodes[visit.node];
+        if (Expression::isLeaf(node.op)) continue;
+        stats[node.lhs].uses++;
+        if (!Expression::isUnary(node.op)) {
+            stats[node.rhs].uses++;
+            stack.push_back({node.rhs, visit.depth + 1, visit.node});
+        }
+        stack.push_back({node.lhs, visit.depth + 1, visit.node});
+    }
+}
+
+void Profiler::run(size_t iterations) {
+    this->iterations = std::max<size_t>(1, iterations);
+
+    Parser parser;
+    size_t compiles = 0;
+    auto start = Clock::now();
+    double elapsed = 0.0;
+    do {
+        Expression compiled = parser.compile(source);
+        compiles++;
+        elapsed = nanosecondsSince(start);
+    } while (compiles < this->iterations && elapsed < COMPILE_BUDGET_SECONDS * 1e9);
+    compileNanoseconds = elapsed / compiles;
+
+    std::vector<double> registers;
+    volatile double sink = 0.0;
+    start = Clock::now();
+    for (size_t i = 0; i < this->iterations; i++) {
+        sink = expr.evaluate(values.data(), registers);
+    }
+    evaluateNanoseconds = nanosecondsSince(start) / this->iterations;
+
+    // Replay each node on the operands of the last evaluation; random
+    // nodes would consume the generator
+    const auto& nodes = expr.getNodes();
+    for (size_t k = 0; k < order.size(); k++) {
+        if (shared[k]) continue;
+        uint32_t index = order[k];
+        const Expression::Node& node = nodes[index];
+        if (node.op == Op::RAND || node.op == Op::RANDN) continue;
+        double a = node.op == Op::CONST ? node.value
+                 : node.op == Op::VAR ? values[node.lhs]
+                 : registers[node.lhs];
+        double b = !Expression::isLeaf(node.op) && !Expression::isUnary(node.op) ? registers[node.rhs] : 0.0;
+
+        start = Clock::now();
+        for (size_t i = 0; i < this->iterations; i++) {
+            sink = Expression::applyScalar(node.op, a, b);
+        }
+        NodeStats& s = stats[index];
+        s.replays = this->iterations;
+        s.selfNanoseconds = nanosecondsSince(start) / this->iterations;
+        s.cumulativeNanoseconds = s.selfNanoseconds;
+    }
+    (void)sink;
+
+    // Children precede their parents, so one ascending pass sums subtrees
+    for (size_t index = 0; index < nodes.size(); index++) {
+        if (treeParents[index] != NO_PARENT) {
+            stats[treeParents[index]].cumulativeNanoseconds += stats[index].cumulativeNanoseconds;
+        }
+    }
+}
+
+std::string Profiler::label(uint32_t index) const {
+    const Expression::Node& node = expr.getNodes()[index];
+    switch (node.op) {
+        case Op::CONST: return format("%.6g", node.value);
+        case Op::VAR:   return expr.getVariableNames()[node.lhs];
+        default:        return Expression::opName(node.op);
+    }
+}
+
+void Profiler::print(std::ostream& out, size_t maxTreeLines) const {
+    size_t unique = 0;
+    for (char reference : shared) unique += reference ? 0 : 1;
+    double nodeSum = 0.0;
+    for (const auto& s : stats) nodeSum += s.selfNanoseconds;
+
+    out << "profile: " << source << "\n";
+    out << "  result       " << format("%.15g", result) << "\n";
+    out << "  iterations   " << iterations << "\n";
+    out << "  nodes        " << unique << " evaluated, " << order.size() << " in the tree ("
+        << (order.size() - unique) << " shared references)\n";
+    out << "  compile      " << format("%.3f", compileNanoseconds / 1000.0) << " us per call\n";
+    out << "  evaluate     " << format("%.1f", evaluateNanoseconds) << " ns per call";
+    if (evaluateNanoseconds > 0) {
+        out << " (one compile costs " << format("%.1f", compileNanoseconds / evaluateNanoseconds)
+            << " evaluations)";
+    }
+    out << "\n";
+    out << "  node total   " << format("%.1f", nodeSum)
+        << " ns per evaluation, estimated by replaying each node in isolation\n\n";
+
+    // Which operations dominate
+    struct OpTotal {
+        Op op;
+        size_t nodes;
+        double nanoseconds;
+    };
+    std::vector<OpTotal> totals;
+    for (size_t k = 0; k < order.size(); k++) {
+        if (shared[k]) continue;
+        Op op = expr.getNodes()[order[k]].op;
+        auto it = std::find_if(totals.begin(), totals.end(), [&](const OpTotal& t) { return t.op == op; });
+        if (it == totals.end()) {
+            totals.push_back({op, 0, 0.0});
+            it = totals.end() - 1;
+        }
+        it->nodes++;
+        it->nanoseconds += stats[order[k]].selfNanoseconds;
+    }
+    std::sort(totals.begin(), totals.end(),
+              [](const OpTotal& a, const OpTotal& b) { return a.nanoseconds > b.nanoseconds; });
+    char line[160];
+    std::snprintf(line, sizeof(line), "  %-10s %8s %12s %8s\n", "operation", "nodes", "est self ns", "share");
+    out << line;
+    for (const auto& t : totals) {
+        std::snprintf(line, sizeof(line), "  %-10s %8zu %12.1f %7.1f%%\n", Expression::opName(t.op), t.nodes,
+                      t.nanoseconds, nodeSum > 0 ? 100.0 * t.nanoseconds / nodeSum : 0.0);
+        out << line;
+    }
+
+    // Annotated tree
+    out << "\n";
+    std::snprintf(line, sizeof(line), "  %10s %7s %11s %12s  %s\n", "est cum ns", "cum %", "est self ns", "replays",
+                  "node");
+    out << line;
+    double total = stats[expr.getRoot()].cumulativeNanoseconds;
+    size_t lines = std::min(order.size(), maxTreeLines);
+    for (size_t k = 0; k < lines; k++) {
+        uint32_t index = order[k];
+        std::string indent(std::min<size_t>(depths[k], 40) * 2, ' ');
+        if (shared[k]) {
+            std::snprintf(line, sizeof(line), "  %10s %7s %11s %12s  ", "", "", "", "");
+            out << line << indent << label(index) << "  (shared, see above)\n";
+            continue;
+        }
+        const NodeStats& s = stats[index];
+        std::snprintf(line, sizeof(line), "  %10.1f %6.1f%% %11.1f %12llu  ", s.cumulativeNanoseconds,
+                      total > 0 ? 100.0 * s.cumulativeNanoseconds / total : 0.0, s.selfNanoseconds,
+                      static_cast<unsigned long long>(s.replays));
+        out << line << indent << label(index);
+        if (s.uses > 1) out << "  (used " << s.uses << " times)";
+        if (s.replays == 0) out << "  (random, not replayed)";
+        out << "\n";
+    }
+    if (lines < order.size()) {
+        out << "  ... " << (order.size() - lines) << " more lines\n";
+    }
+}
+
+void Profiler::writeFoldedStacks(std::ostream& out) const {
+    std::vector<std::string> frames;
+    for (size_t k = 0; k < order.size(); k++) {
+        if (shared[k]) continue;
+        size_t depth = depths[k];
+        if (depth + 1 < MAX_FOLDED_FRAMES) {
+            frames.resize(depth);
+            frames.push_back(label(order[k]));
+        } else {
+            frames.resize(MAX_FOLDED_FRAMES - 1);
+            frames.push_back("...");
+        }
+
+        double nanoseconds = stats[order[k]].selfNanoseconds * iterations;
+        long long count = std::llround(nanoseconds);
+        if (count <= 0) continue;
+        for (size_t f = 0; f < frames.size(); f++) {
+            if (f > 0) out << ';';
+            out << frames[f];
+        }
+        out << ' ' << count << '\n';
+    }
+}
@@ -0,0 +1,98 @@
+#include "random.h"
+#include "vector_math.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+namespace {
+
+constexpr double TWO_PI = 6.283185307179586476925286766559;
+
+// Normal pairs generated per VectorMath call
+constexpr size_t NORMAL_PAIRS = 256;
+
+uint64_t splitmix64(uint64_t& x) {
+    uint64_t z = (x += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+} // namespace
+
+Random::Random(uint64_t seed) {
+    for (uint64_t& word : state) word = splitmix64(seed);
+}
+
+Random::Random(uint64_t seed, uint64_t stream) {
+    // splitmix64's output function is a bijection, so distinct streams start
+    // the seeding sequence at distinct points
+    uint64_t x = seed ^ splitmix64(stream);
+    for (uint64_t& word : state) word = splitmix64(x);
+}
+
+double Random::normal() {
+    if (hasSpare) {
+        hasSpare = false;
+        return spare;
+    }
+    // 1 - u lies in (0, 1], so the logarithm is finite
+    double radius = std::sqrt(-2.0 * std::log(1.0 - uniform()));
+    double angle = TWO_PI * uniform();
+    spare = radius * std::sin(angle);
+    hasSpare = true;
+    return radius * std::cos(angle);
+}
+
+void Random::fillUniform(double* out, size_t n) {
+    for (size_t i = 0; i < n; i++) out[i] = uniform();
+}
+
+void Random::fillNormal(double* out, size_t n) {
+    double radius[NORMAL_PAIRS];
+    double angle[NORMAL_PAIRS];
+    double cosine[NORMAL_PAIRS];
+    for (size_t done = 0; done < n; ) {
+        size_t pairs = std::min(NORMAL_PAIRS, (n - done + 1) / 2);
+        for (size_t k = 0; k < pairs; k++) {
+            radius[k] = 1.0 - uniform();
+            angle[k] = TWO_PI * uniform();
+        }
+        VectorMath::ln(radius, radius, pairs);
+        for (size_t k = 0; k < pairs; k++) radius[k] *= -2.0;
+        VectorMath::sqrt(radius, radius, pairs);
+        VectorMath::cos(angle, cosine, pairs);
+        VectorMath::sin(angle, angle, pairs);
+
+        // Each pair yields two independent variates; an odd tail drops the sine
+        size_t count = std::min(n - done, 2 * pairs);
+        for (size_t k = 0; k < count; k++) {
+            out[done + k] = radius[k / 2] * ((k & 1) ? angle[k / 2] : cosine[k / 2]);
+        }
+        done += count;
+    }
+}
+
+void Random::fillUniform(float* out, size_t n) {
+    for (size_t i = 0; i < n; i++) out[i] = static_cast<float>(next() >> 40) * 0x1p-24f;
+}
+
+void Random::fillNormal(float* out, size_t n) {
+    double buffer[2 * NORMAL_PAIRS];
+    for (size_t done = 0; done < n; ) {
+        size_t count = std::min(n - done, 2 * NORMAL_PAIRS);
+        fillNormal(buffer, count);
+        for (size_t k = 0; k < count; k++) out[done + k] = static_cast<float>(buffer[k]);
+        done += count;
+    }
+}
+
+Random& Random::local() {
+    thread_local Random generator(randomSeed());
+    return generator;
+}
+
+uint64_t Random::randomSeed() {
+    std::random_device device;
+    return (static_cast<uint64_t>(device()) << 32) ^ device();
+}
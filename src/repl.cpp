@@ -1,7 +1,17 @@
 #include "repl.h"
+#include "definition_library.h"
+#include <fstream>
 #include <iostream>
 #include <sstream>
 #include <algorithm>
+#include <cstdio>
+
+namespace {
+
+// Evaluations per profile command
+constexpr size_t PROFILE_ITERATIONS = 10000;
+
+} // namespace
 
 REPL::REPL(Calculator& calc) : calculator(calc), running(false) {}
 
@@ -26,6 +36,17 @@ void REPL::showHelp() {
     std::cout << "  clear             - Clear calculation history\n";
     std::cout << "  precision <n>     - Set decimal precision (1-20)\n";
     std::cout << "  tofrac            - Convert last result to fraction\n";
+    std::cout << "  load <file>       - Define the 'name = expr' lines of a library file\n";
+    std::cout << "  identify [expr[, tol]]\n";
+    std::cout << "                    - Recognize a value (default: last result) as a closed form\n";
+    std::cout << "  diff(expr, x)     - Derivative of expr with respect to x\n";
+    std::cout << "  grad(expr)        - Gradient of expr over all its variables\n";
+    std::cout << "  table(expr, x, start, stop, step)\n";
+    std::cout << "                    - Tabulate expr over x as CSV\n";
+    std::cout << "  mc(expr, n[, seed])\n";
+    std::cout << "                    - Monte Carlo mean, variance and 95% CI over n samples\n";
+    std::cout << "  profile <expr> [> file]\n";
+    std::cout << "                    - Per-node timing; optionally write folded stacks\n";
     std::cout << "  vars              - Show all variables\n";
     std::cout << "  clearVars         - Clear all variables\n";
     std::cout << "  exit / quit       - Exit calculator\n\n";
@@ -38,7 +59,14 @@ void REPL::showHelp() {
     std::cout << "=== Functions ===\n";
     std::cout << "  Trigonometric: sin, cos, tan, asin, acos, atan\n";
     std::cout << "  Logarithmic:   log, log10, ln, exp\n";
-    std::cout << "  Other:         sqrt, abs, floor, ceil, round\n\n";
+    std::cout << "  Other:         sqrt, abs, floor, ceil, round\n";
+    std::cout << "  Random:        rand() (uniform on [0, 1)), randn() (standard normal)\n";
+    std::cout << "  Linear alg.:   dot, norm, matmul, transpose, det, solve\n\n";
+
+    std::cout << "=== Vectors and Matrices ===\n";
+    std::cout << "  [1, 2, 3]         - Vector literal\n";
+    std::cout << "  [[1, 2], [3, 4]]  - Matrix literal (rows)\n";
+    std::cout << "  A + 1, A * v      - Element-wise operators with broadcasting\n\n";
 
     std::cout << "=== Constants ===\n";
     std::cout << "  pi                - Ratio of circumference to diameter\n";
@@ -145,6 +173,109 @@ void REPL::processCommand(const std::string& input) {
         return;
     }
 
+    if (cmd.size() > 6 && cmd.compare(0, 5, "diff(") == 0 && cmd.back() == ')') {
+        std::string inner = cmd.substr(5, cmd.size() - 6);
+        size_t comma = inner.rfind(',');
+        if (comma == std::string::npos) {
+            std::cout << "Error: diff() requires an expression and a variable\n";
+            return;
+        }
+        std::string expression = trim(inner.substr(0, comma));
+        std::string varName = trim(inner.substr(comma + 1));
+        try {
+            double result = calculator.differentiate(expression, varName);
+            std::cout << calculator.formatResult(result) << "\n";
+            history.push_back(cmd + " = " + calculator.formatResult(result));
+        } catch (const std::exception& e) {
+            std::cout << "Error: " << e.what() << "\n";
+        }
+        return;
+    }
+
+    if (cmd.size() > 6 && cmd.compare(0, 5, "grad(") == 0 && cmd.back() == ')') {
+        std::string expression = trim(cmd.substr(5, cmd.size() - 6));
+        try {
+            auto grad = calculator.gradient(expression);
+            if (grad.empty()) {
+                std::cout << "Expression has no variables\n";
+            }
+            for (const auto& entry : grad) {
+                std::cout << "d/d" << entry.first << " = " << calculator.formatResult(entry.second) << "\n";
+            }
+        } catch (const std::exception& e) {
+            std::cout << "Error: " << e.what() << "\n";
+        }
+        return;
+    }
+
+    if (cmd.size() > 8 && cmd.compare(0, 8, "profile ") == 0) {
+        std::string expression = trim(cmd.substr(8));
+        std::string foldedPath;
+        size_t redirect = expression.rfind('>');
+        if (redirect != std::string::npos) {
+            foldedPath = trim(expression.substr(redirect + 1));
+            expression = trim(expression.substr(0, redirect));
+        }
+        try {
+            Profiler profiler = calculator.profile(expression, PROFILE_ITERATIONS);
+            profiler.print(std::cout);
+            if (!foldedPath.empty()) {
+                std::ofstream folded(foldedPath);
+                if (!folded) throw std::runtime_error("Cannot open " + foldedPath);
+                profiler.writeFoldedStacks(folded);
+                std::cout << "Folded stacks written to " << foldedPath << "\n";
+            }
+        } catch (const std::exception& e) {
+            std::cout << "Error: " << e.what() << "\n";
+        }
+        return;
+    }
+
+    if (cmd.size() > 7 && cmd.compare(0, 6, "table(") == 0 && cmd.back() == ')') {
+        try {
+            std::cout.flush();
+            calculator.tabulate(cmd.substr(6, cmd.size() - 7), TableGenerator::Format::CSV, 0, stdout);
+            std::fflush(stdout);
+        } catch (const std::exception& e) {
+            std::cout << "Error: " << e.what() << "\n";
+        }
+        return;
+    }
+
+    if (cmd.size() > 5 && cmd.compare(0, 5, "load ") == 0) {
+        std::string path = trim(cmd.substr(5));
+        try {
+            DefinitionLibrary::Stats stats = DefinitionLibrary::load(path, calculator);
+            std::cout << "Loaded " << stats.definitions << " definitions from " << path
+                      << (stats.fromCache ? " (cached)" : "") << "\n";
+        } catch (const CalcException& e) {
+            std::cout << "Error: " << e.what() << " (" << path << ", byte " << e.offset << ")\n";
+        } catch (const std::exception& e) {
+            std::cout << "Error: " << e.what() << "\n";
+        }
+        return;
+    }
+
+    if (cmd == "identify" || cmd.compare(0, 9, "identify ") == 0) {
+        try {
+            std::cout << calculator.identify(cmd.substr(8));
+        } catch (const std::exception& e) {
+            std::cout << "Error: " << e.what() << "\n";
+        }
+        return;
+    }
+
+    if (cmd.size() > 4 && cmd.compare(0, 3, "mc(") == 0 && cmd.back() == ')') {
+        try {
+            MonteCarlo::Result result = calculator.monteCarlo(cmd.substr(3, cmd.size() - 4), 0);
+            std::cout << calculator.formatMonteCarlo(result);
+            history.push_back(cmd);
+        } catch (const std::exception& e) {
+            std::cout << "Error: " << e.what() << "\n";
+        }
+        return;
+    }
+
     size_t assignPos = cmd.find('=');
     if (assignPos != std::string::npos && assignPos > 0) {
         std::string varName = trim(cmd.substr(0, assignPos));
@@ -152,9 +283,9 @@ void REPL::processCommand(const std::string& input) {
         
         if (!varName.empty() && std::isalpha(varName[0])) {
             try {
-                double result = calculator.calculate(expression);
-                calculator.setVariable(varName, result);
-                std::cout << varName << " = " << calculator.formatResult(result) << "\n";
+                Matrix result = calculator.evaluate(expression);
+                calculator.setMatrix(varName, result);
+                std::cout << varName << " = " << calculator.formatValue(result) << "\n";
                 history.push_back(varName + " = " + expression);
                 return;
             } catch (const std::exception& e) {
@@ -172,9 +303,9 @@ void REPL::processCommand(const std::string& input) {
             expression = "ans" + cmd;
         }
         
-        double result = calculator.calculate(expression);
-        std::cout << calculator.formatResult(result) << "\n";
-        history.push_back(cmd + " = " + calculator.formatResult(result));
+        Matrix result = calculator.evaluate(expression);
+        std::cout << calculator.formatValue(result) << "\n";
+        history.push_back(cmd + " = " + calculator.formatValue(result));
     } catch (const std::exception& e) {
         std::cout << "Error: " << e.what() << "\n";
     }
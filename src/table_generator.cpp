@@ -0,0 +1,219 @@
+#include "table_generator.h"
+#include "batch_tuning.h"
+#include "block_writer.h"
+#include "calculator.h"
+#include "csv_pipeline.h"
+#include "parser.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+
+std::string trim(const std::string& text) {
+    size_t first = text.find_first_not_of(" \t\r\n");
+    if (first == std::string::npos) return "";
+    size_t last = text.find_last_not_of(" \t\r\n");
+    return text.substr(first, last - first + 1);
+}
+
+} // namespace
+
+TableGenerator::TableGenerator(const Options& opts, const std::unordered_map<std::string, double>& variables)
+    : options(opts) {
+    if (options.variable.empty() || !std::isalpha(static_cast<unsigned char>(options.variable[0]))) {
+        throw std::runtime_error("table requires a variable name");
+    }
+    if (!std::isfinite(options.start) || !std::isfinite(options.stop) || !std::isfinite(options.step)) {
+        throw std::runtime_error("table bounds must be finite");
+    }
+    if (options.step == 0) {
+        throw std::runtime_error("table step must not be zero");
+    }
+    double span = (options.stop - options.start) / options.step;
+    if (span < 0) {
+        throw std::runtime_error("table step points away from stop");
+    }
+    if (span >= 9e15) {
+        throw std::runtime_error("table has too many rows");
+    }
+    // Absorb rounding in the division so that stop itself is included
+    rowCount = static_cast<size_t>(std::floor(span + 1e-9 * std::max(1.0, span))) + 1;
+    if (options.blockRows == 0) options.blockRows = CHUNK_ROWS;
+
+    Parser parser;
+    expr = parser.compile(options.expression);
+    if (expr.hasMatrixOps()) {
+        throw std::runtime_error("Vector operations are not supported in table expressions");
+    }
+
+    variableSlot = expr.findVariable(options.variable);
+    constants.assign(expr.getVariableCount(), 0.0);
+    for (size_t slot = 0; slot < expr.getVariableCount(); slot++) {
+        if (static_cast<int>(slot) == variableSlot) continue;
+        const std::string& name = expr.getVariableNames()[slot];
+        auto it = variables.find(name);
+        if (it == variables.end()) {
+            CalcError error;
+            error.set(ErrorCode::UNDEFINED_VARIABLE, expr.getVariableOffset(slot), "Variable not defined: " + name);
+            throw CalcException(error);
+        }
+        constants[slot] = it->second;
+    }
+}
+
+std::vector<std::string> TableGenerator::splitArguments(const std::string& text) {
+    std::vector<std::string> arguments;
+    int depth = 0;
+    size_t begin = 0;
+    for (size_t i = 0; i < text.size(); i++) {
+        char c = text[i];
+        if (c == '(' || c == '[') {
+            depth++;
+        } else if (c == ')' || c == ']') {
+            depth--;
+        } else if (c == ',' && depth == 0) {
+            arguments.push_back(trim(text.substr(begin, i - begin)));
+            begin = i + 1;
+        }
+    }
+    arguments.push_back(trim(text.substr(begin)));
+    return arguments;
+}
+
+double TableGenerator::rowValue(size_t row) const {
+    double value = options.start + static_cast<double>(row) * options.step;
+    // Do not overshoot stop on the last row
+    if (options.step > 0 ? value > options.stop : value < options.stop) value = options.stop;
+    return value;
+}
+
+void TableGenerator::processBlock(size_t first, size_t count, std::string& out) const {
+    std::vector<std::vector<double>> columns(expr.getVariableCount());
+    std::vector<const double*> slots(expr.getVariableCount());
+    for (size_t slot = 0; slot < columns.size(); slot++) {
+        if (static_cast<int>(slot) == variableSlot) {
+            columns[slot].resize(CHUNK_ROWS);
+        } else {
+            columns[slot].assign(CHUNK_ROWS, constants[slot]);
+        }
+        slots[slot] = columns[slot].data();
+    }
+
+    std::vector<double> x(CHUNK_ROWS);
+    std::vector<double> y(CHUNK_ROWS);
+    std::vector<double> registers;
+    char number[Calculator::FORMAT_BUFFER_SIZE];
+    if (options.format == Format::CSV) {
+        out.reserve(count * 2 * (options.precision + 8));
+    } else {
+        out.reserve(count * sizeof(double));
+    }
+
+    for (size_t done = 0; done < count; done += CHUNK_ROWS) {
+        size_t n = std::min(CHUNK_ROWS, count - done);
+        for (size_t k = 0; k < n; k++) x[k] = rowValue(first + done + k);
+        if (variableSlot >= 0) {
+            std::copy(x.begin(), x.begin() + n, columns[variableSlot].begin());
+        }
+        expr.evaluateBatch(slots.data(), n, y.data(), registers);
+
+        if (options.format == Format::BINARY) {
+            out.append(reinterpret_cast<const char*>(y.data()), n * sizeof(double));
+            continue;
+        }
+        for (size_t k = 0; k < n; k++) {
+            out.append(number, Calculator::formatNumber(x[k], options.precision, number));
+            out.push_back(',');
+            out.append(number, Calculator::formatNumber(y[k], options.precision, number));
+            out.push_back('\n');
+        }
+    }
+}
+
+void TableGenerator::processBlockFloat(size_t first, size_t count, std::string& out,
+                                       AccuracyReport& accuracy) const {
+    std::vector<std::vector<float>> columns(expr.getVariableCount());
+    std::vector<const float*> slots(expr.getVariableCount());
+    std::vector<double> x(CHUNK_ROWS);
+    // The same columns in double for the accuracy sample
+    std::vector<std::vector<double>> exactColumns(expr.getVariableCount());
+    std::vector<const double*> exactSlots(expr.getVariableCount());
+    for (size_t slot = 0; slot < columns.size(); slot++) {
+        if (static_cast<int>(slot) == variableSlot) {
+            columns[slot].resize(CHUNK_ROWS);
+            exactSlots[slot] = x.data();
+        } else {
+            columns[slot].assign(CHUNK_ROWS, static_cast<float>(constants[slot]));
+            exactColumns[slot].assign(CHUNK_ROWS, constants[slot]);
+            exactSlots[slot] = exactColumns[slot].data();
+        }
+        slots[slot] = columns[slot].data();
+    }
+
+    std::vector<float> y(CHUNK_ROWS);
+    const float* results[] = {y.data()};
+    std::vector<float> registers;
+    AccuracySampler sampler(expr, 1);
+    char number[Calculator::FORMAT_BUFFER_SIZE];
+    if (options.format == Format::CSV) {
+        out.reserve(count * 2 * (options.precision + 8));
+    } else {
+        out.reserve(count * sizeof(float));
+    }
+
+    for (size_t done = 0; done < count; done += CHUNK_ROWS) {
+        size_t n = std::min(CHUNK_ROWS, count - done);
+        for (size_t k = 0; k < n; k++) x[k] = rowValue(first + done + k);
+        if (variableSlot >= 0) {
+            float* column = columns[variableSlot].data();
+            for (size_t k = 0; k < n; k++) column[k] = static_cast<float>(x[k]);
+        }
+        expr.evaluateBatch(slots.data(), n, y.data(), registers);
+        sampler.addChunk(first + done, n, exactSlots.data(), results);
+
+        if (options.format == Format::BINARY) {
+            out.append(reinterpret_cast<const char*>(y.data()), n * sizeof(float));
+            continue;
+        }
+        for (size_t k = 0; k < n; k++) {
+            out.append(number, Calculator::formatNumber(x[k], options.precision, number));
+            out.push_back(',');
+            out.append(number, Calculator::formatSignificant(y[k], FLOAT_DIGITS, options.precision, number));
+            out.push_back('\n');
+        }
+    }
+    sampler.finish(accuracy);
+}
+
+TableGenerator::Stats TableGenerator::run(std::FILE* out) {
+    Stats stats;
+    if (options.format == Format::CSV) {
+        std::string header = options.variable + "," + CsvPipeline::quoteField(trim(options.expression)) + "\n";
+        std::fwrite(header.data(), 1, header.size(), out);
+        stats.bytes += header.size();
+    }
+
+    size_t blocks = (rowCount + options.blockRows - 1) / options.blockRows;
+    std::vector<size_t> blockBytes(blocks, 0);
+    std::vector<AccuracyReport> blockAccuracy(options.float32 ? blocks : 0);
+    unsigned threads = options.threads ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+    writeBlocksInOrder(blocks, threads, threads * BLOCKS_IN_FLIGHT_PER_THREAD,
+                       [&](size_t index, std::string& buffer) {
+                           size_t first = index * options.blockRows;
+                           size_t count = std::min(options.blockRows, rowCount - first);
+                           if (options.float32) {
+                               processBlockFloat(first, count, buffer, blockAccuracy[index]);
+                           } else {
+                               processBlock(first, count, buffer);
+                           }
+                           blockBytes[index] = buffer.size();
+                       }, out);
+
+    stats.rows = rowCount;
+    for (size_t bytes : blockBytes) stats.bytes += bytes;
+    for (const AccuracyReport& accuracy : blockAccuracy) stats.accuracy.merge(accuracy);
+    return stats;
+}
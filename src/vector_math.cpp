@@ -0,0 +1,262 @@
+#include "vector_math.h"
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined(CALCPP_VECTOR_MATH_X86) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace {
+
+// Portable traits: one lane, plain double arithmetic
+struct Simd {
+    using V = double;
+    using M = bool;
+    static constexpr size_t LANES = 1;
+    static constexpr bool HAS_FMA = false;
+
+    static uint64_t toBits(double x) { uint64_t b; std::memcpy(&b, &x, sizeof(b)); return b; }
+    static double fromBits(uint64_t b) { double x; std::memcpy(&x, &b, sizeof(x)); return x; }
+
+    static V set(double v) { return v; }
+    static V load(const double* p) { return *p; }
+    static void store(double* p, V v) { *p = v; }
+    static V add(V a, V b) { return a + b; }
+    static V sub(V a, V b) { return a - b; }
+    static V mul(V a, V b) { return a * b; }
+    static V div(V a, V b) { return a / b; }
+    static V sqrt(V a) { return std::sqrt(a); }
+    static V mulAdd(V a, V b, V c) { return a * b + c; }
+    static V fma(V a, V b, V c) { return std::fma(a, b, c); }
+    static V abs(V a) { return std::fabs(a); }
+    static V neg(V a) { return -a; }
+    static V copySign(V magnitude, V sign) { return std::copysign(magnitude, sign); }
+    static V select(M m, V a, V b) { return m ? a : b; }
+    static M lt(V a, V b) { return a < b; }
+    static M gt(V a, V b) { return a > b; }
+    static M eq(V a, V b) { return a == b; }
+    static M notLe(V a, V b) { return !(a <= b); }
+    static M notGe(V a, V b) { return !(a >= b); }
+    static M maskOr(M a, M b) { return a || b; }
+    static M maskAnd(M a, M b) { return a && b; }
+    static M none() { return false; }
+    static bool any(M m) { return m; }
+    static unsigned bits(M m) { return m ? 1u : 0u; }
+    static V round(V x) { return std::nearbyint(x); }
+    static V pow2(V n) {
+        if (!(std::fabs(n) <= 1023.0)) n = 0.0;    // lane is flagged special anyway
+        return fromBits(static_cast<uint64_t>(static_cast<int64_t>(n) + 1023) << 52);
+    }
+    static V exponent(V x) { return static_cast<double>(static_cast<int64_t>(toBits(x) >> 52) - 1023); }
+    static V mantissa(V x) {
+        return fromBits((toBits(x) & 0x000FFFFFFFFFFFFFull) | 0x3FF0000000000000ull);
+    }
+    static V clearLow32(V x) { return fromBits(toBits(x) & 0xFFFFFFFF00000000ull); }
+};
+
+struct SimdFloat {
+    using V = float;
+    using M = bool;
+    static constexpr size_t LANES = 1;
+
+    static uint32_t toBits(float x) { uint32_t b; std::memcpy(&b, &x, sizeof(b)); return b; }
+    static float fromBits(uint32_t b) { float x; std::memcpy(&x, &b, sizeof(x)); return x; }
+
+    static V set(float v) { return v; }
+    static V load(const float* p) { return *p; }
+    static void store(float* p, V v) { *p = v; }
+    static V add(V a, V b) { return a + b; }
+    static V sub(V a, V b) { return a - b; }
+    static V mul(V a, V b) { return a * b; }
+    static V div(V a, V b) { return a / b; }
+    static V sqrt(V a) { return std::sqrt(a); }
+    static V mulAdd(V a, V b, V c) { return a * b + c; }
+    static V abs(V a) { return std::fabs(a); }
+    static V neg(V a) { return -a; }
+    static V copySign(V magnitude, V sign) { return std::copysign(magnitude, sign); }
+    static V select(M m, V a, V b) { return m ? a : b; }
+    static M lt(V a, V b) { return a < b; }
+    static M gt(V a, V b) { return a > b; }
+    static M eq(V a, V b) { return a == b; }
+    static M notLe(V a, V b) { return !(a <= b); }
+    static M notGe(V a, V b) { return !(a >= b); }
+    static M maskOr(M a, M b) { return a || b; }
+    static M none() { return false; }
+    static bool any(M m) { return m; }
+    static unsigned bits(M m) { return m ? 1u : 0u; }
+    static V round(V x) { return std::nearbyint(x); }
+    static V pow2(V n) {
+        if (!(std::fabs(n) <= 127.0f)) n = 0.0f;    // lane is flagged special anyway
+        return fromBits(static_cast<uint32_t>(static_cast<int32_t>(n) + 127) << 23);
+    }
+    static V exponent(V x) { return static_cast<float>(static_cast<int32_t>(toBits(x) >> 23) - 127); }
+    static V mantissa(V x) { return fromBits((toBits(x) & 0x007FFFFFu) | 0x3F800000u); }
+};
+
+} // namespace
+
+#include "vector_math_kernels.inc"
+#include "vector_math_float_kernels.inc"
+
+#if defined(CALCPP_VECTOR_MATH_X86)
+// Defined in vector_math_sse2.cpp, vector_math_avx2.cpp, vector_math_avx512.cpp,
+// each compiled for its instruction set
+const VectorMath::Kernels& sse2VectorMathKernels();
+const VectorMath::Kernels& avx2VectorMathKernels();
+const VectorMath::Kernels& avx512VectorMathKernels();
+const VectorMath::FloatKernels& sse2VectorMathFloatKernels();
+const VectorMath::FloatKernels& avx2VectorMathFloatKernels();
+const VectorMath::FloatKernels& avx512VectorMathFloatKernels();
+#endif
+
+namespace {
+
+template <double (*F)(double)>
+void libmUnary(const double* x, double* out, size_t n) {
+    for (size_t i = 0; i < n; i++) out[i] = F(x[i]);
+}
+
+void libmPow(const double* x, const double* y, double* out, size_t n) {
+    for (size_t i = 0; i < n; i++) out[i] = std::pow(x[i], y[i]);
+}
+
+template <float (*F)(float)>
+void libmUnaryFloat(const float* x, float* out, size_t n) {
+    for (size_t i = 0; i < n; i++) out[i] = F(x[i]);
+}
+
+void libmPowFloat(const float* x, const float* y, float* out, size_t n) {
+    for (size_t i = 0; i < n; i++) out[i] = std::pow(x[i], y[i]);
+}
+
+const VectorMath::Kernels LIBM_KERNELS = {
+    VectorMath::Isa::LIBM,
+    libmUnary<libmSin>, libmUnary<libmCos>, libmUnary<libmTan>,
+    libmUnary<libmAsin>, libmUnary<libmAcos>, libmUnary<libmAtan>,
+    libmUnary<libmExp>, libmUnary<libmLog>, libmUnary<libmLog10>, libmUnary<libmSqrt>,
+    libmPow
+};
+
+const VectorMath::FloatKernels LIBM_FLOAT_KERNELS = {
+    VectorMath::Isa::LIBM,
+    libmUnaryFloat<libmSinf>, libmUnaryFloat<libmCosf>, libmUnaryFloat<libmTanf>,
+    libmUnaryFloat<libmAsinf>, libmUnaryFloat<libmAcosf>, libmUnaryFloat<libmAtanf>,
+    libmUnaryFloat<libmExpf>, libmUnaryFloat<libmLogf>, libmUnaryFloat<libmLog10f>, libmUnaryFloat<libmSqrtf>,
+    libmPowFloat
+};
+
+const VectorMath::Kernels& scalarKernels() {
+    static const VectorMath::Kernels kernels = makeKernels<Simd>(VectorMath::Isa::SCALAR);
+    return kernels;
+}
+
+const VectorMath::FloatKernels& scalarFloatKernels() {
+    static const VectorMath::FloatKernels kernels = makeFloatKernels<SimdFloat>(VectorMath::Isa::SCALAR);
+    return kernels;
+}
+
+#if defined(CALCPP_VECTOR_MATH_X86)
+enum CpuFeature { CPU_AVX2_FMA = 1, CPU_AVX512F = 2 };
+
+unsigned detectCpuFeatures() {
+    unsigned features = 0;
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    bool fma = (info[2] & (1 << 12)) != 0;
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    if (!osxsave) return 0;
+    unsigned long long xcr0 = _xgetbv(0);
+    __cpuidex(info, 7, 0);
+    // The OS must save YMM (and for AVX-512 also opmask/ZMM) state
+    if (fma && (info[1] & (1 << 5)) && (xcr0 & 0x6) == 0x6) features |= CPU_AVX2_FMA;
+    if ((info[1] & (1 << 16)) && (xcr0 & 0xE6) == 0xE6) features |= CPU_AVX512F;
+#else
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) features |= CPU_AVX2_FMA;
+    if (__builtin_cpu_supports("avx512f")) features |= CPU_AVX512F;
+#endif
+    return features;
+}
+#endif
+
+std::atomic<const VectorMath::Kernels*> selected{nullptr};
+
+} // namespace
+
+const VectorMath::Kernels* VectorMath::getKernels(Isa isa) {
+#if defined(CALCPP_VECTOR_MATH_X86)
+    static const unsigned features = detectCpuFeatures();
+#endif
+    switch (isa) {
+        case Isa::LIBM: return &LIBM_KERNELS;
+        case Isa::SCALAR: return &scalarKernels();
+#if defined(CALCPP_VECTOR_MATH_X86)
+        case Isa::SSE2: return &sse2VectorMathKernels();
+        case Isa::AVX2: return (features & CPU_AVX2_FMA) ? &avx2VectorMathKernels() : nullptr;
+        case Isa::AVX512: return (features & CPU_AVX512F) ? &avx512VectorMathKernels() : nullptr;
+#endif
+        default: return nullptr;
+    }
+}
+
+const VectorMath::FloatKernels* VectorMath::getFloatKernels(Isa isa) {
+    // Available exactly where the double kernels are
+    if (getKernels(isa) == nullptr) return nullptr;
+    switch (isa) {
+        case Isa::LIBM: return &LIBM_FLOAT_KERNELS;
+        case Isa::SCALAR: return &scalarFloatKernels();
+#if defined(CALCPP_VECTOR_MATH_X86)
+        case Isa::SSE2: return &sse2VectorMathFloatKernels();
+        case Isa::AVX2: return &avx2VectorMathFloatKernels();
+        case Isa::AVX512: return &avx512VectorMathFloatKernels();
+#endif
+        default: return nullptr;
+    }
+}
+
+VectorMath::Isa VectorMath::bestIsa() {
+    const Isa widestFirst[] = {Isa::AVX512, Isa::AVX2, Isa::SSE2};
+    for (Isa isa : widestFirst) {
+        if (isSupported(isa)) return isa;
+    }
+    // Without vector units libm is as fast and more accurate
+    return Isa::LIBM;
+}
+
+VectorMath::Isa VectorMath::getIsa() {
+    return active().isa;
+}
+
+bool VectorMath::setIsa(Isa isa) {
+    const Kernels* kernels = getKernels(isa);
+    if (kernels == nullptr) return false;
+    selected.store(kernels, std::memory_order_release);
+    return true;
+}
+
+const char* VectorMath::isaName(Isa isa) {
+    switch (isa) {
+        case Isa::LIBM: return "libm";
+        case Isa::SCALAR: return "scalar";
+        case Isa::SSE2: return "sse2";
+        case Isa::AVX2: return "avx2";
+        case Isa::AVX512: return "avx512";
+    }
+    return "unknown";
+}
+
+const VectorMath::Kernels& VectorMath::active() {
+    const Kernels* kernels = selected.load(std::memory_order_acquire);
+    if (kernels == nullptr) {
+        kernels = getKernels(bestIsa());
+        selected.store(kernels, std::memory_order_release);
+    }
+    return *kernels;
+}
+
+const VectorMath::FloatKernels& VectorMath::activeFloat() {
+    return *getFloatKernels(active().isa);
+}
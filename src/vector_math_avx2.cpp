@@ -0,0 +1,127 @@
+// AVX2 + FMA build of the vector math kernels (four doubles or eight floats
+// per vector).
+// Compiled with AVX2/FMA code generation; only called after CPU detection.
+#include "vector_math.h"
+
+#if defined(CALCPP_VECTOR_MATH_X86)
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <immintrin.h>
+
+namespace {
+
+struct Simd {
+    using V = __m256d;
+    using M = __m256d;
+    static constexpr size_t LANES = 4;
+    static constexpr bool HAS_FMA = true;
+
+    static V bitsConstant(uint64_t b) { return _mm256_castsi256_pd(_mm256_set1_epi64x(static_cast<long long>(b))); }
+
+    static V set(double v) { return _mm256_set1_pd(v); }
+    static V load(const double* p) { return _mm256_loadu_pd(p); }
+    static void store(double* p, V v) { _mm256_storeu_pd(p, v); }
+    static V add(V a, V b) { return _mm256_add_pd(a, b); }
+    static V sub(V a, V b) { return _mm256_sub_pd(a, b); }
+    static V mul(V a, V b) { return _mm256_mul_pd(a, b); }
+    static V div(V a, V b) { return _mm256_div_pd(a, b); }
+    static V sqrt(V a) { return _mm256_sqrt_pd(a); }
+    static V mulAdd(V a, V b, V c) { return _mm256_fmadd_pd(a, b, c); }
+    static V fma(V a, V b, V c) { return _mm256_fmadd_pd(a, b, c); }
+    static V abs(V a) { return _mm256_andnot_pd(_mm256_set1_pd(-0.0), a); }
+    static V neg(V a) { return _mm256_xor_pd(a, _mm256_set1_pd(-0.0)); }
+    static V copySign(V magnitude, V sign) {
+        V signBit = _mm256_set1_pd(-0.0);
+        return _mm256_or_pd(_mm256_andnot_pd(signBit, magnitude), _mm256_and_pd(signBit, sign));
+    }
+    static V select(M m, V a, V b) { return _mm256_blendv_pd(b, a, m); }
+    static M lt(V a, V b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+    static M gt(V a, V b) { return _mm256_cmp_pd(a, b, _CMP_GT_OQ); }
+    static M eq(V a, V b) { return _mm256_cmp_pd(a, b, _CMP_EQ_OQ); }
+    static M notLe(V a, V b) { return _mm256_cmp_pd(a, b, _CMP_NLE_UQ); }
+    static M notGe(V a, V b) { return _mm256_cmp_pd(a, b, _CMP_NGE_UQ); }
+    static M maskOr(M a, M b) { return _mm256_or_pd(a, b); }
+    static M maskAnd(M a, M b) { return _mm256_and_pd(a, b); }
+    static M none() { return _mm256_setzero_pd(); }
+    static bool any(M m) { return _mm256_movemask_pd(m) != 0; }
+    static unsigned bits(M m) { return static_cast<unsigned>(_mm256_movemask_pd(m)); }
+    static V round(V x) { return _mm256_round_pd(x, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+    static V pow2(V n) {
+        V biased = _mm256_add_pd(n, _mm256_set1_pd(4503599627370496.0 + 1023.0));
+        return _mm256_castsi256_pd(_mm256_slli_epi64(_mm256_castpd_si256(biased), 52));
+    }
+    static V exponent(V x) {
+        __m256i biased = _mm256_srli_epi64(_mm256_castpd_si256(x), 52);
+        V asDouble = _mm256_or_pd(_mm256_castsi256_pd(biased), _mm256_set1_pd(4503599627370496.0));
+        return _mm256_sub_pd(asDouble, _mm256_set1_pd(4503599627370496.0 + 1023.0));
+    }
+    static V mantissa(V x) {
+        return _mm256_or_pd(_mm256_and_pd(x, bitsConstant(0x000FFFFFFFFFFFFFull)), _mm256_set1_pd(1.0));
+    }
+    static V clearLow32(V x) { return _mm256_and_pd(x, bitsConstant(0xFFFFFFFF00000000ull)); }
+};
+
+// Eight floats per vector
+struct SimdFloat {
+    using V = __m256;
+    using M = __m256;
+    static constexpr size_t LANES = 8;
+
+    static V bitsConstant(uint32_t b) { return _mm256_castsi256_ps(_mm256_set1_epi32(static_cast<int>(b))); }
+
+    static V set(float v) { return _mm256_set1_ps(v); }
+    static V load(const float* p) { return _mm256_loadu_ps(p); }
+    static void store(float* p, V v) { _mm256_storeu_ps(p, v); }
+    static V add(V a, V b) { return _mm256_add_ps(a, b); }
+    static V sub(V a, V b) { return _mm256_sub_ps(a, b); }
+    static V mul(V a, V b) { return _mm256_mul_ps(a, b); }
+    static V div(V a, V b) { return _mm256_div_ps(a, b); }
+    static V sqrt(V a) { return _mm256_sqrt_ps(a); }
+    static V mulAdd(V a, V b, V c) { return _mm256_fmadd_ps(a, b, c); }
+    static V abs(V a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+    static V neg(V a) { return _mm256_xor_ps(a, _mm256_set1_ps(-0.0f)); }
+    static V copySign(V magnitude, V sign) {
+        V signBit = _mm256_set1_ps(-0.0f);
+        return _mm256_or_ps(_mm256_andnot_ps(signBit, magnitude), _mm256_and_ps(signBit, sign));
+    }
+    static V select(M m, V a, V b) { return _mm256_blendv_ps(b, a, m); }
+    static M lt(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+    static M gt(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+    static M eq(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+    static M notLe(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_NLE_UQ); }
+    static M notGe(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_NGE_UQ); }
+    static M maskOr(M a, M b) { return _mm256_or_ps(a, b); }
+    static M none() { return _mm256_setzero_ps(); }
+    static bool any(M m) { return _mm256_movemask_ps(m) != 0; }
+    static unsigned bits(M m) { return static_cast<unsigned>(_mm256_movemask_ps(m)); }
+    static V round(V x) { return _mm256_round_ps(x, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+    static V pow2(V n) {
+        __m256i biased = _mm256_add_epi32(_mm256_cvtps_epi32(n), _mm256_set1_epi32(127));
+        return _mm256_castsi256_ps(_mm256_slli_epi32(biased, 23));
+    }
+    static V exponent(V x) {
+        __m256i biased = _mm256_srli_epi32(_mm256_castps_si256(x), 23);
+        return _mm256_cvtepi32_ps(_mm256_sub_epi32(biased, _mm256_set1_epi32(127)));
+    }
+    static V mantissa(V x) {
+        return _mm256_or_ps(_mm256_and_ps(x, bitsConstant(0x007FFFFFu)), _mm256_set1_ps(1.0f));
+    }
+};
+
+} // namespace
+
+#include "vector_math_kernels.inc"
+#include "vector_math_float_kernels.inc"
+
+const VectorMath::Kernels& avx2VectorMathKernels() {
+    static const VectorMath::Kernels kernels = makeKernels<Simd>(VectorMath::Isa::AVX2);
+    return kernels;
+}
+
+const VectorMath::FloatKernels& avx2VectorMathFloatKernels() {
+    static const VectorMath::FloatKernels kernels = makeFloatKernels<SimdFloat>(VectorMath::Isa::AVX2);
+    return kernels;
+}
+
+#endif
@@ -0,0 +1,135 @@
+// AVX-512F build of the vector math kernels (eight doubles or sixteen floats
+// per vector).
+// Compiled with AVX-512F code generation; only called after CPU detection.
+#include "vector_math.h"
+
+#if defined(CALCPP_VECTOR_MATH_X86)
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <immintrin.h>
+
+namespace {
+
+struct Simd {
+    using V = __m512d;
+    using M = __mmask8;
+    static constexpr size_t LANES = 8;
+    static constexpr bool HAS_FMA = true;
+
+    static __m512i asInt(V v) { return _mm512_castpd_si512(v); }
+    static V asDouble(__m512i v) { return _mm512_castsi512_pd(v); }
+    static __m512i bitsConstant(uint64_t b) { return _mm512_set1_epi64(static_cast<long long>(b)); }
+
+    static V set(double v) { return _mm512_set1_pd(v); }
+    static V load(const double* p) { return _mm512_loadu_pd(p); }
+    static void store(double* p, V v) { _mm512_storeu_pd(p, v); }
+    static V add(V a, V b) { return _mm512_add_pd(a, b); }
+    static V sub(V a, V b) { return _mm512_sub_pd(a, b); }
+    static V mul(V a, V b) { return _mm512_mul_pd(a, b); }
+    static V div(V a, V b) { return _mm512_div_pd(a, b); }
+    static V sqrt(V a) { return _mm512_sqrt_pd(a); }
+    static V mulAdd(V a, V b, V c) { return _mm512_fmadd_pd(a, b, c); }
+    static V fma(V a, V b, V c) { return _mm512_fmadd_pd(a, b, c); }
+    static V abs(V a) { return asDouble(_mm512_and_epi64(asInt(a), bitsConstant(0x7FFFFFFFFFFFFFFFull))); }
+    static V neg(V a) { return asDouble(_mm512_xor_epi64(asInt(a), bitsConstant(0x8000000000000000ull))); }
+    static V copySign(V magnitude, V sign) {
+        __m512i signBit = bitsConstant(0x8000000000000000ull);
+        return asDouble(_mm512_or_epi64(_mm512_andnot_epi64(signBit, asInt(magnitude)),
+                                        _mm512_and_epi64(signBit, asInt(sign))));
+    }
+    static V select(M m, V a, V b) { return _mm512_mask_blend_pd(m, b, a); }
+    static M lt(V a, V b) { return _mm512_cmp_pd_mask(a, b, _CMP_LT_OQ); }
+    static M gt(V a, V b) { return _mm512_cmp_pd_mask(a, b, _CMP_GT_OQ); }
+    static M eq(V a, V b) { return _mm512_cmp_pd_mask(a, b, _CMP_EQ_OQ); }
+    static M notLe(V a, V b) { return _mm512_cmp_pd_mask(a, b, _CMP_NLE_UQ); }
+    static M notGe(V a, V b) { return _mm512_cmp_pd_mask(a, b, _CMP_NGE_UQ); }
+    static M maskOr(M a, M b) { return static_cast<M>(a | b); }
+    static M maskAnd(M a, M b) { return static_cast<M>(a & b); }
+    static M none() { return 0; }
+    static bool any(M m) { return m != 0; }
+    static unsigned bits(M m) { return m; }
+    static V round(V x) { return _mm512_roundscale_pd(x, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+    static V pow2(V n) {
+        V biased = _mm512_add_pd(n, _mm512_set1_pd(4503599627370496.0 + 1023.0));
+        return asDouble(_mm512_slli_epi64(asInt(biased), 52));
+    }
+    static V exponent(V x) {
+        __m512i biased = _mm512_srli_epi64(asInt(x), 52);
+        V value = asDouble(_mm512_or_epi64(biased, asInt(_mm512_set1_pd(4503599627370496.0))));
+        return _mm512_sub_pd(value, _mm512_set1_pd(4503599627370496.0 + 1023.0));
+    }
+    static V mantissa(V x) {
+        return asDouble(_mm512_or_epi64(_mm512_and_epi64(asInt(x), bitsConstant(0x000FFFFFFFFFFFFFull)),
+                                        bitsConstant(0x3FF0000000000000ull)));
+    }
+    static V clearLow32(V x) { return asDouble(_mm512_and_epi64(asInt(x), bitsConstant(0xFFFFFFFF00000000ull))); }
+};
+
+// Sixteen floats per vector
+struct SimdFloat {
+    using V = __m512;
+    using M = __mmask16;
+    static constexpr size_t LANES = 16;
+
+    static __m512i asInt(V v) { return _mm512_castps_si512(v); }
+    static V asFloat(__m512i v) { return _mm512_castsi512_ps(v); }
+    static __m512i bitsConstant(uint32_t b) { return _mm512_set1_epi32(static_cast<int>(b)); }
+
+    static V set(float v) { return _mm512_set1_ps(v); }
+    static V load(const float* p) { return _mm512_loadu_ps(p); }
+    static void store(float* p, V v) { _mm512_storeu_ps(p, v); }
+    static V add(V a, V b) { return _mm512_add_ps(a, b); }
+    static V sub(V a, V b) { return _mm512_sub_ps(a, b); }
+    static V mul(V a, V b) { return _mm512_mul_ps(a, b); }
+    static V div(V a, V b) { return _mm512_div_ps(a, b); }
+    static V sqrt(V a) { return _mm512_sqrt_ps(a); }
+    static V mulAdd(V a, V b, V c) { return _mm512_fmadd_ps(a, b, c); }
+    static V abs(V a) { return asFloat(_mm512_and_epi32(asInt(a), bitsConstant(0x7FFFFFFFu))); }
+    static V neg(V a) { return asFloat(_mm512_xor_epi32(asInt(a), bitsConstant(0x80000000u))); }
+    static V copySign(V magnitude, V sign) {
+        __m512i signBit = bitsConstant(0x80000000u);
+        return asFloat(_mm512_or_epi32(_mm512_andnot_epi32(signBit, asInt(magnitude)),
+                                       _mm512_and_epi32(signBit, asInt(sign))));
+    }
+    static V select(M m, V a, V b) { return _mm512_mask_blend_ps(m, b, a); }
+    static M lt(V a, V b) { return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ); }
+    static M gt(V a, V b) { return _mm512_cmp_ps_mask(a, b, _CMP_GT_OQ); }
+    static M eq(V a, V b) { return _mm512_cmp_ps_mask(a, b, _CMP_EQ_OQ); }
+    static M notLe(V a, V b) { return _mm512_cmp_ps_mask(a, b, _CMP_NLE_UQ); }
+    static M notGe(V a, V b) { return _mm512_cmp_ps_mask(a, b, _CMP_NGE_UQ); }
+    static M maskOr(M a, M b) { return static_cast<M>(a | b); }
+    static M none() { return 0; }
+    static bool any(M m) { return m != 0; }
+    static unsigned bits(M m) { return m; }
+    static V round(V x) { return _mm512_roundscale_ps(x, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+    static V pow2(V n) {
+        __m512i biased = _mm512_add_epi32(_mm512_cvtps_epi32(n), _mm512_set1_epi32(127));
+        return asFloat(_mm512_slli_epi32(biased, 23));
+    }
+    static V exponent(V x) {
+        __m512i biased = _mm512_srli_epi32(asInt(x), 23);
+        return _mm512_cvtepi32_ps(_mm512_sub_epi32(biased, _mm512_set1_epi32(127)));
+    }
+    static V mantissa(V x) {
+        return asFloat(_mm512_or_epi32(_mm512_and_epi32(asInt(x), bitsConstant(0x007FFFFFu)),
+                                       bitsConstant(0x3F800000u)));
+    }
+};
+
+} // namespace
+
+#include "vector_math_kernels.inc"
+#include "vector_math_float_kernels.inc"
+
+const VectorMath::Kernels& avx512VectorMathKernels() {
+    static const VectorMath::Kernels kernels = makeKernels<Simd>(VectorMath::Isa::AVX512);
+    return kernels;
+}
+
+const VectorMath::FloatKernels& avx512VectorMathFloatKernels() {
+    static const VectorMath::FloatKernels kernels = makeFloatKernels<SimdFloat>(VectorMath::Isa::AVX512);
+    return kernels;
+}
+
+#endif
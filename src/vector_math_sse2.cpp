@@ -0,0 +1,147 @@
+// SSE2 build of the vector math kernels (two doubles or four floats per vector)
+#include "vector_math.h"
+
+#if defined(CALCPP_VECTOR_MATH_X86)
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <emmintrin.h>
+
+namespace {
+
+struct Simd {
+    using V = __m128d;
+    using M = __m128d;
+    static constexpr size_t LANES = 2;
+    static constexpr bool HAS_FMA = false;
+
+    static V bitsConstant(uint64_t b) { return _mm_castsi128_pd(_mm_set1_epi64x(static_cast<long long>(b))); }
+
+    static V set(double v) { return _mm_set1_pd(v); }
+    static V load(const double* p) { return _mm_loadu_pd(p); }
+    static void store(double* p, V v) { _mm_storeu_pd(p, v); }
+    static V add(V a, V b) { return _mm_add_pd(a, b); }
+    static V sub(V a, V b) { return _mm_sub_pd(a, b); }
+    static V mul(V a, V b) { return _mm_mul_pd(a, b); }
+    static V div(V a, V b) { return _mm_div_pd(a, b); }
+    static V sqrt(V a) { return _mm_sqrt_pd(a); }
+    static V mulAdd(V a, V b, V c) { return _mm_add_pd(_mm_mul_pd(a, b), c); }
+    static V fma(V a, V b, V c) { return _mm_add_pd(_mm_mul_pd(a, b), c); }   // unused: HAS_FMA is false
+    static V abs(V a) { return _mm_andnot_pd(_mm_set1_pd(-0.0), a); }
+    static V neg(V a) { return _mm_xor_pd(a, _mm_set1_pd(-0.0)); }
+    static V copySign(V magnitude, V sign) {
+        V signBit = _mm_set1_pd(-0.0);
+        return _mm_or_pd(_mm_andnot_pd(signBit, magnitude), _mm_and_pd(signBit, sign));
+    }
+    static V select(M m, V a, V b) { return _mm_or_pd(_mm_and_pd(m, a), _mm_andnot_pd(m, b)); }
+    static M lt(V a, V b) { return _mm_cmplt_pd(a, b); }
+    static M gt(V a, V b) { return _mm_cmpgt_pd(a, b); }
+    static M eq(V a, V b) { return _mm_cmpeq_pd(a, b); }
+    static M notLe(V a, V b) { return _mm_cmpnle_pd(a, b); }
+    static M notGe(V a, V b) { return _mm_cmpnge_pd(a, b); }
+    static M maskOr(M a, M b) { return _mm_or_pd(a, b); }
+    static M maskAnd(M a, M b) { return _mm_and_pd(a, b); }
+    static M none() { return _mm_setzero_pd(); }
+    static bool any(M m) { return _mm_movemask_pd(m) != 0; }
+    static unsigned bits(M m) { return static_cast<unsigned>(_mm_movemask_pd(m)); }
+    static V round(V x) {
+        // Adding and removing 1.5*2^52 rounds to nearest even for |x| < 2^51
+        V magic = _mm_set1_pd(6755399441055744.0);
+        return _mm_sub_pd(_mm_add_pd(x, magic), magic);
+    }
+    static V pow2(V n) {
+        // 2^52 + (n + 1023) holds the biased exponent in its low bits
+        V biased = _mm_add_pd(n, _mm_set1_pd(4503599627370496.0 + 1023.0));
+        return _mm_castsi128_pd(_mm_slli_epi64(_mm_castpd_si128(biased), 52));
+    }
+    static V exponent(V x) {
+        __m128i biased = _mm_srli_epi64(_mm_castpd_si128(x), 52);
+        V asDouble = _mm_or_pd(_mm_castsi128_pd(biased), _mm_set1_pd(4503599627370496.0));
+        return _mm_sub_pd(asDouble, _mm_set1_pd(4503599627370496.0 + 1023.0));
+    }
+    static V mantissa(V x) {
+        return _mm_or_pd(_mm_and_pd(x, bitsConstant(0x000FFFFFFFFFFFFFull)), _mm_set1_pd(1.0));
+    }
+    static V clearLow32(V x) { return _mm_and_pd(x, bitsConstant(0xFFFFFFFF00000000ull)); }
+};
+
+// Four floats per vector
+struct SimdFloat {
+    using V = __m128;
+    using M = __m128;
+    static constexpr size_t LANES = 4;
+
+    static V bitsConstant(uint32_t b) { return _mm_castsi128_ps(_mm_set1_epi32(static_cast<int>(b))); }
+
+    static V set(float v) { return _mm_set1_ps(v); }
+    static V load(const float* p) { return _mm_loadu_ps(p); }
+    static void store(float* p, V v) { _mm_storeu_ps(p, v); }
+    static V add(V a, V b) { return _mm_add_ps(a, b); }
+    static V sub(V a, V b) { return _mm_sub_ps(a, b); }
+    static V mul(V a, V b) { return _mm_mul_ps(a, b); }
+    static V div(V a, V b) { return _mm_div_ps(a, b); }
+    static V sqrt(V a) { return _mm_sqrt_ps(a); }
+    static V mulAdd(V a, V b, V c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+    static V abs(V a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+    static V neg(V a) { return _mm_xor_ps(a, _mm_set1_ps(-0.0f)); }
+    static V copySign(V magnitude, V sign) {
+        V signBit = _mm_set1_ps(-0.0f);
+        return _mm_or_ps(_mm_andnot_ps(signBit, magnitude), _mm_and_ps(signBit, sign));
+    }
+    static V select(M m, V a, V b) { return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b)); }
+    static M lt(V a, V b) { return _mm_cmplt_ps(a, b); }
+    static M gt(V a, V b) { return _mm_cmpgt_ps(a, b); }
+    static M eq(V a, V b) { return _mm_cmpeq_ps(a, b); }
+    static M notLe(V a, V b) { return _mm_cmpnle_ps(a, b); }
+    static M notGe(V a, V b) { return _mm_cmpnge_ps(a, b); }
+    static M maskOr(M a, M b) { return _mm_or_ps(a, b); }
+    static M none() { return _mm_setzero_ps(); }
+    static bool any(M m) { return _mm_movemask_ps(m) != 0; }
+    static unsigned bits(M m) { return static_cast<unsigned>(_mm_movemask_ps(m)); }
+    static V round(V x) {
+        // Adding and removing 1.5*2^23 rounds to nearest even for |x| < 2^22
+        V magic = _mm_set1_ps(12582912.0f);
+        return _mm_sub_ps(_mm_add_ps(x, magic), magic);
+    }
+    static V pow2(V n) {
+        __m128i biased = _mm_add_epi32(_mm_cvtps_epi32(n), _mm_set1_epi32(127));
+        return _mm_castsi128_ps(_mm_slli_epi32(biased, 23));
+    }
+    static V exponent(V x) {
+        __m128i biased = _mm_srli_epi32(_mm_castps_si128(x), 23);
+        return _mm_cvtepi32_ps(_mm_sub_epi32(biased, _mm_set1_epi32(127)));
+    }
+    static V mantissa(V x) {
+        return _mm_or_ps(_mm_and_ps(x, bitsConstant(0x007FFFFFu)), _mm_set1_ps(1.0f));
+    }
+};
+
+} // namespace
+
+#include "vector_math_kernels.inc"
+#include "vector_math_float_kernels.inc"
+
+namespace {
+
+void libmPow(const double* x, const double* y, double* out, size_t n) {
+    for (size_t i = 0; i < n; i++) out[i] = std::pow(x[i], y[i]);
+}
+
+} // namespace
+
+const VectorMath::Kernels& sse2VectorMathKernels() {
+    static const VectorMath::Kernels kernels = [] {
+        VectorMath::Kernels k = makeKernels<Simd>(VectorMath::Isa::SSE2);
+        // Without FMA the double-double steps of pow cost more than libm
+        k.pow = libmPow;
+        return k;
+    }();
+    return kernels;
+}
+
+const VectorMath::FloatKernels& sse2VectorMathFloatKernels() {
+    static const VectorMath::FloatKernels kernels = makeFloatKernels<SimdFloat>(VectorMath::Isa::SSE2);
+    return kernels;
+}
+
+#endif